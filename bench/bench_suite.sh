@@ -0,0 +1,192 @@
+#!/bin/bash
+# bench_suite.sh - Ende-zu-Ende-Benchmark von client/server auf Loopback
+#
+# Baut client/server aus den Quellen im Repo-Root und überträgt für jede
+# Kombination aus Fenster, Nutzdatengröße, Dateigröße und Verlustrate eine
+# generierte Datei. Gemessen werden Übertragungsdauer, Goodput,
+# Retransmissionsanteil und CPU-Zeit (user+sys) von Client und Server.
+# Ergebnis als CSV und JSON; mit Baseline Vergleich und Regressionsmeldung.
+#
+# Usage: bench/bench_suite.sh [-w windows] [-s payloads] [-f sizes] [-l losses]
+#                             [-m gbn|sr] [-k none|reno|bbr] [-r repeats]
+#                             [-o prefix] [-b baseline.csv] [-t tolerance] [-u]
+#   -w : Fenstergrößen                       (Default: "16 128")
+#   -s : Nutzdaten je Paket in Bytes, <= 512 (Default: "64 500")
+#        (eine Zeile je Paket, Client mit -c off)
+#   -f : Dateigrößen, Suffix k/m             (Default: "1m 4m")
+#   -l : Verlust je Richtung (-r/-a am Server, fester Seed) (Default: "0 0.02")
+#   -m : ARQ-Modus                           (Default: sr)
+#   -k : Staukontrolle                       (Default: none)
+#   -r : Wiederholungen, gewertet wird der Median der Dauer (Default: 3)
+#   -o : Ausgabe <prefix>.csv / <prefix>.json (Default: bench/results/suite)
+#   -b : Baseline zum Vergleich              (Default: bench/baseline.csv)
+#   -t : erlaubter Goodput-Rückgang          (Default: 0.35 = 35 %, Loopback streut stark)
+#   -u : Ergebnis als neue Baseline speichern
+#
+# Rückgabe: 0 = ok, 2 = Regression gegenüber der Baseline (oder FAIL).
+# BENCH_PORT: erster Port (Default 3500), BENCH_TIMEOUT: s je Lauf (Default 120)
+
+set -e
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+WINDOWS="16 128"
+PAYLOADS="64 500"
+SIZES="1m 4m"
+LOSSES="0 0.02"
+MODE=sr
+CC=none
+REPEATS=3
+PREFIX="$ROOT/bench/results/suite"
+BASELINE="$ROOT/bench/baseline.csv"
+TOLERANCE=0.35
+UPDATE=0
+PORT=${BENCH_PORT:-3500}
+TMO=${BENCH_TIMEOUT:-120}
+
+while getopts "w:s:f:l:m:k:r:o:b:t:u" opt; do
+    case $opt in
+        w) WINDOWS=$OPTARG ;;
+        s) PAYLOADS=$OPTARG ;;
+        f) SIZES=$OPTARG ;;
+        l) LOSSES=$OPTARG ;;
+        m) MODE=$OPTARG ;;
+        k) CC=$OPTARG ;;
+        r) REPEATS=$OPTARG ;;
+        o) PREFIX=$OPTARG ;;
+        b) BASELINE=$OPTARG ;;
+        t) TOLERANCE=$OPTARG ;;
+        u) UPDATE=1 ;;
+        *) sed -n '2,/^$/p' "$0" | sed 's/^# \{0,1\}//' >&2; exit 1 ;;
+    esac
+done
+
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+mkdir -p "$(dirname "$PREFIX")"
+
+gcc -O2 -pthread -o "$WORK/client" "$ROOT/client.c" "$ROOT/clientSy.c" "$ROOT/cc.c" "$ROOT/stats.c" "$ROOT/wire.c" "$ROOT/error.c"
+gcc -O2 -pthread -o "$WORK/server" "$ROOT/server.c" "$ROOT/serverSy.c" "$ROOT/log.c" "$ROOT/chan.c" "$ROOT/stats.c" "$ROOT/wire.c" "$ROOT/error.c"
+
+# Größe mit Suffix k/m in Bytes
+bytes_of() {
+    awk -v s="$1" 'BEGIN { n = s + 0; u = tolower(substr(s, length(s)));
+                           if (u == "k") n *= 1024; else if (u == "m") n *= 1048576; print int(n) }'
+}
+
+# Testdatei: Zeilen zu je <payload> Bytes inkl. '\n', auf <size> Bytes gekürzt
+make_input() {
+    local payload=$1 bytes=$2 file=$3
+    yes "$(head -c $((payload - 1)) /dev/zero | tr '\0' 'x')" | head -c "$bytes" > "$file"
+}
+
+# ein Lauf -> CSV-Zeile (ohne Konfigurationsspalten) auf stdout
+run_once() {
+    local window=$1 loss=$2 seed=$3 in=$4
+    local out="$WORK/out.txt" cpuc cpus rc t0 t1 result spid tpid
+    PORT=$((PORT + 1))
+    rm -f "$out" "$WORK/srv.time"
+
+    ( TIMEFORMAT='%3U %3S'
+      time timeout -s INT $((TMO + 10)) "$WORK/server" -p "$PORT" -f "$out" -n 1 -l error \
+          -r "$loss,seed=$seed" -a "$loss,seed=$((seed + 1000))" > "$WORK/srv.log" 2>&1 ) 2> "$WORK/srv.time" &
+    spid=$!
+    sleep 0.2
+
+    t0=$(date +%s.%N)
+    set +e
+    { TIMEFORMAT='%3U %3S'
+      time timeout "$TMO" "$WORK/client" -a ::1 -p "$PORT" -f "$in" -w "$window" -m "$MODE" -k "$CC" \
+          -c off > "$WORK/cli.log" 2>&1; } 2> "$WORK/cli.time"
+    rc=$?
+    set -e
+    t1=$(date +%s.%N)
+
+    # Server beendet sich nach dem CLOSE selbst (-n 1), sonst per SIGINT
+    for _ in 1 2 3 4 5 6 7 8 9 10; do
+        kill -0 "$spid" 2>/dev/null || break
+        sleep 0.2
+    done
+    if kill -0 "$spid" 2>/dev/null; then
+        tpid=$(pgrep -P "$spid" -x timeout || true)
+        [ -n "$tpid" ] && kill -INT "$tpid" 2>/dev/null
+    fi
+    wait "$spid" 2>/dev/null || true
+
+    result=FAIL
+    if [ $rc -eq 124 ]; then
+        result=TIMEOUT
+    elif [ $rc -eq 0 ] && cmp -s "$in" "$out"; then
+        result=PASS
+    fi
+    cpuc=$(awk 'END { print $1 + $2 }' "$WORK/cli.time")
+    cpus=$(awk 'END { if (NF == 2) print $1 + $2; else print "NA" }' "$WORK/srv.time")
+
+    awk -v b="$(wc -c < "$in")" -v s="$t0" -v e="$t1" -v cc="$cpuc" -v cs="$cpus" -v r="$result" '
+        /I\/O tx/               { tx = $4 }
+        /packets retransmitted/ { re = $2 }
+        END { t = e - s; printf "%d,%.3f,%.1f,%d,%d,%.4f,%s,%s,%s\n",
+              b, t, b / t, tx, re, tx ? re / tx : 0, cc, cs, r }' "$WORK/cli.log"
+}
+
+HEADER="mode,window,payload,size,loss,bytes,time_s,goodput_Bps,tx_packets,retrans,retrans_ratio,cpu_client_s,cpu_server_s,result"
+CSV="$PREFIX.csv"
+echo "$HEADER" > "$CSV"
+
+printf "%-4s %-7s %-8s %-6s %-6s %-9s %-13s %-8s %-14s %s\n" \
+       "mode" "window" "payload" "size" "loss" "time[s]" "goodput[B/s]" "retx" "cpu c/s [s]" "result"
+for size in $SIZES; do
+    for payload in $PAYLOADS; do
+        make_input "$payload" "$(bytes_of "$size")" "$WORK/in.txt"
+        for loss in $LOSSES; do
+            for window in $WINDOWS; do
+                : > "$WORK/runs"
+                for rep in $(seq 1 "$REPEATS"); do
+                    run_once "$window" "$loss" "$rep" "$WORK/in.txt" >> "$WORK/runs"
+                done
+                # Median nach Dauer
+                row=$(sort -t, -k2,2g "$WORK/runs" | sed -n "$(( (REPEATS + 1) / 2 ))p")
+                echo "$MODE,$window,$payload,$size,$loss,$row" >> "$CSV"
+                echo "$row" | awk -F, -v m="$MODE" -v w="$window" -v p="$payload" -v s="$size" -v l="$loss" \
+                    '{ printf "%-4s %-7s %-8s %-6s %-6s %-9.3f %-13.0f %-8.4f %-14s %s\n",
+                       m, w, p, s, l, $2, $3, $6, $7 "/" $8, $9 }'
+            done
+        done
+    done
+done
+
+# JSON: Liste von Objekten mit denselben Feldern wie die CSV
+awk -F, 'NR == 1 { for (i = 1; i <= NF; i++) key[i] = $i; next }
+         { printf "%s  {", (NR > 2) ? ",\n" : "[\n";
+           for (i = 1; i <= NF; i++) {
+               v = ($i ~ /^-?[0-9.]+$/) ? $i : "\"" $i "\"";
+               printf "%s\"%s\": %s", (i > 1) ? ", " : "", key[i], v;
+           }
+           printf "}" }
+         END { print (NR > 1) ? "\n]" : "[]" }' "$CSV" > "$PREFIX.json"
+echo "results: $CSV, $PREFIX.json"
+
+if [ $UPDATE -eq 1 ]; then
+    cp "$CSV" "$BASELINE"
+    echo "baseline updated: $BASELINE"
+    exit 0
+fi
+if [ ! -f "$BASELINE" ]; then
+    echo "no baseline ($BASELINE), comparison skipped (-u stores one)"
+    exit 0
+fi
+
+# Vergleich über (mode, window, payload, size, loss): Goodput-Rückgang > Toleranz
+# oder ein nicht bestandener Lauf gelten als Regression
+awk -F, -v tol="$TOLERANCE" '
+    FNR == 1 { next }
+    NR == FNR { base[$1 "," $2 "," $3 "," $4 "," $5] = $8; next }
+    {
+        k = $1 "," $2 "," $3 "," $4 "," $5
+        if (!(k in base)) { printf "  new         %s goodput %.0f B/s\n", k, $8; next }
+        d = (base[k] > 0) ? ($8 - base[k]) / base[k] : 0
+        bad = ($14 != "PASS") || (d < -tol)
+        printf "  %-11s %s goodput %.0f B/s (baseline %.0f, %+.1f %%)\n",
+               bad ? "REGRESSION" : "ok", k, $8, base[k], d * 100
+        if (bad) n++
+    }
+    END { if (n) { printf "%d regression(s) against baseline\n", n; exit 2 } }' "$BASELINE" "$CSV"
@@ -0,0 +1,54 @@
+#!/bin/bash
+# bench_window.sh - Loopback-Benchmark: Goodput in Abhängigkeit von der Fenstergröße
+#
+# Baut client/server aus den Quellen im Repo-Root, startet pro Fenstergröße
+# einen Server auf ::1 und misst die Übertragungsdauer einer Testdatei.
+#
+# Usage: bench/bench_window.sh [lines] [lossReq] [lossAck] [windows...]
+#   lines   : Zeilen der generierten Testdatei (Default: 100)
+#   lossReq : Request-Verlust am Server      (Default: 0.1)
+#   lossAck : ACK-Verlust am Server          (Default: 0.1)
+#   windows : Fenstergrößen                  (Default: 1 2 5 10)
+#
+# Hinweis: im Slot-Betrieb (1 Paket pro 100-ms-Slot) zeigt sich der Gewinn
+# durch das Pipelining vor allem unter Verlust, weil Timeouts überlappen.
+
+set -e
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+LINES=${1:-100}
+LOSS_REQ=${2:-0.1}
+LOSS_ACK=${3:-0.1}
+shift 3 2>/dev/null || shift $#
+WINDOWS=${*:-"1 2 5 10"}
+PORT=${BENCH_PORT:-3400}
+
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+
+gcc -O2 -pthread -o "$WORK/client" "$ROOT/client.c" "$ROOT/clientSy.c" "$ROOT/cc.c" "$ROOT/stats.c" "$ROOT/wire.c" "$ROOT/error.c"
+gcc -O2 -pthread -o "$WORK/server" "$ROOT/server.c" "$ROOT/serverSy.c" "$ROOT/log.c" "$ROOT/chan.c" "$ROOT/stats.c" "$ROOT/wire.c" "$ROOT/error.c"
+
+seq 1 "$LINES" | sed 's/^/benchmark line /' > "$WORK/in.txt"
+BYTES=$(wc -c < "$WORK/in.txt")
+
+printf "%-8s %-10s %-12s %-8s\n" "window" "time[s]" "goodput[B/s]" "result"
+for w in $WINDOWS; do
+    PORT=$((PORT + 1))
+    rm -f "$WORK/out.txt"
+    "$WORK/server" -p "$PORT" -f "$WORK/out.txt" -r "$LOSS_REQ" -a "$LOSS_ACK" -n 1 > /dev/null &
+    SRV=$!
+    sleep 0.2
+
+    START=$(date +%s.%N)
+    "$WORK/client" -a ::1 -p "$PORT" -f "$WORK/in.txt" -w "$w" > /dev/null 2>&1 || true
+    END=$(date +%s.%N)
+
+    kill "$SRV" 2>/dev/null || true
+    wait "$SRV" 2>/dev/null || true
+
+    RESULT=FAIL
+    cmp -s "$WORK/in.txt" "$WORK/out.txt" && RESULT=PASS
+    awk -v w="$w" -v s="$START" -v e="$END" -v b="$BYTES" -v r="$RESULT" \
+        'BEGIN { t = e - s; printf "%-8s %-10.2f %-12.1f %-8s\n", w, t, b / t, r }'
+done
@@ -0,0 +1,272 @@
+/* cc.c - Staukontrolle: festes Fenster, AIMD/NewReno und BBR-artig (siehe cc.h) */
+
+#include <string.h>
+
+#include "cc.h"
+
+/* --------------------------------------------------------------- */
+/*  CC_NONE: festes Fenster                                        */
+/* --------------------------------------------------------------- */
+
+static void noneInit(struct cc_state *cc)
+{
+    cc->cwnd = cc->maxWnd;
+}
+
+static void noneOnAck(struct cc_state *cc, int acked, long rttUs, int inFlight, long long nowUs)
+{
+    (void)acked; (void)rttUs; (void)inFlight; (void)nowUs;
+    cc->cwnd = cc->maxWnd;
+}
+
+static void noneOnTimeout(struct cc_state *cc, int inFlight, long long nowUs)
+{
+    (void)cc; (void)inFlight; (void)nowUs;
+}
+
+static void noneOnFastRetransmit(struct cc_state *cc, int inFlight, long long nowUs)
+{
+    (void)cc; (void)inFlight; (void)nowUs;
+}
+
+/* --------------------------------------------------------------- */
+/*  CC_RENO: AIMD nach RFC 5681                                    */
+/* --------------------------------------------------------------- */
+
+static void renoInit(struct cc_state *cc)
+{
+    cc->cwnd = CC_INIT_CWND;
+    cc->ssthresh = cc->maxWnd;
+}
+
+static void renoOnAck(struct cc_state *cc, int acked, long rttUs, int inFlight, long long nowUs)
+{
+    (void)rttUs; (void)inFlight; (void)nowUs;
+
+    if (cc->cwnd < cc->ssthresh) {
+        cc->cwnd += acked;                 /* Slow Start: +1 je ACK-tem Paket */
+    } else {
+        cc->cwnd += (double)acked / cc->cwnd; /* Congestion Avoidance: +1 je RTT */
+    }
+    /* nicht über das nutzbare Fenster hinaus wachsen (sonst nach Verlust zu groß) */
+    if (cc->cwnd > cc->maxWnd) {
+        cc->cwnd = cc->maxWnd;
+    }
+}
+
+static void renoOnTimeout(struct cc_state *cc, int inFlight, long long nowUs)
+{
+    (void)nowUs;
+
+    cc->ssthresh = inFlight / 2.0;
+    if (cc->ssthresh < 2) {
+        cc->ssthresh = 2;
+    }
+    cc->cwnd = 1;
+}
+
+/* Fast Recovery (RFC 5681/6582): Fenster halbieren statt auf 1, danach
+ * Congestion Avoidance; ohne Inflation je weiterem doppelten ACK */
+static void renoOnFastRetransmit(struct cc_state *cc, int inFlight, long long nowUs)
+{
+    (void)nowUs;
+
+    cc->ssthresh = inFlight / 2.0;
+    if (cc->ssthresh < 2) {
+        cc->ssthresh = 2;
+    }
+    cc->cwnd = cc->ssthresh;
+}
+
+/* --------------------------------------------------------------- */
+/*  CC_BBR: Engpassrate und min. RTT messen, cwnd = Gain * BDP     */
+/* --------------------------------------------------------------- */
+
+#define BBR_STARTUP    0   /* Rate verdoppeln, bis sie nicht mehr wächst */
+#define BBR_DRAIN      1   /* in STARTUP aufgebaute Queue abbauen        */
+#define BBR_PROBE_BW   2   /* Gain-Zyklus um die BDP                     */
+#define BBR_PROBE_RTT  3   /* kurz minimales Fenster, min. RTT auffrischen */
+
+static const double bbrCycle[8] = { 1.25, 0.75, 1, 1, 1, 1, 1, 1 };
+
+static double bbrBdp(const struct cc_state *cc)
+{
+    double bdp = cc->btlbw * (double)cc->minRtt / 1e6;
+    return (bdp < CC_INIT_CWND) ? CC_INIT_CWND : bdp;
+}
+
+static void bbrInit(struct cc_state *cc)
+{
+    cc->cwnd = CC_INIT_CWND;
+    cc->phase = BBR_STARTUP;
+}
+
+/* Rundenende: Ratenprobe in den Max-Filter, Phasenwechsel */
+static void bbrRound(struct cc_state *cc, int inFlight, long long nowUs)
+{
+    long long dt = nowUs - cc->roundStart;
+    double rate = (double)(cc->delivered - cc->roundDelivered) * 1e6 / (double)dt;
+    int k;
+
+    cc->bwRound[cc->bwIdx] = rate;
+    cc->bwIdx = (cc->bwIdx + 1) % CC_BBR_BW_ROUNDS;
+    cc->btlbw = 0;
+    for (k = 0; k < CC_BBR_BW_ROUNDS; k++) {
+        if (cc->bwRound[k] > cc->btlbw) {
+            cc->btlbw = cc->bwRound[k];
+        }
+    }
+    cc->roundStart = nowUs;
+    cc->roundDelivered = cc->delivered;
+
+    switch (cc->phase) {
+    case BBR_STARTUP:
+        if (cc->btlbw >= cc->fullBw * 1.25) {
+            cc->fullBw = cc->btlbw;
+            cc->fullBwCount = 0;
+        } else if (++cc->fullBwCount >= 3) {
+            cc->phase = BBR_DRAIN;
+        }
+        break;
+    case BBR_DRAIN:
+        if (inFlight <= bbrBdp(cc)) {
+            cc->phase = BBR_PROBE_BW;
+            cc->cycle = 0;
+        }
+        break;
+    case BBR_PROBE_BW:
+        cc->cycle = (cc->cycle + 1) % 8;
+        break;
+    }
+
+    if (cc->phase != BBR_PROBE_RTT && nowUs - cc->minRttStamp > CC_BBR_MINRTT_WIN_US) {
+        cc->phase = BBR_PROBE_RTT;
+        cc->phaseStamp = nowUs;
+    } else if (cc->phase == BBR_PROBE_RTT && nowUs - cc->phaseStamp > CC_BBR_PROBE_RTT_US) {
+        cc->phase = BBR_PROBE_BW;
+        cc->cycle = 0;
+    }
+}
+
+static void bbrOnAck(struct cc_state *cc, int acked, long rttUs, int inFlight, long long nowUs)
+{
+    cc->delivered += (unsigned long)acked;
+
+    /* min. RTT: kleinere Messung, oder erste Messung in PROBE_RTT (alter Wert veraltet) */
+    if (rttUs > 0 && (cc->minRtt == 0 || rttUs <= cc->minRtt ||
+                      (cc->phase == BBR_PROBE_RTT && cc->minRttStamp < cc->phaseStamp))) {
+        cc->minRtt = rttUs;
+        cc->minRttStamp = nowUs;
+    }
+    if (cc->roundStart == 0) {
+        cc->roundStart = nowUs;
+        cc->roundDelivered = cc->delivered - (unsigned long)acked;
+        cc->minRttStamp = nowUs;
+    }
+    if (cc->minRtt > 0 && nowUs - cc->roundStart >= cc->minRtt) {
+        bbrRound(cc, inFlight, nowUs);
+    }
+
+    switch (cc->phase) {
+    case BBR_STARTUP:
+        cc->cwnd += acked;  /* exponentiell wie Slow Start */
+        break;
+    case BBR_DRAIN:
+        cc->cwnd = bbrBdp(cc);
+        break;
+    case BBR_PROBE_BW:
+        /* +2 Pakete Reserve, damit verzögerte/gebündelte ACKs das Fenster nicht leerlaufen lassen */
+        cc->cwnd = bbrCycle[cc->cycle] * bbrBdp(cc) + 2;
+        break;
+    case BBR_PROBE_RTT:
+        cc->cwnd = CC_INIT_CWND;
+        break;
+    }
+    if (cc->cwnd > cc->maxWnd) {
+        cc->cwnd = cc->maxWnd;
+    }
+}
+
+static void bbrOnTimeout(struct cc_state *cc, int inFlight, long long nowUs)
+{
+    (void)inFlight; (void)nowUs;
+
+    /* Verlust ist kein Stausignal; nur nach einem Timeout vorsichtig neu starten,
+     * die nächsten ACKs setzen cwnd wieder aus der Ratenschätzung */
+    cc->cwnd = 1;
+}
+
+static void bbrOnFastRetransmit(struct cc_state *cc, int inFlight, long long nowUs)
+{
+    /* einzelner Verlust: Fenster bleibt beim Gain * BDP aus der Ratenschätzung */
+    (void)cc; (void)inFlight; (void)nowUs;
+}
+
+/* --------------------------------------------------------------- */
+/*  Auswahl und gemeinsame Schnittstelle                           */
+/* --------------------------------------------------------------- */
+
+static const struct cc_ops ccTable[] = {
+    [CC_NONE] = { "none", noneInit, noneOnAck, noneOnTimeout, noneOnFastRetransmit },
+    [CC_RENO] = { "reno", renoInit, renoOnAck, renoOnTimeout, renoOnFastRetransmit },
+    [CC_BBR]  = { "bbr",  bbrInit,  bbrOnAck,  bbrOnTimeout,  bbrOnFastRetransmit  },
+};
+
+int ccParse(const char *name)
+{
+    int k;
+
+    for (k = 0; k < (int)(sizeof(ccTable) / sizeof(ccTable[0])); k++) {
+        if (strcmp(name, ccTable[k].name) == 0) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+void ccInit(struct cc_state *cc, int algo, int maxWnd)
+{
+    if (algo < 0 || algo >= (int)(sizeof(ccTable) / sizeof(ccTable[0]))) {
+        algo = CC_NONE;
+    }
+    memset(cc, 0, sizeof(*cc));
+    cc->ops = &ccTable[algo];
+    cc->maxWnd = (maxWnd < 1) ? 1 : maxWnd;
+    cc->ops->init(cc);
+}
+
+void ccOnAck(struct cc_state *cc, int acked, long rttUs, int inFlight, long long nowUs)
+{
+    cc->ops->onAck(cc, acked, rttUs, inFlight, nowUs);
+}
+
+void ccOnTimeout(struct cc_state *cc, int inFlight, long long nowUs)
+{
+    cc->ops->onTimeout(cc, inFlight, nowUs);
+}
+
+void ccOnFastRetransmit(struct cc_state *cc, int inFlight, long long nowUs)
+{
+    cc->ops->onFastRetransmit(cc, inFlight, nowUs);
+}
+
+int ccWindow(const struct cc_state *cc)
+{
+    int w = (int)cc->cwnd;
+
+    if (w > cc->maxWnd) w = cc->maxWnd;
+    return (w < 1) ? 1 : w;
+}
+
+double ccRate(const struct cc_state *cc, long srttUs)
+{
+    if (cc->ops == &ccTable[CC_BBR]) {
+        return cc->btlbw;
+    }
+    return (srttUs > 0) ? cc->cwnd * 1e6 / (double)srttUs : 0.0;
+}
+
+const char *ccName(const struct cc_state *cc)
+{
+    return cc->ops ? cc->ops->name : "none";
+}
@@ -0,0 +1,77 @@
+/* cc.h - Staukontrolle (Congestion Control) für das Sendefenster des Clients
+ *
+ * Die ARQ-Schicht (clientSy.c) meldet bestätigte Pakete und Timeouts an
+ * den gewählten Regler, der daraus das Staufenster cwnd (in Paketen)
+ * bestimmt. Gesendet wird höchstens min(cwnd, Fenster aus -w/HELLO).
+ *
+ * Neue Regler: struct cc_ops implementieren und in ccTable (cc.c)
+ * unter einer neuen CC_*-Nummer eintragen.
+ */
+
+#ifndef CC_H_INCLUDED
+#define CC_H_INCLUDED
+
+#define CC_NONE   0   /* festes Fenster (-w), bisheriges Verhalten        */
+#define CC_RENO   1   /* AIMD / NewReno: Slow Start, Halbierung bei Verlust */
+#define CC_BBR    2   /* verzögerungsbasiert: Engpassrate * min. RTT       */
+
+#define CC_INIT_CWND          4       /* Startfenster (Pakete)                     */
+#define CC_BBR_BW_ROUNDS      10      /* Max-Filter der Rate über so viele Runden   */
+#define CC_BBR_MINRTT_WIN_US  10000000L /* min. RTT gilt 10 s, dann PROBE_RTT     */
+#define CC_BBR_PROBE_RTT_US   200000L /* Dauer von PROBE_RTT                        */
+
+struct cc_state;
+
+/* Schnittstelle eines Reglers */
+struct cc_ops {
+    const char *name;
+    void (*init)(struct cc_state *cc);
+    /* acked Pakete neu kumulativ bestätigt; rttUs < 0: keine gültige Messung */
+    void (*onAck)(struct cc_state *cc, int acked, long rttUs, int inFlight, long long nowUs);
+    /* Retransmission-Timeout (Verlust) */
+    void (*onTimeout)(struct cc_state *cc, int inFlight, long long nowUs);
+    /* Verlust per doppelter ACKs erkannt, Beginn der Fast Recovery */
+    void (*onFastRetransmit)(struct cc_state *cc, int inFlight, long long nowUs);
+};
+
+struct cc_state {
+    const struct cc_ops *ops;
+    int       maxWnd;          /* Obergrenze für cwnd (aktuelles Fenster)        */
+    double    cwnd;            /* Staufenster in Paketen                          */
+    double    ssthresh;        /* Reno: Slow-Start-Schwelle                       */
+
+    /* BBR: Rate und RTT je Runde (eine Runde ~ eine min. RTT) */
+    int       phase;           /* BBR_STARTUP, ...                                */
+    int       cycle;           /* Index im PROBE_BW-Gain-Zyklus                   */
+    double    btlbw;           /* geschätzte Engpassrate (Pakete/s)               */
+    double    bwRound[CC_BBR_BW_ROUNDS];
+    int       bwIdx;
+    double    fullBw;          /* STARTUP-Ende: Rate wächst nicht mehr um 25 %    */
+    int       fullBwCount;
+    long      minRtt;          /* min. RTT (µs), 0 = noch keine                   */
+    long long minRttStamp;
+    long long phaseStamp;
+    long long roundStart;
+    unsigned long delivered;   /* bestätigte Pakete insgesamt                     */
+    unsigned long roundDelivered;
+};
+
+/* Name -> CC_*, -1 wenn unbekannt ("none", "reno", "bbr") */
+int ccParse(const char *name);
+
+/* Regler algo für ein Fenster von maxWnd Paketen initialisieren */
+void ccInit(struct cc_state *cc, int algo, int maxWnd);
+
+void ccOnAck(struct cc_state *cc, int acked, long rttUs, int inFlight, long long nowUs);
+void ccOnTimeout(struct cc_state *cc, int inFlight, long long nowUs);
+void ccOnFastRetransmit(struct cc_state *cc, int inFlight, long long nowUs);
+
+/* Effektives Fenster: min(cwnd, maxWnd), mindestens 1 */
+int ccWindow(const struct cc_state *cc);
+
+/* Geschätzte Rate in Paketen/s (BBR: Engpassrate, sonst cwnd / srtt) */
+double ccRate(const struct cc_state *cc, long srttUs);
+
+const char *ccName(const struct cc_state *cc);
+
+#endif /* CC_H_INCLUDED */
@@ -0,0 +1,416 @@
+/* chan.c - reproduzierbares Kanalmodell (siehe chan.h) */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "chan.h"
+
+#define CHAN_REORDER_DEFAULT_US  10000L
+
+/* --------------------------------------------------------------- */
+/*  Zufallsgenerator: SplitMix64 zum Mischen, xorshift64* je Kanal */
+/* --------------------------------------------------------------- */
+
+static uint64_t splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static uint64_t nextRandom(struct chan *c)
+{
+    uint64_t x = c->rng;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    c->rng = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+double chanRandom(struct chan *c)
+{
+    /* obere 53 Bit -> [0, 1) */
+    return (double)(nextRandom(c) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* Zufallsereignis mit Wahrscheinlichkeit p (zieht bei 0 bzw. 1 nicht) */
+static int chance(struct chan *c, double p)
+{
+    if (p <= 0.0) return 0;
+    if (p >= 1.0) return 1;
+    return chanRandom(c) < p;
+}
+
+/* --------------------------------------------------------------- */
+/*  Verlustplan (replay=)                                          */
+/* --------------------------------------------------------------- */
+
+static int schedPush(struct chan_cfg *cfg, size_t *cap, int drop)
+{
+    if (cfg->schedLen == *cap) {
+        size_t n = *cap ? *cap * 2 : 256;
+        unsigned char *p = realloc(cfg->sched, n);
+        if (!p) {
+            return -1;
+        }
+        cfg->sched = p;
+        *cap = n;
+    }
+    cfg->sched[cfg->schedLen++] = (unsigned char)drop;
+    return 0;
+}
+
+/*
+ * Server-Log (Textausgabe der Testfälle): jede "Received packet"-Zeile ist
+ * eine Verlustentscheidung für Requests, verworfen, wenn "Request packet
+ * DROPPED" vor dem nächsten Paket folgt. Für ACKs zählt jede "Sent answer"-
+ * (behalten) bzw. "ACK DROPPED"-Zeile (verworfen).
+ * Sonst: Folge von 0/1, '#' leitet einen Kommentar bis Zeilenende ein.
+ */
+static int schedLoad(struct chan_cfg *cfg, const char *path, int dir)
+{
+    FILE *fp = fopen(path, "r");
+    char line[512];
+    size_t cap = 0;
+    int isLog = 0;
+    int pending = 0;      /* Log: Request gesehen, Entscheidung noch offen */
+    int rc = 0;
+
+    if (!fp) {
+        perror(path);
+        return -1;
+    }
+    free(cfg->sched);
+    cfg->sched = NULL;
+    cfg->schedLen = 0;
+
+    /* Server-Log, sobald irgendeine Zeile von der ARQ-Schicht stammt */
+    while (!isLog && fgets(line, sizeof(line), fp)) {
+        isLog = (strstr(line, "[Server]") != NULL);
+    }
+    rewind(fp);
+
+    while (rc == 0 && fgets(line, sizeof(line), fp)) {
+        if (isLog) {
+            if (dir == CHAN_DIR_REQ) {
+                if (strstr(line, "Received packet:")) {
+                    if (pending) {
+                        rc = schedPush(cfg, &cap, 0);
+                    }
+                    pending = 1;
+                } else if (pending && strstr(line, "Request packet DROPPED")) {
+                    rc = schedPush(cfg, &cap, 1);
+                    pending = 0;
+                }
+            } else if (strstr(line, "Sent answer:")) {
+                rc = schedPush(cfg, &cap, 0);
+            } else if (strstr(line, "ACK DROPPED")) {
+                rc = schedPush(cfg, &cap, 1);
+            }
+        } else {
+            char *p;
+            for (p = line; *p && *p != '#' && rc == 0; p++) {
+                if (*p == '0' || *p == '1') {
+                    rc = schedPush(cfg, &cap, *p == '1');
+                }
+            }
+        }
+    }
+    if (rc == 0 && pending) {
+        rc = schedPush(cfg, &cap, 0);
+    }
+    fclose(fp);
+
+    if (rc < 0) {
+        fprintf(stderr, "chan: out of memory reading '%s'\n", path);
+        return -1;
+    }
+    if (cfg->schedLen == 0) {
+        fprintf(stderr, "chan: '%s' contains no %s loss schedule\n",
+                path, dir == CHAN_DIR_REQ ? "request" : "ACK");
+        return -1;
+    }
+    return 0;
+}
+
+/* --------------------------------------------------------------- */
+/*  Beschreibung einlesen                                          */
+/* --------------------------------------------------------------- */
+
+void chanDefaults(struct chan_cfg *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->geLossBad = 1.0;
+    cfg->reorderUs = CHAN_REORDER_DEFAULT_US;
+    cfg->queueMax = CHAN_QUEUE_DEFAULT;
+    cfg->seed = CHAN_SEED_DEFAULT;
+}
+
+void chanFree(struct chan_cfg *cfg)
+{
+    free(cfg->sched);
+    cfg->sched = NULL;
+    cfg->schedLen = 0;
+}
+
+/* Zahl mit optionalem Suffix k/m/g (Faktor 1000) */
+static int parseNum(const char *s, double *out, int suffix)
+{
+    char *end;
+    double v = strtod(s, &end);
+
+    if (end == s) {
+        return -1;
+    }
+    if (suffix) {
+        switch (tolower((unsigned char)*end)) {
+        case 'k': v *= 1e3; end++; break;
+        case 'm': v *= 1e6; end++; break;
+        case 'g': v *= 1e9; end++; break;
+        default: break;
+        }
+    }
+    if (*end != 0 && *end != ':') {
+        return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+static int isProb(double p)
+{
+    return p >= 0.0 && p <= 1.0;
+}
+
+int chanParse(struct chan_cfg *cfg, const char *spec, int dir)
+{
+    char *copy, *tok, *save = NULL;
+    double v = 0.0;
+    int rc = 0;
+
+    if (!spec) {
+        return -1;
+    }
+    /* reine Zahl: Bernoulli-Verlust wie bisher */
+    if (parseNum(spec, &v, 0) == 0 && strchr(spec, ':') == NULL) {
+        if (!isProb(v)) {
+            fprintf(stderr, "chan: loss %s out of range 0..1\n", spec);
+            return -1;
+        }
+        cfg->loss = v;
+        return 0;
+    }
+
+    copy = strdup(spec);
+    if (!copy) {
+        return -1;
+    }
+    for (tok = strtok_r(copy, ",", &save); tok && rc == 0; tok = strtok_r(NULL, ",", &save)) {
+        char *val = strchr(tok, '=');
+        char *arg;
+
+        if (!val) {
+            /* Zahl ohne Schlüssel: loss=, z.B. "0.1,seed=3" */
+            if (parseNum(tok, &v, 0) == 0 && !strchr(tok, ':') && isProb(v)) {
+                cfg->loss = v;
+                continue;
+            }
+            fprintf(stderr, "chan: invalid setting '%s' (key=value expected)\n", tok);
+            rc = -1;
+            break;
+        }
+        *val++ = 0;
+        arg = strchr(val, ':');
+
+        if (strcmp(tok, "loss") == 0) {
+            rc = (parseNum(val, &cfg->loss, 0) == 0 && !arg && isProb(cfg->loss)) ? 0 : -1;
+        } else if (strcmp(tok, "ge") == 0) {
+            double f[4] = { 0.0, 0.0, 1.0, 0.0 };
+            int n = 0;
+            char *p = val;
+            while (p && n < 4 && rc == 0) {
+                if (parseNum(p, &f[n], 0) < 0 || !isProb(f[n])) {
+                    rc = -1;
+                }
+                n++;
+                p = strchr(p, ':');
+                if (p) p++;
+            }
+            if (n < 2 || p) {
+                rc = -1;
+            }
+            cfg->ge = 1;
+            cfg->geP = f[0];
+            cfg->geR = f[1];
+            cfg->geLossBad = f[2];
+            cfg->geLossGood = f[3];
+        } else if (strcmp(tok, "delay") == 0 || strcmp(tok, "jitter") == 0) {
+            rc = (parseNum(val, &v, 0) == 0 && !arg && v >= 0.0) ? 0 : -1;
+            *(tok[0] == 'd' ? &cfg->delayUs : &cfg->jitterUs) = (long)(v * 1000.0);
+        } else if (strcmp(tok, "reorder") == 0) {
+            rc = (parseNum(val, &cfg->reorder, 0) == 0 && isProb(cfg->reorder)) ? 0 : -1;
+            if (rc == 0 && arg) {
+                rc = (parseNum(arg + 1, &v, 0) == 0 && v >= 0.0) ? 0 : -1;
+                cfg->reorderUs = (long)(v * 1000.0);
+            }
+        } else if (strcmp(tok, "dup") == 0) {
+            rc = (parseNum(val, &cfg->dup, 0) == 0 && !arg && isProb(cfg->dup)) ? 0 : -1;
+        } else if (strcmp(tok, "rate") == 0) {
+            rc = (parseNum(val, &v, 1) == 0 && !arg && v >= 0.0) ? 0 : -1;
+            cfg->rateBps = (long long)v;
+        } else if (strcmp(tok, "queue") == 0) {
+            rc = (parseNum(val, &v, 0) == 0 && !arg && v >= 1.0) ? 0 : -1;
+            cfg->queueMax = (int)v;
+        } else if (strcmp(tok, "seed") == 0) {
+            cfg->seed = strtoull(val, NULL, 0);
+        } else if (strcmp(tok, "replay") == 0) {
+            if (schedLoad(cfg, val, dir) < 0) {
+                free(copy);
+                return -1;
+            }
+        } else {
+            rc = -1;
+        }
+        if (rc < 0) {
+            fprintf(stderr, "chan: invalid setting '%s=%s'\n", tok, val);
+        }
+    }
+    free(copy);
+    return rc;
+}
+
+int chanLossOnly(const struct chan_cfg *cfg)
+{
+    return cfg->delayUs == 0 && cfg->jitterUs == 0 && cfg->reorder == 0.0 &&
+           cfg->dup == 0.0 && cfg->rateBps == 0;
+}
+
+void chanDescribe(const struct chan_cfg *cfg, char *buf, size_t len)
+{
+    size_t n = 0, lost = 0, i;
+
+#define CHAN_ADD(...) \
+    do { if (n < len) n += (size_t)snprintf(buf + n, len - n, __VA_ARGS__); } while (0)
+    buf[0] = 0;
+    for (i = 0; i < cfg->schedLen; i++) {
+        lost += cfg->sched[i];
+    }
+    if (cfg->schedLen) CHAN_ADD("replay %zu/%zu lost, then ", lost, cfg->schedLen);
+    CHAN_ADD("loss %.3f", cfg->loss);
+    if (cfg->ge) CHAN_ADD(", GE p=%.3f r=%.3f bad=%.2f good=%.2f",
+                          cfg->geP, cfg->geR, cfg->geLossBad, cfg->geLossGood);
+    if (cfg->delayUs || cfg->jitterUs) CHAN_ADD(", delay %.1f+%.1f ms",
+                                                cfg->delayUs / 1000.0, cfg->jitterUs / 1000.0);
+    if (cfg->reorder > 0.0) CHAN_ADD(", reorder %.3f/%.1f ms", cfg->reorder, cfg->reorderUs / 1000.0);
+    if (cfg->dup > 0.0) CHAN_ADD(", dup %.3f", cfg->dup);
+    if (cfg->rateBps) CHAN_ADD(", rate %lld bit/s (queue %d)", cfg->rateBps, cfg->queueMax);
+    CHAN_ADD(", seed %llu", (unsigned long long)cfg->seed);
+#undef CHAN_ADD
+}
+
+/* --------------------------------------------------------------- */
+/*  Kanal                                                          */
+/* --------------------------------------------------------------- */
+
+void chanInit(struct chan *c, const struct chan_cfg *cfg, unsigned int stream)
+{
+    uint64_t x = cfg->seed ^ ((uint64_t)stream << 32);
+
+    memset(c, 0, sizeof(*c));
+    c->cfg = *cfg;
+    c->rng = splitmix64(&x);
+    if (c->rng == 0) {
+        c->rng = 1;  /* xorshift bleibt sonst auf 0 stehen */
+    }
+    if (cfg->rateBps > 0) {
+        c->txEndUs = malloc((size_t)cfg->queueMax * sizeof(*c->txEndUs));
+        if (!c->txEndUs) {
+            fprintf(stderr, "chan: out of memory, no queue limit\n");
+        }
+    }
+}
+
+void chanRelease(struct chan *c)
+{
+    free(c->txEndUs);
+    c->txEndUs = NULL;
+    c->txCount = 0;
+}
+
+int chanDrop(struct chan *c)
+{
+    int drop;
+
+    c->packets++;
+    if (c->schedPos < c->cfg.schedLen) {
+        drop = c->cfg.sched[c->schedPos++];
+    } else if (c->cfg.ge) {
+        /* Zustandswechsel vor dem Paket, dann Verlust je nach Zustand */
+        if (c->geBad) {
+            if (chance(c, c->cfg.geR)) c->geBad = 0;
+        } else {
+            if (chance(c, c->cfg.geP)) c->geBad = 1;
+        }
+        drop = chance(c, c->geBad ? c->cfg.geLossBad : c->cfg.geLossGood);
+        if (!drop) {
+            drop = chance(c, c->cfg.loss);
+        }
+    } else {
+        drop = chance(c, c->cfg.loss);
+    }
+    if (drop) {
+        c->dropped++;
+    }
+    return drop;
+}
+
+int chanSchedule(struct chan *c, long long nowUs, size_t len, long long releaseUs[2])
+{
+    long long t = nowUs;
+    int n = 1;
+
+    if (chanDrop(c)) {
+        return 0;
+    }
+    /* Engpass: Pakete nacheinander serialisieren, volle Warteschlange -> Drop-Tail.
+     * Fertig serialisierte Pakete haben den Engpass verlassen, auch wenn sie
+     * noch die Verzögerung abwarten. */
+    if (c->cfg.rateBps > 0) {
+        while (c->txCount > 0 && c->txEndUs[c->txHead] <= nowUs) {
+            c->txHead = (c->txHead + 1) % c->cfg.queueMax;
+            c->txCount--;
+        }
+        if (c->txEndUs && c->txCount >= c->cfg.queueMax) {
+            c->dropped++;
+            return 0;
+        }
+        if (c->linkFreeUs > t) {
+            t = c->linkFreeUs;
+        }
+        t += (long long)len * 8 * 1000000 / c->cfg.rateBps;
+        c->linkFreeUs = t;
+        if (c->txEndUs) {
+            c->txEndUs[(c->txHead + c->txCount) % c->cfg.queueMax] = t;
+            c->txCount++;
+        }
+    }
+    t += c->cfg.delayUs;
+    if (c->cfg.jitterUs > 0) {
+        t += (long long)(chanRandom(c) * (double)c->cfg.jitterUs);
+    }
+    if (chance(c, c->cfg.reorder)) {
+        t += c->cfg.reorderUs;
+        c->reordered++;
+    }
+    releaseUs[0] = t;
+    if (chance(c, c->cfg.dup)) {
+        releaseUs[1] = t;
+        c->duplicated++;
+        n = 2;
+    }
+    return n;
+}
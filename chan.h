@@ -0,0 +1,111 @@
+/* chan.h - reproduzierbares Kanalmodell (Verlust, Verzögerung, Umordnung)
+ *
+ * Ersetzt den Verlust über rand(): jeder Kanal hat einen eigenen, per Seed
+ * festgelegten Zufallsgenerator, damit Läufe mit gleichem Seed dieselben
+ * Pakete verlieren. Verwendet im Server (-r/-a, nur Verlust) und im lokalen
+ * UDP-Proxy proxy.c (zusätzlich Verzögerung, Jitter, Umordnung, Duplikate
+ * und Ratenbegrenzung).
+ *
+ * Beschreibung als Text, Schlüssel durch Kommas getrennt, z.B.
+ *   "loss=0.05,seed=7"
+ *   "ge=0.01:0.3,delay=20,jitter=5,reorder=0.02:30,rate=10m"
+ *   "replay=logs/T3_pktloss.log"
+ * Eine Zahl ohne Schlüssel ("0.1", "0.1,seed=3") steht für loss=.
+ *
+ * Schlüssel (Zeiten in ms):
+ *   loss=<p>                 unabhängiger Verlust
+ *   ge=<p>:<r>[:<bad>[:<good>]]  Gilbert-Elliott-Burstverlust: p gut->schlecht,
+ *                            r schlecht->gut, Verlust im Zustand (Default 1 / 0)
+ *   delay=<ms>, jitter=<ms>  feste Verzögerung + gleichverteilter Zuschlag
+ *   reorder=<p>[:<ms>]       Anteil p um ms (Default 10) zusätzlich verzögern
+ *   dup=<p>                  Anteil p doppelt zustellen
+ *   rate=<bit/s>[k|m|g]      Engpassrate, queue=<n> Drop-Tail-Grenze
+ *   seed=<n>                 Startwert des Zufallsgenerators (Default 1)
+ *   replay=<datei>           Verlustplan: Server-Log aus logs/ (Zeilen
+ *                            "Request packet DROPPED" / "ACK DROPPED") oder
+ *                            Folge von 0/1; danach gilt das übrige Modell
+ */
+
+#ifndef CHAN_H_INCLUDED
+#define CHAN_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CHAN_DIR_REQ   0   /* Client -> Server (Requests)  */
+#define CHAN_DIR_ACK   1   /* Server -> Client (Antworten) */
+
+#define CHAN_SEED_DEFAULT    1
+#define CHAN_QUEUE_DEFAULT   1000   /* Proxy: max. Pakete im Engpass je Richtung */
+
+/* Einstellungen eines Kanals (von chanParse gefüllt) */
+struct chan_cfg {
+    double         loss;          /* unabhängiger Verlust (Bernoulli)             */
+    int            ge;            /* Gilbert-Elliott aktiv                         */
+    double         geP, geR;      /* Übergang gut->schlecht bzw. schlecht->gut     */
+    double         geLossGood;    /* Verlust im guten Zustand (1-k)                */
+    double         geLossBad;     /* Verlust im schlechten Zustand (1-h)           */
+    long           delayUs;       /* feste Verzögerung                             */
+    long           jitterUs;      /* + gleichverteilt 0..jitterUs                  */
+    double         reorder;       /* Anteil Pakete, die zusätzlich warten ...      */
+    long           reorderUs;     /* ... und so von späteren überholt werden       */
+    double         dup;           /* Anteil doppelt zugestellter Pakete            */
+    long long      rateBps;       /* Engpassrate in Bit/s, 0 = unbegrenzt          */
+    int            queueMax;      /* Pakete im Engpass, darüber Drop-Tail          */
+    uint64_t       seed;
+    unsigned char *sched;         /* Verlustplan (1 = verwerfen), NULL = keiner    */
+    size_t         schedLen;
+};
+
+/* Laufzeitzustand eines Kanals */
+struct chan {
+    struct chan_cfg cfg;
+    uint64_t        rng;
+    int             geBad;        /* Gilbert-Elliott: im schlechten Zustand        */
+    size_t          schedPos;
+    long long       linkFreeUs;   /* Ratenbegrenzung: Leitung frei ab              */
+    long long      *txEndUs;      /* ... Serialisierungsende der Pakete im Engpass  */
+    int             txHead, txCount; /* (Ring mit queueMax Einträgen)              */
+    unsigned long   packets, dropped, duplicated, reordered;
+};
+
+/*
+ * chanParse: Beschreibung spec in cfg übernehmen (cfg vorher mit Defaults
+ * belegt). dir wählt bei replay= die Richtung aus einem Server-Log.
+ * Rückgabe: 0 bei Erfolg, <0 bei Fehler (Meldung auf stderr).
+ */
+void chanDefaults(struct chan_cfg *cfg);
+int chanParse(struct chan_cfg *cfg, const char *spec, int dir);
+void chanFree(struct chan_cfg *cfg);
+
+/* Nur Verlust konfiguriert (in-process nutzbar)? 1 = ja */
+int chanLossOnly(const struct chan_cfg *cfg);
+
+/* Kurzbeschreibung für Startmeldungen */
+void chanDescribe(const struct chan_cfg *cfg, char *buf, size_t len);
+
+/*
+ * chanInit: Kanal aus cfg anlegen. stream trennt mehrere Kanäle mit gleichem
+ * Seed (z.B. Worker-Nummer, Richtung), damit sie nicht dieselbe Folge ziehen.
+ * Der Verlustplan wird nur referenziert, cfg muss weiterleben.
+ * Mit Ratenbegrenzung legt chanInit die Engpass-Warteschlange an (chanRelease).
+ */
+void chanInit(struct chan *c, const struct chan_cfg *cfg, unsigned int stream);
+void chanRelease(struct chan *c);
+
+/* Gleichverteilte Zufallszahl in [0, 1) */
+double chanRandom(struct chan *c);
+
+/* Verlustentscheidung für das nächste Paket: 1 = verwerfen */
+int chanDrop(struct chan *c);
+
+/*
+ * chanSchedule: volles Modell für ein Paket der Länge len, das zur Zeit nowUs
+ * ankommt. Drop-Tail zählt nur Pakete, deren Serialisierung im Engpass noch
+ * nicht beendet ist, nicht die, die danach nur die Verzögerung abwarten.
+ * Rückgabe: Anzahl Zustellungen (0 = verworfen, 1, 2 = dupliziert), die
+ * Zustellzeiten stehen in releaseUs[].
+ */
+int chanSchedule(struct chan *c, long long nowUs, size_t len, long long releaseUs[2]);
+
+#endif /* CHAN_H_INCLUDED */
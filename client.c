@@ -1,21 +1,81 @@
+#define _GNU_SOURCE
 #include <stdio.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 #include "data.h"
 #include "config.h"
 #include "clientSy.h"
+#include "cc.h"
+#include "stats.h"
+#include "evcount.h"
+
+/* Coalescing: mehrere Zeilen bzw. Rohdaten in ein Paket bis zur Payload-Größe */
+#define COALESCE_OFF        0   /* eine Zeile pro Paket (readAppUnit)          */
+#define COALESCE_LINE       1   /* ganze Zeilen, REQ_FLAG_LINES                */
+#define COALESCE_BLOCK      2   /* Binärblöcke fester Größe, REQ_FLAG_BLOCK     */
+
+#define COALESCE_READ_SIZE  (64 * 1024) /* Lesepuffer, muss >= ARQ_PAYLOAD_MAX sein */
+#define COALESCE_FLUSH_MS   5           /* max. Wartezeit eines angefangenen Pakets */
+
+/* Sendepfad der Nutzdaten (Coalescing an) */
+#define SEND_COPY           0   /* Lesepuffer, Kopie in den Ringpuffer          */
+#define SEND_MMAP           1   /* Datei per mmap, Ringpuffer referenziert sie  */
+#define SEND_ZEROCOPY       2   /* wie SEND_MMAP, zusätzlich MSG_ZEROCOPY       */
+
+/* Read-ahead: Lese-Thread füllt einen Ring fertiger Pakete vor dem Sender */
+#define READAHEAD_MAX       65536       /* Pakete im Ring                           */
+#define READAHEAD_BYTES_MAX (64L * 1024 * 1024) /* ... mal max. Nutzdaten je Paket (-x)  */
+
+struct coalescer {
+    int    fd;
+    int    mode;                    /* COALESCE_LINE / COALESCE_BLOCK       */
+    int    flushMs;                 /* Flush-Deadline in Millisekunden      */
+    size_t payload;                 /* max. Nutzdaten pro Paket (arqGetPayload) */
+    size_t pos, len;                /* ungelesener Bereich src[pos..len)    */
+    int    eof;
+    int    idle;                    /* letztes Paket wegen Deadline gesendet */
+    const char *src;                /* buf oder die per mmap eingeblendete Datei */
+    char   buf[COALESCE_READ_SIZE];
+};
 
 /* usage-Ausgabe */
 static void usage(const char *progName)
 {
-    fprintf(stderr, "Usage: %s -a <server> -p <port> -f <file> -w <window>\n", progName);
+    fprintf(stderr, "Usage: %s -a <server> -p <port> -f <file> -w <window> [-m <mode>] [-e <engine>] [-b <batch>] [-c <coalesce>[:ms]] [-k <cc>] [-d <dupacks>] [-t <trace>] [-z <send>] [-r <depth>] [-o on|off] [-x <bytes>]\n", progName);
     fprintf(stderr, "       -a <server> : Server-Adresse (Default: %s)\n",
             (DEFAULT_SERVER == NULL) ? "loopback" : DEFAULT_SERVER);
     fprintf(stderr, "       -p <port>   : Server-Port (Default: %s)\n", DEFAULT_PORT);
     fprintf(stderr, "       -f <file>   : Eingabedatei\n");
-    fprintf(stderr, "       -w <window> : Fenstergröße (1..10)\n");
+    fprintf(stderr, "       -w <window> : Fenstergröße in Paketen (1..%d, im Hello ausgehandelt)\n",
+            ARQ_MAX_WINDOW);
+    fprintf(stderr, "       -m <mode>   : ARQ-Modus gbn|sr (Default: gbn)\n");
+    fprintf(stderr, "       -e <engine> : Sende-Engine event|slot (Default: event)\n");
+    fprintf(stderr, "       -b <batch>  : Datagramme pro sendmmsg/recvmmsg (1..%d, Default: %d)\n",
+            ARQ_BATCH_MAX, ARQ_BATCH_DEFAULT);
+    fprintf(stderr, "       -c <coal>   : Pakete füllen off|line|block, optional :ms Flush-Deadline\n");
+    fprintf(stderr, "                     (Default: off = eine Zeile pro Paket, Deadline %d ms)\n", COALESCE_FLUSH_MS);
+    fprintf(stderr, "       -k <cc>     : Staukontrolle none|reno|bbr (Default: none = festes Fenster)\n");
+    fprintf(stderr, "       -d <dupacks>: Fast Retransmit nach so vielen doppelten ACKs (Default: %d, 0 = aus)\n",
+            ARQ_DUPACK_THRESH);
+    fprintf(stderr, "       -t <trace>  : CSV-Trace von Fenster und Rate in Datei schreiben\n");
+    fprintf(stderr, "       -z <send>   : Sendepfad copy|mmap|zc (Default: mmap, nur reguläre Dateien;\n");
+    fprintf(stderr, "                     zc = zusätzlich MSG_ZEROCOPY)\n");
+    fprintf(stderr, "       -r <depth>  : Lese-Thread hält bis zu depth Pakete vorrätig (..%d, Default: 0 = aus;\n"
+                    "                     nicht bei mmap, dort liest der Kernel voraus)\n", READAHEAD_MAX);
+    fprintf(stderr, "       -o on|off   : 0-RTT, erste Daten im Hello, CLOSE im letzten Paket (Default: off)\n");
+    fprintf(stderr, "       -x <bytes>  : max. Nutzdaten je Paket (%d..%d, Default: %d), mehr als %d nach\n"
+                    "                     Zusage des Servers und Pfad-MTU-Probe\n",
+            BufferSize, ARQ_PAYLOAD_MAX, ARQ_PAYLOAD_MAX, BufferSize);
     exit(EXIT_FAILURE);
 }
 
@@ -45,6 +105,275 @@ static int readAppUnit(struct app_unit *app, FILE *f)
     return app->len;                       // <-- WICHTIG
 }
 
+static long long nowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Lesepuffer nachfüllen. timeoutMs < 0: blockierend warten.
+ *
+ * - Rückgabewerte:
+ *        1 : Daten gelesen oder EOF erreicht
+ *        0 : Deadline abgelaufen, keine neuen Daten
+ *       <0 : Fehler
+ */
+static int coalesceFill(struct coalescer *c, int timeoutMs)
+{
+    if (c->pos > 0) {
+        memmove(c->buf, c->buf + c->pos, c->len - c->pos);
+        c->len -= c->pos;
+        c->pos = 0;
+    }
+
+    if (timeoutMs >= 0) {
+        struct pollfd pfd = { .fd = c->fd, .events = POLLIN };
+        int rc = poll(&pfd, 1, timeoutMs);
+        if (rc < 0 && errno != EINTR) return -1;
+        if (rc <= 0) return 0;
+    }
+
+    for (;;) {
+        ssize_t n = read(c->fd, c->buf + c->len, sizeof(c->buf) - c->len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) c->eof = 1;
+        c->len += (size_t)n;
+        return 1;
+    }
+}
+
+/* Nächstes Paket zusammenstellen, *data zeigt in den Lesepuffer (gültig bis zum
+ * nächsten Aufruf) bzw. in die eingeblendete Datei (gültig bis munmap). Zeilenmodus: nur ganze Zeilen, außer eine Zeile ist länger
+ * als die Payload oder die Flush-Deadline ist abgelaufen.
+ *
+ * - Rückgabewerte:
+ *        > 0 : Länge der Nutzdaten
+ *        = 0 : EOF (keine Daten mehr)
+ *        < 0 : Fehler
+ */
+static long coalesceNext(struct coalescer *c, const char **data)
+{
+    long long deadline = 0;
+    int expired = 0;
+
+    c->idle = 0;
+    for (;;) {
+        size_t avail = c->len - c->pos;
+
+        if (avail > 0 && (avail >= c->payload || c->eof || expired)) {
+            const char *p = c->src + c->pos;
+            size_t take = (avail < c->payload) ? avail : c->payload;
+
+            if (c->mode == COALESCE_LINE && avail > take && !expired) {
+                const char *nl = memrchr(p, '\n', take);
+                if (nl) take = (size_t)(nl - p) + 1;
+            }
+            c->pos += take;
+            c->idle = expired;
+            *data = p;
+            return (long)take;
+        }
+        if (avail == 0 && c->eof) return 0;
+
+        /* Weitere Daten abwarten, ein angefangenes Paket höchstens flushMs lang */
+        int timeout = -1;
+        if (avail > 0) {
+            if (deadline == 0) deadline = nowMs() + c->flushMs;
+            long long left = deadline - nowMs();
+            timeout = (left > 0) ? (int)left : 0;
+        }
+        int rc = coalesceFill(c, timeout);
+        if (rc < 0) return -1;
+        if (rc == 0) expired = 1;
+    }
+}
+
+/* Read-ahead-Ring: genau ein Produzent (Lese-Thread, tail) und ein Konsument
+ * (Hauptthread, head), ohne Lock; tail/head per release/acquire veröffentlicht,
+ * bei vollem bzw. leerem Ring wird per Eventcount (evcount.h) geschlafen */
+struct ra_unit {
+    unsigned long len;
+    int           idle;             /* Flush-Deadline abgelaufen -> nach dem Einreihen arqPush */
+    char          data[];           /* bis readahead.payload Bytes */
+};
+
+struct readahead {
+    unsigned char    *ring;         /* Einträge zu je stride Bytes            */
+    unsigned long     mask;
+    size_t            stride;
+    size_t            payload;      /* max. Nutzdaten je Eintrag (Zusage)     */
+    FILE             *fp;           /* COALESCE_OFF: readAppUnit              */
+    struct coalescer *co;           /* sonst coalesceNext                     */
+    pthread_t         thread;
+    unsigned long     tail __attribute__((aligned(64)));
+    int               done;         /* nach dem letzten Paket: 1 = EOF, -1 = Lesefehler */
+    struct evcount    notEmpty;     /* Leser weckt den wartenden Sender       */
+    unsigned long     head __attribute__((aligned(64)));
+    int               stop;         /* Sender bricht ab: Leser beendet sich   */
+    struct evcount    notFull;      /* Sender weckt den wartenden Leser       */
+};
+
+/* Leser: Ring voll und kein Abbruch */
+static int raFull(struct readahead *ra, unsigned long tail)
+{
+    return tail - __atomic_load_n(&ra->head, __ATOMIC_ACQUIRE) > ra->mask &&
+           !__atomic_load_n(&ra->stop, __ATOMIC_ACQUIRE);
+}
+
+static struct ra_unit *raUnit(struct readahead *ra, unsigned long pos)
+{
+    return (struct ra_unit *)(ra->ring + (pos & ra->mask) * ra->stride);
+}
+
+/* Lese-Thread: Pakete wie bisher bilden, aber in den Ring statt direkt zum Sender */
+static void *readAheadThread(void *arg)
+{
+    struct readahead *ra = arg;
+    unsigned long tail = 0;
+    int done = 0;
+
+    while (!done) {
+        struct ra_unit *u;
+        long n;
+
+        while (raFull(ra, tail)) {
+            /* Ring voll: Sender ist der Engpass */
+            unsigned int key = evPrepare(&ra->notFull);
+            if (raFull(ra, tail)) {
+                evWait(&ra->notFull, key);
+            } else {
+                evCancel(&ra->notFull);
+            }
+        }
+        if (__atomic_load_n(&ra->stop, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+        u = raUnit(ra, tail);
+        if (ra->co == NULL) {
+            struct app_unit app;
+            n = readAppUnit(&app, ra->fp);
+            if (n > 0) memcpy(u->data, app.data, (size_t)n);
+            u->idle = 0;
+        } else {
+            const char *data;
+            size_t payload = arqGetPayload(); /* wächst mit bestandenen Proben */
+            ra->co->payload = (payload < ra->payload) ? payload : ra->payload;
+            n = coalesceNext(ra->co, &data);
+            if (n > 0) memcpy(u->data, data, (size_t)n);
+            u->idle = ra->co->idle;
+        }
+        if (n <= 0) {
+            done = (n < 0) ? -1 : 1;
+            __atomic_store_n(&ra->done, done, __ATOMIC_RELEASE);
+            evSignal(&ra->notEmpty);
+            break;
+        }
+        u->len = (unsigned long)n;
+        tail++;
+        __atomic_store_n(&ra->tail, tail, __ATOMIC_RELEASE);
+        evSignal(&ra->notEmpty);
+    }
+    return NULL;
+}
+
+/*
+ * sendReadAhead: Datei über den Lese-Thread senden. Der Hauptthread reiht nur
+ * fertige Pakete ein; ist der Ring leer, arbeitet er ACKs ab (arqPoll), statt
+ * auf den Leser zu warten, und schläft erst, wenn nichts mehr unterwegs ist.
+ *
+ * - Rückgabewerte:
+ *        0 : alles eingereiht
+ *       -1 : Fehler beim Senden
+ *       -2 : Fehler beim Lesen
+ */
+static int sendReadAhead(struct readahead *ra, int depth, unsigned int flags, int winSize,
+                         unsigned long *packets, unsigned long *bytes)
+{
+    unsigned long n = 1, head = 0, tail;
+    unsigned long waits = 0;
+    int rc = 0;
+
+    ra->stride = (offsetof(struct ra_unit, data) + ra->payload + 7) & ~(size_t)7;
+    while (n < (unsigned long)depth && n < READAHEAD_MAX &&
+           (long)(2 * n * ra->stride) <= READAHEAD_BYTES_MAX) {
+        n <<= 1;
+    }
+    ra->ring = malloc(n * ra->stride);
+    if (!ra->ring) {
+        perror("malloc");
+        return -1;
+    }
+    ra->mask = n - 1;
+    if (pthread_create(&ra->thread, NULL, readAheadThread, ra) != 0) {
+        fprintf(stderr, "Client: cannot start read-ahead thread\n");
+        free(ra->ring);
+        return -1;
+    }
+
+    for (;;) {
+        tail = __atomic_load_n(&ra->tail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            /* done wird nach dem letzten Paket gesetzt: danach tail erneut lesen */
+            int done = __atomic_load_n(&ra->done, __ATOMIC_ACQUIRE);
+            if (done && __atomic_load_n(&ra->tail, __ATOMIC_ACQUIRE) == head) {
+                if (done < 0) rc = -2;
+                break;
+            }
+            /* Leser hängt hinterher: Angefangenes senden, bis dahin ACKs abarbeiten */
+            waits++;
+            STAT_INC(ST_READAHEAD_EMPTY);
+            if (arqPush(winSize) != 0) {
+                rc = -1;
+                break;
+            }
+            int left = arqPoll(winSize);
+            if (left < 0) {
+                rc = -1;
+                break;
+            }
+            if (left == 0) {
+                /* nichts unterwegs: schlafen, bis der Leser ein Paket oder done liefert */
+                unsigned int key = evPrepare(&ra->notEmpty);
+                if (__atomic_load_n(&ra->tail, __ATOMIC_ACQUIRE) == head &&
+                    !__atomic_load_n(&ra->done, __ATOMIC_ACQUIRE)) {
+                    evWait(&ra->notEmpty, key);
+                } else {
+                    evCancel(&ra->notEmpty);
+                }
+            }
+            continue;
+        }
+
+        struct ra_unit *u = raUnit(ra, head);
+        if (arqEnqueueBuf(u->data, u->len, flags, winSize) != 0 ||
+            (u->idle && arqPush(winSize) != 0)) {
+            rc = -1;
+            break;
+        }
+        (*packets)++;
+        *bytes += u->len;
+        head++;
+        __atomic_store_n(&ra->head, head, __ATOMIC_RELEASE);
+        evSignal(&ra->notFull);
+    }
+
+    if (rc == -1) {
+        /* Leser beenden: wartet er auf Platz, weckt ihn notFull, in read()
+         * (Pipe) kann er nur abgebrochen werden */
+        __atomic_store_n(&ra->stop, 1, __ATOMIC_RELEASE);
+        evSignal(&ra->notFull);
+        pthread_cancel(ra->thread);
+    }
+    pthread_join(ra->thread, NULL);
+    free(ra->ring);
+    printf("Client: read-ahead %lu packets, sender waited %lu times for input\n", n, waits);
+    return rc;
+}
+
 
 int main(int argc, char *argv[])
 {
@@ -52,6 +381,21 @@ int main(int argc, char *argv[])
     const char *filename   = NULL;
     const char *port       = DEFAULT_PORT;
     const char *windowSize = "1";
+    int         arqMode    = ARQ_MODE_GBN;
+    int         arqEngine  = ARQ_ENGINE_EVENT;
+    int         batchSize  = ARQ_BATCH_DEFAULT;
+    int         coalesce   = COALESCE_OFF;
+    int         flushMs    = COALESCE_FLUSH_MS;
+    int         ccAlgo     = CC_NONE;
+    int         dupAcks    = ARQ_DUPACK_THRESH;
+    const char *traceFile  = NULL;
+    FILE       *traceFp    = NULL;
+    int         sendPath   = SEND_MMAP;
+    char       *map        = NULL;
+    size_t      mapLen     = 0;
+    int         readAhead  = 0;
+    int         fastOpen   = 0;
+    long        payloadMax = ARQ_PAYLOAD_MAX;
 
     FILE *fp = NULL;
     long i;
@@ -96,6 +440,141 @@ int main(int argc, char *argv[])
                     usage(argv[0]);
                     break;
 
+                case 'm': /* ARQ-Modus */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        ++i;
+                        if (strcmp(argv[i], "sr") == 0) {
+                            arqMode = ARQ_MODE_SR;
+                        } else if (strcmp(argv[i], "gbn") == 0) {
+                            arqMode = ARQ_MODE_GBN;
+                        } else {
+                            usage(argv[0]);
+                        }
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'e': /* Sende-Engine */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        ++i;
+                        if (strcmp(argv[i], "slot") == 0) {
+                            arqEngine = ARQ_ENGINE_SLOT;
+                        } else if (strcmp(argv[i], "event") == 0) {
+                            arqEngine = ARQ_ENGINE_EVENT;
+                        } else {
+                            usage(argv[0]);
+                        }
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'b': /* Batchgröße */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        batchSize = atoi(argv[++i]);
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'k': /* Staukontrolle */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        ccAlgo = ccParse(argv[++i]);
+                        if (ccAlgo < 0) {
+                            usage(argv[0]);
+                        }
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'd': /* Schwelle für Fast Retransmit */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        dupAcks = atoi(argv[++i]);
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 't': /* Trace-Datei */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        traceFile = argv[++i];
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'z': /* Sendepfad der Nutzdaten */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        ++i;
+                        if (strcmp(argv[i], "copy") == 0) {
+                            sendPath = SEND_COPY;
+                        } else if (strcmp(argv[i], "mmap") == 0) {
+                            sendPath = SEND_MMAP;
+                        } else if (strcmp(argv[i], "zc") == 0) {
+                            sendPath = SEND_ZEROCOPY;
+                        } else {
+                            usage(argv[0]);
+                        }
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'r': /* Read-ahead-Tiefe */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        readAhead = atoi(argv[++i]);
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'o': /* 0-RTT */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        ++i;
+                        if (strcmp(argv[i], "on") == 0) {
+                            fastOpen = 1;
+                        } else if (strcmp(argv[i], "off") == 0) {
+                            fastOpen = 0;
+                        } else {
+                            usage(argv[0]);
+                        }
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'x': /* max. Nutzdaten je Paket */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        payloadMax = atol(argv[++i]);
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'c': /* Coalescing-Modus [:Flush-Deadline] */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        char *ms = strchr(argv[++i], ':');
+                        size_t n = ms ? (size_t)(ms - argv[i]) : strlen(argv[i]);
+                        if (n == 3 && strncmp(argv[i], "off", n) == 0) {
+                            coalesce = COALESCE_OFF;
+                        } else if (n == 4 && strncmp(argv[i], "line", n) == 0) {
+                            coalesce = COALESCE_LINE;
+                        } else if (n == 5 && strncmp(argv[i], "block", n) == 0) {
+                            coalesce = COALESCE_BLOCK;
+                        } else {
+                            usage(argv[0]);
+                        }
+                        if (ms) {
+                            flushMs = atoi(ms + 1);
+                            if (flushMs < 0) usage(argv[0]);
+                        }
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
                 default:
                     usage(argv[0]);
                     break;
@@ -109,25 +588,69 @@ int main(int argc, char *argv[])
     if (!filename) {
         usage(argv[0]);
     }
+    if (payloadMax < BufferSize) payloadMax = BufferSize;
+    if (payloadMax > ARQ_PAYLOAD_MAX) payloadMax = ARQ_PAYLOAD_MAX;
+    if (coalesce == COALESCE_OFF) {
+        payloadMax = BufferSize; /* eine Zeile pro Paket: nie mehr als BufferSize, keine Proben */
+    }
 
     /* TODO:
      *   - Datei filename zum Lesen öffnen (z.B. fopen)
      *   - bei Fehler: perror / Fehlermeldung und EXIT_FAILURE
      *   - bei Erfolg: FILE* in fp ablegen
      */
-    fp = fopen(filename, "r");
+    fp = fopen(filename, "rb");
     if (!fp) {
         perror("fopen");
         fprintf(stderr, "Client: failed to open file '%s'.\n", filename);
         return EXIT_FAILURE;
     }
 
+    if (traceFile) {
+        traceFp = fopen(traceFile, "w");
+        if (!traceFp) {
+            perror("fopen");
+            fprintf(stderr, "Client: failed to open trace file '%s'.\n", traceFile);
+            fclose(fp);
+            return EXIT_FAILURE;
+        }
+    }
+
     printf("Client: sending file '%s'\n", filename);
 
     /* ARQ-Client initialisieren */
     initClient((char *)server, port);
 
-    /* Hello/Verbindungsaufbau */
+    /* Hello/Verbindungsaufbau (ARQ-Modus wird dabei ausgehandelt) */
+    arqSetMode(arqMode);
+    {
+        /* Größe nur bei regulären Dateien ankündigen (Pipes/FIFOs: unbekannt) */
+        struct stat st;
+        if (fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode)) {
+            arqSetFileSize((unsigned long long)st.st_size);
+
+            /* Coalescing: Datei einblenden, Pakete zeigen direkt in den Page-Cache */
+            if (coalesce != COALESCE_OFF && sendPath != SEND_COPY && st.st_size > 0) {
+                map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+                if (map == MAP_FAILED) {
+                    perror("mmap, reading with copies");
+                    map = NULL;
+                } else {
+                    mapLen = (size_t)st.st_size;
+                    madvise(map, mapLen, MADV_SEQUENTIAL);
+                }
+            }
+        }
+    }
+    arqSetZeroCopy(map != NULL && sendPath == SEND_ZEROCOPY);
+    arqSetEngine(arqEngine);
+    arqSetBatchSize(batchSize);
+    arqSetCongestion(ccAlgo);
+    arqSetDupAckThreshold(dupAcks);
+    arqSetTrace(traceFp);
+    arqSetFastOpen(fastOpen);
+    arqSetPayloadMax((unsigned long)payloadMax);
+    statsInstallSignal("Client"); /* kill -USR1: Zwischenstand nach stderr */
     if (arqSendHello(atoi(windowSize)) != 0) {
         fprintf(stderr, "Client: Hello failed, aborting.\n");
         /* TODO: Datei ggf. schließen, falls sie bereits geöffnet wurde */
@@ -135,20 +658,35 @@ int main(int argc, char *argv[])
             fclose(fp);
         }
         closeClient();
+        if (map) {
+            munmap(map, mapLen);
+        }
+        if (traceFp) {
+            fclose(traceFp);
+        }
         return EXIT_FAILURE;
     }
 
+    /* 0-RTT: Hello geht erst mit den Daten raus, ausgehandelt ist dann nach dem Close */
+    if (!fastOpen) {
+        printf("Client: ARQ mode %s, window %d, congestion control %s\n",
+               (arqGetMode() == ARQ_MODE_SR) ? "Selective Repeat" : "Go-Back-N",
+               (atoi(windowSize) < arqGetWindow()) ? atoi(windowSize) : arqGetWindow(),
+               (ccAlgo == CC_RENO) ? "reno" : (ccAlgo == CC_BBR) ? "bbr" : "none");
+    }
+
     /* Datei -> zeilenweise lesen und jede Zeile als app_unit an 
 	 * arqSendData() übergeben 
      *
      *   - Fehlerfall (readAppUnit(..) < 0) behandeln
      */
-    {
+    if (coalesce == COALESCE_OFF && readAhead <= 0) {
         struct app_unit app;
         int readResult;
         
         while ((readResult = readAppUnit(&app, fp)) > 0) {
-            if (arqSendData(&app, atoi(windowSize)) != 0) {
+            /* pipelined: nur einreihen, gesendet wird im Fenster (blockiert bei vollem Ringpuffer) */
+            if (arqEnqueueData(&app, atoi(windowSize)) != 0) {
                 fprintf(stderr, "Client: error while sending data.\n");
                 break;
             }
@@ -157,12 +695,104 @@ int main(int argc, char *argv[])
         if (readResult < 0) {
             fprintf(stderr, "Client: error reading file.\n");
         }
+    } else {
+        /* Coalescing: Datei blockweise lesen und Pakete bis zur Payload-Größe füllen */
+        static struct coalescer co;
+        unsigned int flags = (coalesce == COALESCE_BLOCK) ? REQ_FLAG_BLOCK :
+                             (coalesce == COALESCE_LINE) ? REQ_FLAG_LINES : 0;
+        unsigned long packets = 0, bytes = 0;
+        const char *data;
+        long n;
+
+        co.fd      = fileno(fp);
+        co.mode    = coalesce;
+        co.flushMs = flushMs;
+        co.payload = arqGetPayload();
+        co.src     = co.buf;
+        if (map) {
+            /* ganze Datei liegt schon vor: kein read, kein Warten auf die Deadline */
+            co.src = map;
+            co.len = mapLen;
+            co.eof = 1;
+        }
+
+        if (readAhead > 0 && !map) {
+            /* Lese-Thread bildet die Pakete (readAppUnit bzw. coalesceNext) im Voraus */
+            static struct readahead ra;
+            ra.fp = fp;
+            ra.payload = arqGetPayloadMax(); /* Zusage aus dem HELLO */
+            ra.co = (coalesce == COALESCE_OFF) ? NULL : &co;
+            int rc = sendReadAhead(&ra, readAhead, flags, atoi(windowSize), &packets, &bytes);
+            if (rc == -1) {
+                fprintf(stderr, "Client: error while sending data.\n");
+            }
+            n = (rc == -2) ? -1 : 0;
+        } else {
+            for (;;) {
+                /* Paketgröße folgt der Pfad-MTU-Suche (bestätigte Nutzdaten) */
+                co.payload = arqGetPayload();
+                if ((n = coalesceNext(&co, &data)) <= 0) {
+                    break;
+                }
+                /* aus der Abbildung nur referenzieren, der Lesepuffer wird überschrieben */
+                int rc = map ? arqEnqueueRef(data, (unsigned long)n, flags, atoi(windowSize))
+                             : arqEnqueueBuf(data, (unsigned long)n, flags, atoi(windowSize));
+                if (rc != 0) {
+                    fprintf(stderr, "Client: error while sending data.\n");
+                    break;
+                }
+                /* Eingabe stockt -> angefangene Pakete nicht im Ringpuffer liegen lassen */
+                if (co.idle && arqPush(atoi(windowSize)) != 0) {
+                    fprintf(stderr, "Client: error while sending data.\n");
+                    break;
+                }
+                packets++;
+                bytes += (unsigned long)n;
+            }
+        }
+
+        if (n < 0) {
+            fprintf(stderr, "Client: error reading file.\n");
+        }
+        printf("Client: %lu bytes in %lu packets (%s coalescing, %s)\n", bytes, packets,
+               (coalesce == COALESCE_BLOCK) ? "block" : (coalesce == COALESCE_LINE) ? "line" : "no",
+               !map ? "copied" : (sendPath == SEND_ZEROCOPY) ? "mmap + MSG_ZEROCOPY" : "mmap");
+    }
+
+    /* RTT-Schätzung protokollieren */
+    {
+        struct arq_rtt_info rtt;
+        arqGetRttInfo(&rtt);
+        printf("Client: RTT srtt=%ld us, rttvar=%ld us, rto=%ld us (backoff %d, %lu samples)\n",
+               rtt.srtt_us, rtt.rttvar_us, rtt.rto_us, rtt.backoff, rtt.samples);
     }
 
-    /* Close / Verbindungsabbau */
+    /* Close / Verbindungsabbau (wartet, bis alle eingereihten Zeilen bestätigt sind) */
     if (arqSendClose(atoi(windowSize)) != 0) {
         fprintf(stderr, "Client: error while sending close.\n");
     }
+    if (fastOpen) {
+        printf("Client: ARQ mode %s, window %d, congestion control %s (0-RTT)\n",
+               (arqGetMode() == ARQ_MODE_SR) ? "Selective Repeat" : "Go-Back-N",
+               (atoi(windowSize) < arqGetWindow()) ? atoi(windowSize) : arqGetWindow(),
+               (ccAlgo == CC_RENO) ? "reno" : (ccAlgo == CC_BBR) ? "bbr" : "none");
+    }
+    printf("Client: payload %lu bytes per packet (granted %lu)\n", arqGetPayload(), arqGetPayloadMax());
+
+    /* I/O-Zähler: Datagramme pro Systemaufruf zeigen die Ersparnis durch das Bündeln */
+    {
+        struct arq_io_stats io;
+        arqGetIoStats(&io);
+        printf("Client: I/O tx %lu packets in %lu sendmmsg (%.1f/call), rx %lu answers in %lu calls (%.1f/call)\n",
+               io.tx_packets, io.tx_calls, io.tx_calls ? (double)io.tx_packets / (double)io.tx_calls : 0.0,
+               io.rx_packets, io.rx_calls, io.rx_calls ? (double)io.rx_packets / (double)io.rx_calls : 0.0);
+        printf("Client: %lu packets retransmitted, %lu fast retransmits\n", io.tx_retrans, io.fast_retrans);
+        if (io.zc_copied > 0) {
+            printf("Client: %lu MSG_ZEROCOPY completions reported copied data (e.g. loopback)\n",
+                   io.zc_copied);
+        }
+    }
+    statsReport(stdout, "Client");
 
     /* TODO:
      *   - geöffnete Datei wieder schließen
@@ -171,6 +801,12 @@ int main(int argc, char *argv[])
         fclose(fp);
     }
     closeClient();
+    if (map) {
+        munmap(map, mapLen); /* erst nach dem Close, der Ringpuffer zeigt hinein */
+    }
+    if (traceFp) {
+        fclose(traceFp);
+    }
 
     return EXIT_SUCCESS;
 }
@@ -1,4 +1,4 @@
-#define _POSIX_C_SOURCE 200112L // Testweise eingebaut: könnte Fehler vermeiden
+#define _GNU_SOURCE // epoll/timerfd (Event-Engine)
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
@@ -10,115 +10,533 @@
 #include <netdb.h>
 #include <sys/time.h>
 #include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/random.h>
+#include <linux/errqueue.h> // MSG_ZEROCOPY-Abschlussmeldungen
 
 #include "data.h"
 #include "config.h"
 #include "clientSy.h"
+#include "wire.h"
+#include "cc.h"
+#include "stats.h"
 
 /* --------------------------------------------------------------- */
 /*  Globale Transport-Variablen                                    */
 /* --------------------------------------------------------------- */
 
 static int g_sock = -1; // UDP-Socket des Clients
+static int g_epfd = -1; // epoll-Instanz der Event-Engine (Socket + Timer)
+static int g_tfd = -1; // timerfd für den Retransmission-Timer der Event-Engine
+static int g_engine = ARQ_ENGINE_EVENT; // Sende-Engine (ARQ_ENGINE_EVENT / ARQ_ENGINE_SLOT)
 static struct sockaddr_storage g_srv; // Server-Zieladresse (IPv6)
 static socklen_t g_srvlen = 0; // Länge der Socket-/Zieladresse
 
-static unsigned long g_base = 0; // Fensterbasis (ältestes unbestätigtes Paket)
-static unsigned long g_next = 0; // nächste Sequenznummer (neu zu senden)
+// Sequenznummern: 32 Bit mit Überlauf, Vergleiche nur über SEQ_DIFF/SEQ_LT (wire.h)
+static uint32_t g_base = 0; // Fensterbasis (ältestes unbestätigtes Paket)
+static uint32_t g_next = 0; // nächste Sequenznummer (neu zu senden)
+static uint32_t g_tail = 0; // nächste freie Sequenznummer im Ringpuffer (eingereiht, aber ggf. noch nicht gesendet)
 static int g_win = 1; // aktuelle Fenstergröße 
+static int g_winMax = ARQ_MAX_WINDOW; // maximale Fenstergröße, nach dem HELLO die ausgehandelte
 static int g_inFlight = 0; // Anzahl unbestätigter Pakete im Fenster
 
-static struct request g_wbuf[GBN_BUFFER_SIZE]; // Ringpuffer für gesendete Requests
-static int g_wvalid[GBN_BUFFER_SIZE]; // Slot belegt? (0/1)
+// Ringpuffer, zur Laufzeit passend zum Fenster angelegt (ringAlloc), Größe 2er-Potenz
+static uint32_t g_ring = 0; // Anzahl Slots
+static uint32_t g_ringMask = 0; // g_ring - 1
+static unsigned char *g_wbuf = NULL; // gesendete Requests (fertig kodierte Datagramme), je g_wstride Bytes
+static size_t g_wstride = 0; // Slotgröße: Header + gewährte Nutzdaten
+static size_t *g_wlen = NULL; // Länge des Datagramms im Slot (Header + Nutzdaten)
+static const char **g_wref = NULL; // Nutzdaten außerhalb des Slots (z.B. mmap der Eingabe), NULL = liegen in g_wbuf
+static uint32_t *g_wzc = NULL; // MSG_ZEROCOPY: Sendenummer der letzten Übertragung des Slots
+static unsigned char *g_wvalid = NULL; // Slot belegt? (0/1)
+static unsigned char *g_wacked = NULL; // SR: Paket selektiv bestätigt? (0/1)
+static long long *g_wsent = NULL; // Sendezeitpunkt (µs, monoton) der letzten Übertragung
+static unsigned char *g_wretx = NULL; // Paket wurde wiederholt? (Karn: keine RTT-Messung)
+
+static int g_modeWanted = ARQ_MODE_GBN; // per arqSetMode gewünschter ARQ-Modus
+static unsigned long long g_fileSize = 0; // per arqSetFileSize angekündigte Dateigröße (0 = unbekannt)
+static int g_mode = ARQ_MODE_GBN; // im HELLO ausgehandelter ARQ-Modus
+
+// 0-RTT (arqSetFastOpen): HELLO erst mit den ersten Nutzdaten senden, CLOSE ins letzte Paket falten
+static int g_fastOpen = 0; // per arqSetFastOpen gewünscht
+static int g_fastOk = 0; // Server versteht 0-RTT und REQ_FLAG_EOS (HELLO_ANSW_FASTOPEN)
+static int g_helloWin = 0; // HELLO steht noch aus: gewünschtes Fenster (0 = schon gesendet)
+static struct request g_helloReq; // ... mit den bis dahin eingereihten Nutzdaten (FlNr > HELLO_OPT_LEN)
+static int g_eosQueued = 0; // ein eingereihtes Paket trägt REQ_FLAG_EOS, kein CLOSE nötig
+static uint32_t g_eosSeq = 0; // ... dessen Sequenznummer
+static uint32_t g_isn = 0; // Start-Seq. des laufenden Transfers (pickIsn)
+
+// Nutzdatengröße (HELLO_FLAG_PAYLOAD) und Pfad-MTU-Suche per ReqProbe (DPLPMTUD)
+static unsigned long g_payloadWant = ARQ_PAYLOAD_MAX; // per arqSetPayloadMax gewünschte Obergrenze
+static unsigned long g_payloadMax = BufferSize; // im HELLO gewährt, größtes erlaubte Paket
+static unsigned long g_payload = BufferSize; // per Probe bestätigt, für neue Pakete empfohlen (arqGetPayload, atomar)
+static unsigned long g_probeLo = BufferSize; // größte bestätigte Größe
+static unsigned long g_probeHi = BufferSize; // größte noch mögliche Größe
+static unsigned long g_probeCap = BufferSize; // größte lokal sendbare Größe (EMSGSIZE ist endgültig)
+static unsigned long g_probeSize = 0; // zu prüfende Größe (0 = Suche beendet)
+static uint32_t g_probeId = 0; // Nummer der zuletzt gesendeten Probe
+static int g_probeTries = 0; // unbeantwortete Proben dieser Größe
+static long long g_probeSentUs = 0; // Sendezeitpunkt der offenen Probe (0 = keine offen)
+static long long g_probeRaiseUs = 0; // Suche ab hier erneut nach oben (0 = nicht geplant)
+static unsigned char g_probeBuf[WIRE_REQ_MAX]; // Probe: Header + Füllung (Nullen)
 
 /* --------------------------------------------------------------- */
 /*  Go-Back-N Sender State                                         */
 /* --------------------------------------------------------------- */
 
-static int g_timer_units = 0; // Timer für ältestes unbestätigtes Paket (in Slots)
-static int g_retx_active = 0; // 1 = gerade im Retransmit-Modus (Timeout passiert)
-static unsigned long g_retx_next = 0; // nächste Sequenznummer, die retransmittet wird
+static long long g_timer_deadline = 0; // Timer für ältestes unbestätigtes Paket (µs, 0 = aus)
+static int g_retx_active = 0; // 1 = gerade im Retransmit-Modus (Timeout oder Fast Retransmit)
+static uint32_t g_retx_next = 0; // nächste Sequenznummer, die retransmittet wird
+static uint32_t g_retx_end = 0; // Retransmit-Durchlauf endet vor dieser Sequenznummer
+static int g_retx_fast = 0; // 1 = Durchlauf stammt vom Fast Retransmit (Bereich ab g_fastNext)
+
+// Fast Retransmit / Fast Recovery (doppelte kumulative ACKs)
+static int g_dupThresh = ARQ_DUPACK_THRESH; // Schwelle (0 = aus, nur Timeout)
+static int g_dupAcks = 0; // doppelte ACKs für g_base in Folge
+static int g_inRecovery = 0; // 1 = Fast Recovery läuft
+static uint32_t g_recover = 0; // g_next beim Eintritt, Recovery endet mit ACK >= g_recover
+static uint32_t g_fastNext = 0; // SR: Lücken unterhalb sind in dieser Recovery bereits wiederholt
+static uint32_t g_sackHigh = 0; // SR: höchstes selektiv bestätigtes Paket + 1
+static int g_error = 0; // 1 = Server hat AnswErr geschickt (bleibt bis zum nächsten Hello gesetzt)
+static unsigned long g_rwnd = ARQ_MAX_WINDOW; // vom Server gemeldetes Empfangsfenster (Pakete ab base)
+static int g_bpHold = 0; // 1 = Schreib-Queue des Servers voll (ERR_BACKPRESSURE): Senden bis zum Timer anhalten
+static long g_bpPause_us = ARQ_BP_PAUSE_MIN_US; // Pause bis zur Wiederholung, verdoppelt bei anhaltendem Rückstau
+
+static int checkAnswer(const char *who, const struct answer *ans);
 
-// Ringpuffer-Index aus Sequenznummer berechnen
-static inline int idxOf(unsigned long seq) {
-    return (int)(seq % GBN_BUFFER_SIZE);
+/* --------------------------------------------------------------- */
+/*  RTT-Schätzung / adaptiver RTO (RFC 6298)                       */
+/* --------------------------------------------------------------- */
+
+static long g_srtt_us = 0; // geglättete RTT
+static long g_rttvar_us = 0; // RTT-Varianz
+static long g_rto_us = GBN_RTO_INIT_MS * 1000L; // aktueller Retransmission-Timeout (inkl. Backoff)
+static int g_backoff = 0; // Anzahl Verdopplungen seit der letzten gültigen Messung
+static unsigned long g_rtt_samples = 0; // Anzahl gültiger RTT-Messungen
+static long long g_ack_rx_us = 0; // Empfangszeitpunkt des zuletzt gelesenen ACKs (vor dem Idle bis Slotende)
+static long long g_last_answer_us = 0; // Zeitpunkt der letzten Antwort überhaupt (Close-Abbruch)
+
+/* --------------------------------------------------------------- */
+/*  Staukontrolle (cc.c) und Trace                                 */
+/* --------------------------------------------------------------- */
+
+static int g_ccAlgo = CC_NONE; // per arqSetCongestion gewählter Regler
+static struct cc_state g_cc; // Zustand des Reglers, Fenster = min(cwnd, g_win)
+static FILE *g_trace = NULL; // CSV-Trace von Fenster und Rate (NULL = aus)
+static long long g_trace_t0 = 0; // Zeitbasis des Trace (µs)
+
+// Ringpuffer-Index aus Sequenznummer berechnen (g_ring teilt 2^32 -> stetig über den Überlauf)
+static inline int idxOf(uint32_t seq) {
+    return (int)(seq & g_ringMask);
+}
+
+// kodiertes Datagramm im Ringpuffer-Slot idx
+static inline unsigned char *slotBuf(int idx) {
+    return g_wbuf + (size_t)idx * g_wstride;
+}
+
+// monotone Uhr in Mikrosekunden
+static long long nowUs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static long clampRto(long rto) {
+    if (rto < GBN_RTO_MIN_MS * 1000L) rto = GBN_RTO_MIN_MS * 1000L;
+    if (rto > GBN_RTO_MAX_MS * 1000L) rto = GBN_RTO_MAX_MS * 1000L;
+    return rto;
+}
+
+static void resetRttEstimator(void) {
+    g_srtt_us = 0;
+    g_rttvar_us = 0;
+    g_rto_us = GBN_RTO_INIT_MS * 1000L;
+    g_backoff = 0;
+    g_rtt_samples = 0;
+}
+
+// neue RTT-Messung einarbeiten (nur für nicht wiederholte Pakete, Karn)
+static void rttSample(long r) {
+    if (r < 0) return;
+
+    if (g_rtt_samples == 0) {
+        g_srtt_us = r;
+        g_rttvar_us = r / 2;
+    } else {
+        long err = g_srtt_us - r;
+        if (err < 0) err = -err;
+        g_rttvar_us = (3 * g_rttvar_us + err) / 4; // beta = 1/4
+        g_srtt_us = (7 * g_srtt_us + r) / 8; // alpha = 1/8
+    }
+    g_rtt_samples++;
+}
+
+// RTO aus SRTT/RTTVAR neu berechnen und Backoff beenden
+static void rttUpdateRto(void) {
+    if (g_rtt_samples == 0) {
+        g_rto_us = GBN_RTO_INIT_MS * 1000L;
+    } else {
+        long k = 4 * g_rttvar_us;
+        g_rto_us = clampRto(g_srtt_us + (k > GBN_RTO_CLOCK_G_US ? k : GBN_RTO_CLOCK_G_US));
+    }
+    g_backoff = 0;
+}
+
+// Timeout: exponentielles Backoff, bis wieder eine gültige Messung vorliegt
+static void rttBackoff(void) {
+    g_rto_us = clampRto(g_rto_us * 2);
+    g_backoff++;
+}
+
+static void armTimer(void) {
+    g_timer_deadline = nowUs() + g_rto_us;
+}
+
+// eine Zeile Trace: Zeit, Ereignis, Fenster, Rate
+static void ccTrace(const char *event) {
+    if (g_trace == NULL) return;
+    fprintf(g_trace, "%lld,%s,%.2f,%.2f,%d,%d,%ld,%.1f\n",
+            nowUs() - g_trace_t0, event, g_cc.cwnd, g_cc.ssthresh, ccWindow(&g_cc),
+            g_inFlight, g_srtt_us, ccRate(&g_cc, g_srtt_us));
+}
+
+
+
+// Ringpuffer für winSize Pakete mit bis zu payload Bytes Nutzdaten anlegen
+// (mind. 2 * winSize Slots, 2er-Potenz). Wächst nur, der Inhalt ist danach
+// ungültig (Aufrufer setzt den Senderzustand zurück).
+// Rückgabewert: 0 bei Erfolg, <0 wenn kein Speicher.
+static int ringAlloc(int winSize, unsigned long payload) {
+    uint32_t want = 1;
+    size_t stride = (WIRE_REQ_HDR_LEN + (size_t)payload + 7) & ~(size_t)7;
+    while (want < 2u * (uint32_t)winSize) want <<= 1;
+    if (want <= g_ring && stride <= g_wstride) return 0;
+    if (want < g_ring) want = g_ring;
+    if (stride < g_wstride) stride = g_wstride;
+
+    void *wbuf = realloc(g_wbuf, want * stride);
+    if (wbuf) g_wbuf = wbuf;
+    void *wlen = realloc(g_wlen, want * sizeof(*g_wlen));
+    if (wlen) g_wlen = wlen;
+    void *wvalid = realloc(g_wvalid, want);
+    if (wvalid) g_wvalid = wvalid;
+    void *wacked = realloc(g_wacked, want);
+    if (wacked) g_wacked = wacked;
+    void *wsent = realloc(g_wsent, want * sizeof(*g_wsent));
+    if (wsent) g_wsent = wsent;
+    void *wretx = realloc(g_wretx, want);
+    if (wretx) g_wretx = wretx;
+    void *wref = realloc(g_wref, want * sizeof(*g_wref));
+    if (wref) g_wref = wref;
+    void *wzc = realloc(g_wzc, want * sizeof(*g_wzc));
+    if (wzc) g_wzc = wzc;
+
+    if (!wbuf || !wlen || !wvalid || !wacked || !wsent || !wretx || !wref || !wzc) {
+        fprintf(stderr, "ringAlloc: out of memory (%u slots of %zu bytes)\n", want, stride);
+        return -1;
+    }
+    g_wstride = stride;
+    g_ring = want;
+    g_ringMask = want - 1;
+    return 0;
 }
 
 
 
-static void resetSenderState(int winSize) {
+static void zcDrain(void);
+static void probeStart(unsigned long grant);
+
+static void resetSenderState(int winSize, uint32_t start) {
     // Fenstergröße in erlaubten Bereich bringen
     if (winSize < 1) winSize = 1;
-    if (winSize > GBN_MAX_WINDOW) winSize = GBN_MAX_WINDOW;
+    if (winSize > g_winMax) winSize = g_winMax;
 
     // Go-Back-N Fensterzustand
     g_win = winSize;
-    g_base = 0;
-    g_next = 0;
+    g_base = start;
+    g_next = start;
+    g_tail = start;
     g_inFlight = 0;
+    g_error = 0;
+    ccInit(&g_cc, g_ccAlgo, g_win);
 
     // Timer / Retransmit-Zustand 
-    g_timer_units = 0;
+    g_timer_deadline = 0;
     g_retx_active = 0;
-    g_retx_next = 0;
+    g_retx_next = g_base;
+    g_retx_end = g_base;
+    g_retx_fast = 0;
+    g_dupAcks = 0;
+    g_inRecovery = 0;
+    g_sackHigh = g_base;
+    g_bpHold = 0;
+    g_bpPause_us = ARQ_BP_PAUSE_MIN_US;
+    g_rwnd = ARQ_MAX_WINDOW;
+    g_eosQueued = 0;
 
     // Ringpuffer-Slots als "leer" makieren
-    memset(g_wvalid, 0, sizeof(g_wvalid));
+    memset(g_wvalid, 0, g_ring);
+    memset(g_wacked, 0, g_ring);
+    memset(g_wretx, 0, g_ring);
+    memset(g_wref, 0, g_ring * sizeof(*g_wref));
+    zcDrain();
+    memset(g_wzc, 0, g_ring * sizeof(*g_wzc));
 }
 
 
 
-static int seqInWindow(unsigned long ackSeNo) {
-    // ackSeNo ist "next expected:" gültig wenn base < ackSeNo <= base + inFlight
+static int seqInWindow(uint32_t ackSeNo) {
+    // ackSeNo ist "next expected:" gültig wenn base < ackSeNo <= base + inFlight (Seriennummern)
 
     if (g_inFlight <= 0) return 0; // nichts ausstehend -> ACK uninteressant
 
-    if (ackSeNo <= g_base) return 0; // zu alt / Duplicate ACK
+    int32_t d = SEQ_DIFF(ackSeNo, g_base);
+
+    if (d <= 0) return 0; // zu alt / Duplicate ACK
 
-    if (ackSeNo > (g_base + (unsigned long)g_inFlight)) return 0; // zu neu / außerhalb
+    if (d > g_inFlight) return 0; // zu neu / außerhalb
 
     return 1; // ACK ist im Fenster -> akzeptiert
 }
 
 
 
-static void slideWindowTo(unsigned long newBase) {
-    // newBase ist ackSeNo ("next expected")
+static void slideWindowTo(uint32_t newBase) {
+    // newBase ist ackSeNo ("next expected"), liegt laut seqInWindow im Fenster
 
-    while (g_base < newBase) {
+    // RTT messen am neuesten bestätigten Paket. Karn: keine Messung, wenn eines der
+    // bestätigten Pakete wiederholt wurde (ACK wäre mehrdeutig bzw. durch die Lücke verzögert)
+    int sample = 1;
+    for (uint32_t q = g_base; q != newBase; q++) {
+        if (g_wretx[idxOf(q)]) sample = 0;
+    }
+    int acked = (int)(uint32_t)(newBase - g_base);
+    long rtt = -1;
+    int li = idxOf(newBase - 1);
+    if (sample && g_wvalid[li]) {
+        rtt = (long)(g_ack_rx_us - g_wsent[li]);
+        rttSample(rtt);
+    }
+    // Fortschritt beendet das Backoff auch ohne gültige Messung (sonst wächst der RTO
+    // bei Go-Back-N, wo nach Verlusten fast alle Pakete wiederholt sind, ungebremst)
+    rttUpdateRto();
+
+    while (g_base != newBase) {
         int i = idxOf(g_base); // Ringpuffer-Slot für das Paket g_base
+        if (g_wvalid[i] && !g_wretx[i]) {
+            STAT_HIST(SH_ACK_LATENCY, g_ack_rx_us - g_wsent[i]); // Senden -> ACK, ohne Wiederholungen
+        }
         g_wvalid[i] = 0; // Slot freigeben: Paket gilt als bestätigt 
+        g_wacked[i] = 0;
+        g_wretx[i] = 0;
 
         g_base++; // Fensterbasis nach vorne schieben
         g_inFlight--; // eins weniger "in flight"
     }
 
+    // Staukontrolle: Fenster aus bestätigten Paketen und RTT nachführen
+    g_cc.maxWnd = g_win;
+    ccOnAck(&g_cc, acked, rtt, g_inFlight, g_ack_rx_us);
+    ccTrace("ack");
+
     // Timer / Retransmit-Status anpassen
     if (g_inFlight > 0) {
         // es gibt noch unbestätigte Pakete -> Timer neu starten für das neue "älteste"
-        g_timer_units = GBN_TIMEOUT_UNITS;
+        armTimer();
     } else {
         // Fenster ist leer -> kein Timer nötig, keine Retransmits aktiv
-        g_timer_units = 0;
+        g_timer_deadline = 0;
         g_retx_active = 0;
-        g_retx_next = 0;
+        g_retx_next = g_base;
+        g_inRecovery = 0;
+        g_bpHold = 0;
     }
+    if (SEQ_LT(g_sackHigh, g_base)) g_sackHigh = g_base;
 }
 
 
 
-static int sendPacket(const struct request *req) {
-    // Sende genau ein Request-Paket an den Server
-    ssize_t sent = sendto(g_sock, req, sizeof(*req), 0, (struct sockaddr *)&g_srv, g_srvlen);
-    // sendto() fehlgeschlagen
-    if (sent < 0) {
-        perror("sendto");
+/* --------------------------------------------------------------- */
+/*  Gebündelte Datagramm-I/O (sendmmsg/recvmmsg)                   */
+/* --------------------------------------------------------------- */
+
+static int g_batch = ARQ_BATCH_DEFAULT; // max. Datagramme pro sendmmsg/recvmmsg
+static struct mmsghdr g_txmsg[ARQ_BATCH_MAX]; // Sende-Batch (zeigt in den Ringpuffer)
+static struct iovec g_txiov[ARQ_BATCH_MAX][2]; // je Datagramm: Header/Slot + Nutzdaten außerhalb des Slots
+static int g_txslot[ARQ_BATCH_MAX]; // Ringpuffer-Slot je Datagramm im Batch
+static int g_txcount = 0; // Pakete im Sende-Batch
+static struct mmsghdr g_rxmsg[ARQ_BATCH_MAX]; // Empfangs-Batch für ACKs
+static struct iovec g_rxiov[ARQ_BATCH_MAX];
+static unsigned char g_rxbuf[ARQ_BATCH_MAX][WIRE_ANSW_MAX];
+static struct arq_io_stats g_io; // Paket-/Systemaufruf-Zähler
+
+// MSG_ZEROCOPY (nur Event-Engine): der Kernel liest die Nutzdaten erst nach dem
+// sendmmsg aus dem Speicher, ein Slot darf erst nach der Abschlussmeldung neu belegt werden
+static int g_zeroCopy = 0; // per arqSetZeroCopy gewünscht
+static int g_zcActive = 0; // SO_ZEROCOPY am Socket gesetzt
+static uint32_t g_zcNext = 0; // Nummer der nächsten Zero-Copy-Sendung (zählt wie der Kernel)
+static uint32_t g_zcDone = 0; // alle Sendungen < g_zcDone sind abgeschlossen
+
+
+
+// Socket-Sendepuffer voll -> warten, bis wieder gesendet werden kann
+static int waitWritable(void) {
+    fd_set wfds;
+    FD_ZERO(&wfds);
+    FD_SET(g_sock, &wfds);
+    if (select(g_sock + 1, NULL, &wfds, NULL, NULL) < 0 && errno != EINTR) {
+        perror("select");
         return -1;
     }
-    // Sicherheitscheck: UDP sollte das komplette Paket senden
-    if ((size_t)sent != sizeof(*req)) {
-        fprintf(stderr, "sendto:only %zd of %zu bytes sent\n",sent, sizeof(*req));
-        return -1;
+    return 0;
+}
+
+
+
+// Abschlussmeldungen der Zero-Copy-Sendungen aus der Fehler-Queue lesen.
+// wait != 0: blockieren, bis mindestens eine Meldung da ist.
+static int zcReap(int wait) {
+    for (;;) {
+        char control[CMSG_SPACE(sizeof(struct sock_extended_err)) + 64];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        if (recvmsg(g_sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("recvmsg(MSG_ERRQUEUE)");
+                return -1;
+            }
+            if (!wait) return 0;
+            // Fehler-Queue leer -> auf POLLERR warten (select meldet es als lesbar)
+            fd_set efds;
+            FD_ZERO(&efds);
+            FD_SET(g_sock, &efds);
+            if (select(g_sock + 1, &efds, NULL, NULL, NULL) < 0 && errno != EINTR) {
+                perror("select");
+                return -1;
+            }
+            continue;
+        }
+
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            const struct sock_extended_err *ee = (const void *)CMSG_DATA(cm);
+            if (ee->ee_errno != 0 || ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+            // Meldung deckt die Sendungen ee_info..ee_data ab; UDP meldet in Sendereihenfolge
+            if (SEQ_LT(g_zcDone, ee->ee_data + 1)) g_zcDone = ee->ee_data + 1;
+            if (ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) g_io.zc_copied++;
+        }
+        wait = 0;
+    }
+}
+
+
+
+// Slot idx wird gleich überschrieben: ggf. auf den Abschluss seiner Zero-Copy-Sendung warten
+static int zcWaitSlot(int idx) {
+    // noch offen: g_zcDone <= g_wzc[idx] < g_zcNext (auch nach dem ACK möglich)
+    while (g_zcActive && !SEQ_LT(g_wzc[idx], g_zcDone) && SEQ_LT(g_wzc[idx], g_zcNext)) {
+        if (zcReap(1) < 0) return -1;
+    }
+    return 0;
+}
+
+
+
+// Alle offenen Zero-Copy-Sendungen abschließen (danach ist kein Slot mehr gebunden)
+static void zcDrain(void) {
+    while (g_zcActive && g_zcDone != g_zcNext) {
+        if (zcReap(1) < 0) break;
+    }
+}
+
+
+
+// Sende-Batch mit so wenigen sendmmsg-Aufrufen wie möglich abschicken
+static int flushPackets(void) {
+    int done = 0;
+    int flags = g_zcActive ? MSG_ZEROCOPY : 0;
+
+    while (done < g_txcount) {
+        int n = sendmmsg(g_sock, &g_txmsg[done], (unsigned int)(g_txcount - done), flags);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == ENOBUFS && flags) {
+                // Zero-Copy-Kontingent (optmem) erschöpft -> Meldungen abholen,
+                // ohne offene Sendungen gibt es keine -> diesmal kopierend senden
+                if (g_zcDone == g_zcNext) {
+                    flags = 0;
+                    continue;
+                }
+                if (zcReap(1) < 0) {
+                    g_txcount = 0;
+                    return -1;
+                }
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (waitWritable() < 0) {
+                    g_txcount = 0;
+                    return -1;
+                }
+                continue;
+            }
+            perror("sendmmsg");
+            g_txcount = 0;
+            return -1;
+        }
+        g_io.tx_calls++;
+        g_io.tx_packets += (unsigned long)n;
+
+        // Sicherheitscheck: UDP sollte jedes Paket komplett senden
+        for (int k = done; k < done + n; k++) {
+            if (g_txmsg[k].msg_len != g_wlen[g_txslot[k]]) {
+                fprintf(stderr, "sendmmsg: only %u of %zu bytes sent\n",
+                        g_txmsg[k].msg_len, g_wlen[g_txslot[k]]);
+            }
+            if (flags) g_wzc[g_txslot[k]] = g_zcNext++;
+        }
+        done += n;
+    }
+
+    g_txcount = 0;
+    return 0;
+}
+
+
+
+static int sendPacket(int idx) {
+    // Datagramm aus Ringpuffer-Slot idx an den Sende-Batch anhängen (gültig bis flushPackets)
+    // Nutzdaten außerhalb des Slots (g_wref) als zweites iovec, ohne Kopie
+    struct mmsghdr *m = &g_txmsg[g_txcount];
+    struct iovec *iov = g_txiov[g_txcount];
+    int iovlen = 1;
+    iov[0].iov_base = slotBuf(idx);
+    iov[0].iov_len = g_wlen[idx];
+    if (g_wref[idx]) {
+        iov[0].iov_len = WIRE_REQ_HDR_LEN;
+        iov[1].iov_base = (void *)g_wref[idx];
+        iov[1].iov_len = g_wlen[idx] - WIRE_REQ_HDR_LEN;
+        iovlen = 2;
+    }
+
+    memset(m, 0, sizeof(*m));
+    m->msg_hdr.msg_name = &g_srv;
+    m->msg_hdr.msg_namelen = g_srvlen;
+    m->msg_hdr.msg_iov = iov;
+    m->msg_hdr.msg_iovlen = (size_t)iovlen;
+    g_txslot[g_txcount] = idx;
+    g_txcount++;
+
+    // voller Batch wird sofort gesendet
+    if (g_txcount >= g_batch) {
+        return flushPackets();
     }
     return 0;
 }
@@ -147,16 +565,20 @@ static int waitForAckOneSlot(struct answer *outAns) {
     }
 
     // ACK ist da
+    unsigned char buf[WIRE_ANSW_MAX];
     memset(outAns, 0, sizeof(*outAns));
-    ssize_t got = recvfrom(g_sock, outAns, sizeof(*outAns), 0, NULL, NULL);
+    ssize_t got = recvfrom(g_sock, buf, sizeof(buf), 0, NULL, NULL);
     if (got < 0) {
         if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
         perror("recvfrom");
         return -1;
     }
-    if ((size_t)got != sizeof(*outAns)) {
-        fprintf(stderr, "recvfrom: wrong answer size %zd (expected %zu)\n", got, sizeof(*outAns));
-        return 0; // falsche Größe -> ignoriert
+    g_ack_rx_us = nowUs();
+    g_io.rx_calls++;
+    g_io.rx_packets++;
+    if (wireDecodeAnswer(buf, (size_t)got, outAns) < 0) {
+        fprintf(stderr, "recvfrom: malformed answer (%zd bytes)\n", got);
+        return 0; // falsches Format -> ignoriert
     }
 
     // bis Slotende idle (Restzeit tv enthält Resr nach select)
@@ -181,8 +603,10 @@ static int waitForAckOneSlot(struct answer *outAns) {
  *   - UDP-Socket (IPv6, Datagram) erzeugen, Serveradresse auflösen
  *   - ARQ-/GBN-Sendealgorithmus implementieren:
  *        * Fensterverwaltung (base, nextNum, packetCount)
- *        * innerhal eines Intervalls max. 1 Paket senden und empfangen (GBN_TIMEOUT_INT_MS)
- *        * Paket-Timeout in Intervallen (GBN_TIMEOUT_UNITS)
+ *        * Event-Engine: ACK-getaktet senden, epoll + timerfd statt fester Slots
+ *        * Slot-Engine (Kompatibilität): innerhal eines Intervalls max. 1 Paket senden
+ *          und empfangen (GBN_TIMEOUT_INT_MS)
+ *        * Paket-Timeout adaptiv aus gemessener RTT (RFC 6298)
  *        * Retransmission der unbestätigten Pakete
  *   - kumulative ACKs (AnswOk.SeNo) auswerten
  *   - Hello/Data/Close über die gemeinsame Logik abwickeln
@@ -243,20 +667,97 @@ void initClient(char *name, const char *port)
         g_sock = -1; //ungültig makieren
         exit(EXIT_FAILURE);//abbrechen
     }
+
+    // Event-Engine: epoll-Instanz mit Socket + Retransmission-Timer (timerfd, µs-Auflösung)
+    g_epfd = epoll_create1(EPOLL_CLOEXEC);
+    g_tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (g_epfd < 0 || g_tfd < 0) {
+        perror("epoll_create1/timerfd_create");
+        exit(EXIT_FAILURE);
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = g_sock;
+    if (epoll_ctl(g_epfd, EPOLL_CTL_ADD, g_sock, &ev) < 0) {
+        perror("epoll_ctl(sock)");
+        exit(EXIT_FAILURE);
+    }
+    ev.data.fd = g_tfd;
+    if (epoll_ctl(g_epfd, EPOLL_CTL_ADD, g_tfd, &ev) < 0) {
+        perror("epoll_ctl(timerfd)");
+        exit(EXIT_FAILURE);
+    }
 }
 
 
 
 void closeClient(void)
 {
-    //Platzhalter:
     if (g_sock >= 0) {
         close(g_sock);
         g_sock = -1;
     }
+    if (g_tfd >= 0) {
+        close(g_tfd);
+        g_tfd = -1;
+    }
+    if (g_epfd >= 0) {
+        close(g_epfd);
+        g_epfd = -1;
+    }
     g_srvlen = 0;
     memset(&g_srv, 0, sizeof(g_srv));
-    resetSenderState(1);
+    probeStart(BufferSize);
+    g_zcActive = 0; // Socket ist zu, offene Meldungen verfallen
+    g_zcNext = 0;
+    g_zcDone = 0;
+    resetSenderState(1, 0);
+    g_helloWin = 0;
+    resetRttEstimator();
+
+    // Ringpuffer freigeben, das nächste Hello legt ihn neu an
+    free(g_wbuf); g_wbuf = NULL;
+    g_wstride = 0;
+    free(g_wlen); g_wlen = NULL;
+    free(g_wvalid); g_wvalid = NULL;
+    free(g_wacked); g_wacked = NULL;
+    free(g_wsent); g_wsent = NULL;
+    free(g_wretx); g_wretx = NULL;
+    free(g_wref); g_wref = NULL;
+    free(g_wzc); g_wzc = NULL;
+    g_ring = 0;
+    g_ringMask = 0;
+}
+
+
+
+void arqSetBatchSize(int batch)
+{
+    if (batch < 1) batch = 1;
+    if (batch > ARQ_BATCH_MAX) batch = ARQ_BATCH_MAX;
+    g_batch = batch;
+}
+
+
+
+void arqGetIoStats(struct arq_io_stats *stats)
+{
+    if (stats == NULL) return;
+    *stats = g_io;
+}
+
+
+
+void arqGetRttInfo(struct arq_rtt_info *info)
+{
+    if (info == NULL) return;
+    info->srtt_us = g_srtt_us;
+    info->rttvar_us = g_rttvar_us;
+    info->rto_us = g_rto_us;
+    info->backoff = g_backoff;
+    info->samples = g_rtt_samples;
 }
     
 
@@ -265,267 +766,1027 @@ void closeClient(void)
 /* --------------------------------------------------------------- */
 
 /*
- * doRequest:
- *   - ReqHello: einmaliger Handshake mit eigenem Timeout
- *   - ReqData / ReqClose: Go-Back-N-Sendealgorithmus mit Fenster 
- *
- * Parameter:
- *   req        : zu sendendes Request-Paket
- *   winSize    : Fenstergröße (1..GBN_MAX_WINDOW)
- *   windowFull : optionaler Rückgabewert, ob das Sendefenster voll ist
- *
- * Rückgabewert:
- *   - Zeiger auf empfangene Antwort (struct answer)
- *   - NULL, wenn in diesem Intervall keine relevante Antwort
- *     eingetroffen ist
+ * enqueueRequest: neues Paket in den Ringpuffer einreihen, Nutzdaten
+ * (req->FlNr Bytes) stehen in payload.
+ * byRef: nicht kopieren, sondern per Referenz senden; sie müssen bis arqSendClose gültig bleiben.
+ * Setzt *windowFull, wenn der Ringpuffer voll ist (Aufrufer versucht es später erneut).
  */
+static void enqueueRequest(const struct request *req, const char *payload, int byRef, int *windowFull) {
+    // Erwartung: Aufrufer liefert forlaufende SeNr passend zu g_tail
+    if ((uint32_t)req->SeNr != g_tail) {
+        fprintf(stderr, "doRequest: unexpected SeNr=%lu, expected %u\n", req->SeNr, g_tail);
+    }else if (g_tail - g_base >= g_ring) {
+        if (windowFull) *windowFull = 1; // Ringpuffer voll -> Aufrufer versucht es im nächsten Schritt erneut
+        STAT_INC(ST_RING_FULL);
+    }else {
+        // Paket kodiert im Ringpuffer speichern, damit es gesendet und bei Timeout retransmittiert werden kann
+        int ti = idxOf(g_tail);
+        if (zcWaitSlot(ti) < 0) {
+            g_error = 1;
+            return;
+        }
+        unsigned char *slot = slotBuf(ti);
+        g_wlen[ti] = wireEncodeRequestHeader(slot, g_wstride, req);
+        if (!byRef && WIRE_REQ_HDR_LEN + (size_t)req->FlNr > g_wstride) g_wlen[ti] = 0; // passt nicht in den Slot
+        if (g_wlen[ti] > 0) {
+            if (!byRef && req->FlNr > 0) memcpy(slot + WIRE_REQ_HDR_LEN, payload, (size_t)req->FlNr);
+            g_wlen[ti] += (size_t)req->FlNr;
+        }
+        g_wref[ti] = byRef ? payload : NULL;
+        if (g_wlen[ti] == 0) {
+            fprintf(stderr, "doRequest: cannot encode SeNr=%lu (FlNr=%lu)\n", req->SeNr, req->FlNr);
+            return;
+        }
+        g_wvalid[ti] = 1;
+        g_tail++;
+    }
+}
 
 
 
-static struct answer *doRequest(struct request *req, int winSize, int *windowFull, int *retransmission) {
-
-    static struct answer ans;
-
-    // Rückgabeflags defaulten
-    if (windowFull) *windowFull = 0;
-    if (retransmission) *retransmission = 0;
-
-    // Fenstergröße nur clampen (Reset passiert z.B. in arqSendHello via resetSenderState)
-    if (winSize < 1) winSize = 1;
-    if (winSize > GBN_MAX_WINDOW) winSize = GBN_MAX_WINDOW;
-    g_win = winSize;
-
-    /* ------------------ (1) Sendephase: max 1 Paket pro Slot ------------------ */
-    if (g_retx_active) {
-        // Timeout-Modus: Go-Back-N Retransmit ab Basis,pro Slot genau 1 Paket
-        if (g_retx_next < g_next) {
-            int bi = idxOf(g_retx_next);
-            if (g_wvalid[bi]) {
-                if (sendPacket(&g_wbuf[bi]) < 0) return NULL;
-                if (retransmission) *retransmission = 1;
+/*
+ * fillPending: bis zu budget Pakete aus dem Ringpuffer in den Sende-Batch legen.
+ *   - Retransmit-Modus (nach Timeout) hat Vorrang vor neuen Paketen
+ *   - neue Pakete nur, solange das Sendefenster Platz hat
+ * Slot-Engine: budget = 1, das Ende eines Retransmit-Durchlaufs verbraucht den Slot.
+ * Rückgabewert: 0 bei Erfolg, <0 bei Sendefehler.
+ */
+static int fillPending(int budget, int *windowFull, int *retransmission) {
+    while (budget > 0) {
+        if (g_retx_active) {
+            // Timeout-Modus: Go-Back-N Retransmit ab Basis
+            // SR: selektiv bestätigte Pakete überspringen -> nur die Lücken werden wiederholt
+            // (Fast Retransmit: schon in dieser Recovery wiederholte Lücken liegen unter g_fastNext,
+            // der Durchlauf beginnt nie darunter; g_wretx gilt nur für Karn, über alle Recoverys)
+            if (g_mode == ARQ_MODE_SR) {
+                while (SEQ_LT(g_retx_next, g_retx_end) && g_wacked[idxOf(g_retx_next)]) {
+                    g_retx_next++;
+                }
             }
-            g_retx_next++; // im nächsten Slot nächstes paket retransmitten
-        }else {
-            // Alle unbestätigten Pakete einmal retransmittieren -> zurück in Normalmodus
-            g_retx_active = 0;
-        }
-    }else {
-        // Normalmodus: wenn Platz im Fenster, pro Slot höchstens 1 neues Paket senden
-        if (req != NULL) {
-            if (g_inFlight >= g_win) {
-                if (windowFull) *windowFull = 1; // Senderfenster voll
-            }else {
-                // Erwartung: Aufrufer liefert forlaufende SeNr passend zu g_next
-                if (req->SeNr != g_next) {
-                    fprintf(stderr, "doRequest: unexpected SeNr=%lu, expected %lu\n", req->SeNr, g_next);
-                }else {
-                    int ni = idxOf(g_next);
-
-                    // Paket im Ringpuffer speichern, damit es bei Timeout retransmittiert werden kann
-                    g_wbuf[ni] = *req;
-                    g_wvalid[ni] = 1;
-
-                    // senden
-                    if (sendPacket(&g_wbuf[ni]) < 0) return NULL;
-
-                    // Fensterzustand aktualisieren
-                    g_next++;
-                    g_inFlight++;
-
-                    // Timer läuft immer nur für das älteste unbestätigte Paket
-                    if (g_inFlight == 1) {
-                        g_timer_units = GBN_TIMEOUT_UNITS;
+            if (SEQ_LT(g_retx_next, g_retx_end)) {
+                int bi = idxOf(g_retx_next);
+                if (g_wvalid[bi]) {
+                    if (sendPacket(bi) < 0) return -1;
+                    g_wsent[bi] = nowUs();
+                    g_wretx[bi] = 1; // Karn: ACK dieses Pakets nicht als RTT-Messung verwenden
+                    g_io.tx_retrans++;
+                    STAT_INC(ST_RETRANS);
+                    if (g_retx_next == g_base) {
+                        armTimer(); // Timer gilt ab der Wiederholung des ältesten Pakets
                     }
+                    if (retransmission) *retransmission = 1;
                 }
+                g_retx_next++; // als nächstes das folgende Paket retransmitten
+                budget--;
+                continue;
             }
-        }   
-    }
-
-    /* ------------------ (2) Empfangsphase: ACK oder Slotende ------------------ */
-    int wrc = waitForAckOneSlot(&ans); // select() wartet bis ACK oder Slotende; bei frühem ACK idle
-    if (wrc < 0) return NULL;
 
-    int  haveAns = (wrc == 1);
+            // Alle unbestätigten Pakete einmal retransmittiert -> zurück in Normalmodus
+            g_retx_active = 0;
+            if (g_engine == ARQ_ENGINE_SLOT) return 0;
+            continue;
+        }
 
-    if (haveAns) {
-        // Kumulative ACKs auswerten (SeNo = next expected)
-        if (ans.AnswType == AnswOk || ans.AnswType == AnswHello) {
-            unsigned long ack = ans.SeNo;
+        // Normalmodus: neue Pakete senden, solange Platz im Fenster ist
+        if (g_next == g_tail) return 0;
+        if (g_bpHold) return 0; // Rückstau beim Server: erst nach der Pause weiter
+        if (g_inFlight >= g_win || g_inFlight >= ccWindow(&g_cc)) {
+            if (windowFull) *windowFull = 1; // Senderfenster voll
+            STAT_INC(ST_WINDOW_FULL);
+            return 0;
+        }
+        // Empfangsfenster des Servers; bei 0 darf ein Paket als Probe raus (wie TCP Persist),
+        // sonst bliebe ein verlorenes Fenster-Update für immer aus
+        if ((unsigned long)g_inFlight >= (g_rwnd > 0 ? g_rwnd : 1)) {
+            if (windowFull) *windowFull = 1;
+            STAT_INC(ST_RWND_LIMITED);
+            return 0;
+        }
 
-            // ACK nur aktzeptieren, wenn es im aktuellen Fenster liegt
-            if (seqInWindow(ack)) {
-                slideWindowTo(ack); // bestätigt alles < ack
+        int ni = idxOf(g_next);
 
-                // Wenn retransmittiert wird und Fenster vorgeschoben wurde, darf g_retx nicht hinter (also <) der neuen Basis liegen
-                if (g_retx_active && g_retx_next < g_base) {
-                    g_retx_next = g_base;
-                }
-            }else {
-                //außerhalb Fenster -> ignorieren
-            }
-        }
-        // Warn/Err: verändert das Fenster nicht
-    }
-     
-     /* ------------------ (3) Slotende: Timer dekrementieren / Timeout ------------------ */
-     if (g_inFlight > 0) {
-        // In JEDEM Fall ist 1 Intervall vergangen (auch wenn ACK früh kam -> idle bis Slotende)
-        g_timer_units--; // ein Zeitslot vergangen
+        // senden (Paket liegt bereits im Ringpuffer, siehe enqueueRequest)
+        if (sendPacket(ni) < 0) return -1;
+        g_wsent[ni] = nowUs();
+        STAT_INC(ST_DATA_SENT);
 
-        if (g_timer_units <= 0) {
-            // Timeout -> Go-Back-N: Retransmit ab base, 1 Paket pro Slot
-            g_retx_active = 1;
-            g_retx_next = g_base;
-            g_timer_units = GBN_TIMEOUT_UNITS;
+        // Fensterzustand aktualisieren
+        g_next++;
+        g_inFlight++;
+        budget--;
 
-            if (retransmission) *retransmission = 1;
+        // Timer läuft immer nur für das älteste unbestätigte Paket
+        if (g_inFlight == 1) {
+            armTimer();
         }
-     }
-
-     return haveAns ? &ans : NULL; 
+    }
+    return 0;
 }
 
 
-/* --------------------------------------------------------------- */
-/*  Externe ARQ-API (Wrapper um doRequest)                         */
-/* --------------------------------------------------------------- */
 
+// sendPending: Pakete aus dem Ringpuffer auswählen und als ein Burst (sendmmsg) senden
+static int sendPending(int budget, int *windowFull, int *retransmission) {
+    int rc = fillPending(budget, windowFull, retransmission);
+    if (flushPackets() < 0) return -1;
+    return rc;
+}
 
-int arqSendHello(int winSize)
-{
-    struct request req; //Request-Paket anlegen (lokal auf dem Stack)
-    memset(&req, 0, sizeof(req)); //alles auf 0, damit keine Zufallswerte drin sind
 
-    // Senderzustand komplett resetten (Fenster, Timer, Retransmit, Ringpuffer)
-    resetSenderState(winSize);
 
-    // Hello-Request vorbereiten
-    req.ReqType = ReqHello; //HELLO-Pakettyp setzen
-    req.FlNr = 0; //bei HELLO keine Nutzdatenlänge
+// Eine empfangene Antwort auswerten: kumulative ACKs (SeNo = next expected), SR-ACKs
+/*
+ * fastRetransmit: Wiederholung ohne auf den Timer zu warten (Fast Retransmit).
+ *   - GBN: der Empfänger hat alles hinter der Lücke verworfen -> Go-Back-N ab base
+ *   - SR:  nur die Lücken unterhalb des höchsten selektiv bestätigten Pakets,
+ *          jede Lücke höchstens einmal je Recovery
+ * Kein RTO-Backoff, die Staukontrolle reagiert über ccOnFastRetransmit.
+ */
+static void fastRetransmit(void) {
+    if (g_mode == ARQ_MODE_SR) {
+        uint32_t from = SEQ_LT(g_fastNext, g_base) ? g_base : g_fastNext;
+        uint32_t to = SEQ_LT(g_base, g_sackHigh) ? g_sackHigh : SEQ_ADD(g_base, 1);
+        if (!SEQ_LT(from, to)) return; // keine neue Lücke bekannt
+        if (g_retx_active && !g_retx_fast) return; // Timeout-Durchlauf läuft ohnehin
+        if (!g_retx_active || SEQ_LT(from, g_retx_next)) g_retx_next = from;
+        g_retx_end = to;
+        g_fastNext = to;
+        g_retx_fast = 1;
+    } else {
+        if (g_retx_active) return;
+        g_retx_next = g_base;
+        g_retx_end = g_next;
+        g_retx_fast = 0;
+    }
+    g_retx_active = 1;
+}
 
-    // Wichtig: SeNr muss zum Senderzustand passen (erstes Paket: g_next == 0)
-    req.SeNr = g_next; //bei HELLO keine Sequenznummer nötig
 
-    int windowFull = 0;
-    int retransmission = 0;
 
-    int hello_sent = 0;
+/*
+ * Pfad-MTU-Suche (DPLPMTUD, RFC 8899): Proben (ReqProbe) mit FlNr Bytes
+ * Füllung laufen neben den Daten, ohne Sequenznummer und außerhalb des
+ * Fensters. Erst die gewährte Obergrenze, danach binäre Suche zwischen
+ * bestätigter und noch möglicher Größe. Neue Pakete nutzen nur bestätigte
+ * Größen (arqGetPayload), verlorene Proben kosten also keine Daten.
+ * Eine verlorene Probe ist noch kein Befund (z.B. voller Empfangspuffer):
+ * erst ARQ_PROBE_TRIES Verluste mit wachsendem Abstand verwerfen die Größe,
+ * und nach ARQ_PROBE_RAISE_MS wird oberhalb der bestätigten Größe erneut
+ * gesucht (PMTU_RAISE_TIMER).
+ */
 
-    // Slot-Schleife: pro Intervall max 1 neues Paket; wenn ACK früh kommt -> idle passiert in waitForAckOneSlot()
-    for (;;) {
-        struct answer *ans;
-        
-        if (!hello_sent) {
-            // Erstes Intervall: Hello als "neues Paket" in den ARQ-Core geben
-            ans = doRequest(&req, g_win, &windowFull, &retransmission);
-            hello_sent = 1;
-        }else {
-            // Danach: keine neuen Pakete, nur ARQ weiterlaufen lassen (ACKs/Timeout/Retx)
-            ans = doRequest(NULL, g_win, &windowFull, &retransmission);
-        }
+// Suche für die gewährte Größe grant neu beginnen (grant <= BufferSize: keine Suche)
+static void probeStart(unsigned long grant) {
+    g_payloadMax = grant;
+    __atomic_store_n(&g_payload, (unsigned long)BufferSize, __ATOMIC_RELAXED);
+    g_probeLo = BufferSize;
+    g_probeHi = grant;
+    g_probeCap = grant;
+    g_probeSize = (grant > BufferSize) ? grant : 0;
+    g_probeTries = 0;
+    g_probeSentUs = 0;
+    g_probeRaiseUs = 0;
+}
 
-        // doRequest liefert NULL, wenn in diesem Slot kein ACK kam -> weiter im nächsten Slot
-        if (ans == NULL) {
-            continue;
-        }
 
-        // Antwort auswerten
-        if (ans->AnswType == AnswHello || ans->AnswType == AnswOk) {
-            resetSenderState(winSize);
-            return 0; // Erfolg
-        }
-        if (ans->AnswType == AnswErr) {
-            return 1; // Serverfehler -> abbrechen
-        }
 
-        // Warnung o.ä. ignorieren hier und weiter warten
+// Ergebnis für g_probeSize übernehmen und die nächste Größe wählen
+static void probeDone(int ok) {
+    if (ok) {
+        g_probeLo = g_probeSize;
+        __atomic_store_n(&g_payload, g_probeLo, __ATOMIC_RELAXED);
+    } else {
+        g_probeHi = g_probeSize - 1;
     }
+    g_probeTries = 0;
+    g_probeSentUs = 0;
+    g_probeSize = (g_probeHi - g_probeLo >= ARQ_PROBE_GRAIN) ? g_probeLo + (g_probeHi - g_probeLo + 1) / 2 : 0;
+    // Suche beendet, aber Platz bis zur lokalen Grenze: später erneut nach oben prüfen
+    g_probeRaiseUs = (g_probeSize == 0 && g_probeCap - g_probeLo >= ARQ_PROBE_GRAIN)
+                     ? nowUs() + ARQ_PROBE_RAISE_MS * 1000LL : 0;
 }
 
 
 
-int arqSendData(const struct app_unit *app, int winSize) {
-
-    if (app == NULL) return 1;
-
-    // Fenstergröße clampen
-    if (winSize < 1) winSize = 1;
-    if (winSize > GBN_MAX_WINDOW) winSize = GBN_MAX_WINDOW;
-
-    // Request aus app_unit bauen
+// Probe mit g_probeSize Bytes senden, ohne Fragmentierung (IPV6_DONTFRAG nur für dieses Datagramm).
+// Rückgabewert: 0 gesendet, 1 später erneut versuchen, -1 lokal schon zu groß (EMSGSIZE).
+static int probeSend(void) {
     struct request req;
+    struct iovec iov;
+    struct msghdr mh;
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } ctrl;
+    int one = 1;
+
     memset(&req, 0, sizeof(req));
+    req.ReqType = ReqProbe;
+    req.SeNr = ++g_probeId;
+    req.FlNr = g_probeSize;
+    if (wireEncodeRequestHeader(g_probeBuf, sizeof(g_probeBuf), &req) == 0) return -1;
+
+    iov.iov_base = g_probeBuf;
+    iov.iov_len = WIRE_REQ_HDR_LEN + g_probeSize;
+    memset(&mh, 0, sizeof(mh));
+    memset(&ctrl, 0, sizeof(ctrl));
+    mh.msg_name = &g_srv;
+    mh.msg_namelen = g_srvlen;
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = ctrl.buf;
+    mh.msg_controllen = sizeof(ctrl.buf);
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&mh);
+    cm->cmsg_level = IPPROTO_IPV6;
+    cm->cmsg_type = IPV6_DONTFRAG;
+    cm->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cm), &one, sizeof(one));
+
+    if (sendmsg(g_sock, &mh, 0) < 0) {
+        return (errno == EMSGSIZE) ? -1 : 1;
+    }
+    g_io.tx_packets++;
+    g_io.tx_calls++;
+    STAT_INC(ST_PROBES_SENT);
+    return 0;
+}
 
-    req.ReqType = ReqData;
 
-    // Länge begrenzen (BufferSize aus data.h)
-    unsigned long len = app->len;
-    if (len > (unsigned long)BufferSize) len = (unsigned long)BufferSize;
-    req.FlNr = len;
 
-    // Sequenznummer für dieses (genau ein) Datenpaket festlegen
-    // Wichtig: beim ersten neuen Senden muss req.SeNr == g_next sein
-    unsigned long mySeq = g_next;
-    req.SeNr = mySeq;
+// probeTick: Suche weiterführen - offene Probe ohne Antwort nach RTO, 2 RTO, ... wiederholen
+// (verloren erst, wenn nach Ablauf Antworten gelesen wurden und ihre nicht dabei war),
+// nach ARQ_PROBE_TRIES Versuchen bzw. bei EMSGSIZE gilt die Größe als zu groß;
+// nach Ablauf des Raise-Timers von der bestätigten Größe aus erneut suchen
+static void probeTick(void) {
+    long long now = nowUs();
 
-    // Payload kopieren (req.name als Datenfeld)
-    if (len > 0) {
-        memcpy(req.name, app->data, (size_t)len);
+    if (g_probeSize == 0) {
+        if (g_probeRaiseUs == 0 || now < g_probeRaiseUs) return;
+        g_probeRaiseUs = 0;
+        g_probeHi = g_probeCap;
+        g_probeSize = g_probeCap; // wie beim Start erst die Obergrenze
     }
-    // Rest ist bereits 0 durch memset
-
-    int windowFull = 0;
-    int retransmission = 0;
-
-    int queued = 0; // wurde dieses Paket bereits wirklich als neues Paket gesendet/eingequeued?
-
-        for (;;) {
-        // Erfolg: Unser Paket ist kumulativ bestätigt -> base ist über unsere SeNr hinaus
-        if (g_base > mySeq) {
-            return 0;
+    if (g_probeSentUs != 0) {
+        long long due = g_probeSentUs + (g_rto_us << g_probeTries);
+        if (now < due) return; // Antwort kann noch kommen
+        if (g_ack_rx_us < due) return; // seitdem nichts gelesen: Antwort kann im Socket liegen
+        STAT_INC(ST_PROBES_LOST);
+        g_probeSentUs = 0;
+        if (++g_probeTries >= ARQ_PROBE_TRIES) probeDone(0);
+    }
+    while (g_probeSize != 0) {
+        int rc = probeSend();
+        if (rc == 0) {
+            g_probeSentUs = now;
+            return;
         }
+        if (rc > 0) return; // z.B. Sendepuffer voll
+        STAT_INC(ST_PROBES_LOST);
+        g_probeCap = g_probeSize - 1; // lokale MTU: auch der Raise-Timer bleibt darunter
+        probeDone(0);
+    }
+}
 
-        struct answer *ans;
 
-        if (!queued) {
-            // Paket als "neu" anbieten: doRequest sendet es nur, wenn Fenster Platz hat
-            ans = doRequest(&req, winSize, &windowFull, &retransmission);
 
-            // Wenn Fenster nicht voll war und doRequest es als neues Paket gesendet hat,
-            // dann wurde g_next hochgezählt -> req.SeNr < g_next bedeutet: "eingereiht"
-            if (!windowFull && req.SeNr < g_next) {
-                queued = 1;
+static void handleAnswer(const struct answer *ans) {
+    g_last_answer_us = g_ack_rx_us;
+
+    // Antwort auf eine Probe: kein ACK, nur die Pfad-MTU-Suche (eine verspätete Antwort
+    // auf eine frühere Probe derselben Größe belegt dasselbe)
+    if (ans->AnswType == AnswProbe) {
+        if (g_probeSentUs != 0 && ans->FlNr == g_probeSize) probeDone(1);
+        return;
+    }
+    if (ans->RwndValid) g_rwnd = ans->Rwnd; // gilt ab dem (hier gleich verarbeiteten) kumulativen ACK
+
+    // AnswHello trägt in SeNo die Fenstergröße, kein ACK (wird in arqSendHello ausgewertet)
+    if (ans->AnswType == AnswOk) {
+        uint32_t ack = (uint32_t)ans->SeNo;
+        STAT_INC(ST_ACKS_RX);
+
+        // SR: selektives ACK (FlNr = SeNr + 1) für ein Paket hinter der Basis merken,
+        // auch wenn das kumulative ACK selbst ein Duplikat ist
+        if (g_mode == ARQ_MODE_SR && ans->FlNr > 0) {
+            uint32_t sseq = (uint32_t)(ans->FlNr - 1);
+            if (!SEQ_LT(sseq, g_base) && SEQ_LT(sseq, g_next)) {
+                g_wacked[idxOf(sseq)] = 1;
+                if (!SEQ_LT(sseq, g_sackHigh)) g_sackHigh = sseq + 1;
             }
-        } else {
-            // Unser Paket ist schon unterwegs -> keine neuen Pakete mehr,
-            // nur ACKs/Timeout/Go-Back-N-ReTx weiter abarbeiten
-            ans = doRequest(NULL, winSize, &windowFull, &retransmission);
         }
 
-        // Antwort auswerten (falls in diesem Slot etwas kam)
-        if (ans != NULL) {
-            if (ans->AnswType == AnswErr) {
-                unsigned long code = ans->ErrNo;
-                if (code < 8) {
-                    fprintf(stderr, "arqSendData: server error %lu (%s)\n", code, errorTable[code]);
-                } else {
-                    fprintf(stderr, "arqSendData: server error %lu\n", code);
+        // SR + SACK: alle gemeldeten Bereiche [Start, Ende) im Fenster als angekommen markieren,
+        // ein verlorenes ACK geht so nicht verloren
+        if (g_mode == ARQ_MODE_SR) {
+            for (int b = 0; b < ans->SackCount; b++) {
+                uint32_t lo = (uint32_t)ans->Sack[b][0];
+                uint32_t hi = (uint32_t)ans->Sack[b][1];
+                if (SEQ_LT(lo, g_base)) lo = g_base;
+                if (SEQ_LT(g_next, hi)) hi = g_next;
+                for (uint32_t q = lo; SEQ_LT(q, hi); q++) {
+                    g_wacked[idxOf(q)] = 1;
                 }
+                if (SEQ_LT(lo, hi) && SEQ_LT(g_sackHigh, hi)) g_sackHigh = hi;
+            }
+        }
+
+        // ACK nur aktzeptieren, wenn es im aktuellen Fenster liegt
+        if (seqInWindow(ack)) {
+            slideWindowTo(ack); // bestätigt alles < ack
+            g_dupAcks = 0;
+            if (!g_bpHold) g_bpPause_us = ARQ_BP_PAUSE_MIN_US; // Server nimmt wieder an
+
+            // Wenn retransmittiert wird und Fenster vorgeschoben wurde, darf g_retx nicht hinter (also <) der neuen Basis liegen
+            if (g_retx_active && SEQ_LT(g_retx_next, g_base)) {
+                g_retx_next = g_base;
+            }
+
+            // Fast Recovery: volles ACK beendet sie, Teil-ACK zeigt bei SR die nächste Lücke
+            if (g_inRecovery) {
+                if (!SEQ_LT(ack, g_recover)) {
+                    g_inRecovery = 0;
+                } else if (g_mode == ARQ_MODE_SR) {
+                    fastRetransmit();
+                }
+            }
+        }else if (ack == g_base && g_bpHold) {
+            // Folgepakete des abgewiesenen Pakets: Lücke ist bekannt, kein Fast Retransmit
+            STAT_INC(ST_DUP_ACKS);
+        }else if (ack == g_base && g_inFlight > 0 && g_dupThresh > 0) {
+            // doppeltes ACK: Paket g_base fehlt beim Empfänger, spätere kommen an
+            g_dupAcks++;
+            STAT_INC(ST_DUP_ACKS);
+            if (!g_inRecovery && g_dupAcks >= g_dupThresh) {
+                g_inRecovery = 1;
+                g_recover = g_next;
+                g_fastNext = g_base;
+                g_io.fast_retrans++;
+                STAT_INC(ST_FAST_RETRANS);
+                ccOnFastRetransmit(&g_cc, g_inFlight, g_ack_rx_us);
+                ccTrace("fastretx");
+                fastRetransmit();
+            } else if (g_inRecovery && g_mode == ARQ_MODE_SR) {
+                fastRetransmit(); // neue SACK-Information kann weitere Lücken zeigen
+            }
+        }else {
+            //außerhalb Fenster -> ignorieren
+            STAT_INC(ST_ACKS_STALE);
+        }
+    } else if (ans->AnswType == AnswWarn && ans->ErrNo == ERR_BACKPRESSURE) {
+        // Schreib-Queue des Servers voll: FlNr bestätigt kumulativ, das Paket dort wurde
+        // nicht angenommen -> nichts Neues senden, nach einer Pause ab base wiederholen
+        uint32_t ack = (uint32_t)ans->FlNr;
+        long long until = g_bpHold ? g_timer_deadline : nowUs() + g_bpPause_us; // Pause nicht verlängern
+        STAT_INC(ST_BACKPRESSURE_RX);
+        if (seqInWindow(ack)) slideWindowTo(ack);
+        if (g_inFlight > 0) {
+            g_bpHold = 1;
+            g_retx_active = 0; // laufende Wiederholungen träfen ebenfalls die volle Queue
+            g_timer_deadline = until;
+        }
+    }
+    // sonstige Warn/Err: verändert das Fenster nicht
+}
+
+
+
+// Timer des ältesten Pakets prüfen; bei Ablauf Go-Back-N-Retransmit ab base starten
+// (SR: ohne selektiv bestätigte Pakete), beendet eine laufende Fast Recovery
+static void checkTimeout(int *retransmission) {
+    if (g_inFlight <= 0 || nowUs() < g_timer_deadline) return;
+
+    // Ende der Rückstau-Pause: ab base wiederholen, ohne RTO-Backoff und Staukontrolle
+    if (g_bpHold) {
+        g_bpHold = 0;
+        g_bpPause_us = (g_bpPause_us * 2 < ARQ_BP_PAUSE_MAX_US) ? g_bpPause_us * 2 : ARQ_BP_PAUSE_MAX_US;
+        g_retx_active = 1;
+        g_retx_next = g_base;
+        g_retx_end = g_next;
+        g_retx_fast = 0;
+        armTimer();
+        if (retransmission) *retransmission = 1;
+        return;
+    }
+
+    g_retx_active = 1;
+    g_retx_next = g_base;
+    g_retx_end = g_next;
+    g_retx_fast = 0;
+    g_inRecovery = 0; // Timeout beendet eine laufende Fast Recovery
+    g_dupAcks = 0;
+    rttBackoff();
+    armTimer();
+
+    ccOnTimeout(&g_cc, g_inFlight, nowUs());
+    STAT_INC(ST_TIMEOUTS);
+    ccTrace("timeout");
+
+    if (retransmission) *retransmission = 1;
+}
+
+
+
+// Schwere einer Antwort, damit beim Leeren mehrerer ACKs Err/Warn nicht verloren gehen
+static int answerRank(const struct answer *ans) {
+    if (ans->AnswType == AnswErr) return 2;
+    if (ans->AnswType == AnswWarn) return 1;
+    return 0;
+}
+
+
+
+/*
+ * waitForEvents (Event-Engine):
+ *   - Timer (timerfd) auf die Deadline des ältesten Pakets stellen (µs-Auflösung)
+ *   - per epoll warten, bis ACKs eintreffen oder der Timer wirklich abläuft
+ *   - alle anstehenden ACKs lesen und sofort auswerten (ACK-Clocking)
+ *
+ * Rückgabewert: 1 = mind. eine Antwort gelesen (schwerste in outAns), 0 = keine, <0 Fehler
+ */
+static int waitForEvents(struct answer *outAns) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its)); // Deadline 0 -> Timer aus
+    if (g_timer_deadline > 0) {
+        its.it_value.tv_sec = (time_t)(g_timer_deadline / 1000000LL);
+        its.it_value.tv_nsec = (long)(g_timer_deadline % 1000000LL) * 1000L;
+    }
+    if (timerfd_settime(g_tfd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+        perror("timerfd_settime");
+        return -1;
+    }
+
+    struct epoll_event ev[2];
+    int n = epoll_wait(g_epfd, ev, 2, -1);
+    if (n < 0) {
+        if (errno == EINTR) return 0; // Signal -> wie "kein ACK" behandeln
+        perror("epoll_wait");
+        return -1;
+    }
+
+    int haveAns = 0;
+    for (int k = 0; k < n; k++) {
+        if (ev[k].events & EPOLLERR) {
+            // Zero-Copy-Abschlussmeldungen, sonst meldet epoll den Socket sofort wieder
+            if (zcReap(0) < 0) return -1;
+            if (!(ev[k].events & EPOLLIN)) continue;
+        }
+        if (ev[k].data.fd == g_tfd) {
+            uint64_t expirations;
+            (void)read(g_tfd, &expirations, sizeof(expirations)); // Timer quittieren, Prüfung in checkTimeout()
+            continue;
+        }
+
+        // Socket lesbar: alle anstehenden Antworten batchweise (recvmmsg) abholen
+        for (;;) {
+            for (int m = 0; m < g_batch; m++) {
+                g_rxiov[m].iov_base = g_rxbuf[m];
+                g_rxiov[m].iov_len = sizeof(g_rxbuf[m]);
+                memset(&g_rxmsg[m], 0, sizeof(g_rxmsg[m]));
+                g_rxmsg[m].msg_hdr.msg_iov = &g_rxiov[m];
+                g_rxmsg[m].msg_hdr.msg_iovlen = 1;
+            }
+
+            int got = recvmmsg(g_sock, g_rxmsg, (unsigned int)g_batch, MSG_DONTWAIT, NULL);
+            if (got < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                if (errno == EINTR) continue;
+                perror("recvmmsg");
+                return -1;
+            }
+            g_ack_rx_us = nowUs();
+            g_io.rx_calls++;
+            g_io.rx_packets += (unsigned long)got;
+
+            for (int m = 0; m < got; m++) {
+                struct answer a;
+                memset(&a, 0, sizeof(a));
+                if (wireDecodeAnswer(g_rxbuf[m], g_rxmsg[m].msg_len, &a) < 0) {
+                    fprintf(stderr, "recvmmsg: malformed answer (%u bytes)\n", g_rxmsg[m].msg_len);
+                    continue; // falsches Format -> ignoriert
+                }
+
+                handleAnswer(&a);
+                if (!haveAns || answerRank(&a) >= answerRank(outAns)) {
+                    *outAns = a;
+                }
+                haveAns = 1;
+            }
+
+            if (got < g_batch) break; // Socket ist leer
+        }
+    }
+    return haveAns;
+}
+
+
+
+/*
+ * doRequest:
+ *   - ReqHello: einmaliger Handshake mit eigenem Timeout
+ *   - ReqData / ReqClose: Go-Back-N-Sendealgorithmus mit Fenster 
+ *
+ * Zwei Engines (arqSetEngine):
+ *   - ARQ_ENGINE_SLOT : ein Schritt = ein Slot (GBN_TIMEOUT_INT_MS), max. 1 Paket pro Slot,
+ *                       bei frühem ACK idle bis Slotende (Kompatibilitätsmodus)
+ *   - ARQ_ENGINE_EVENT: ein Schritt = ein Ereignis: sendet alles, was das Fenster erlaubt,
+ *                       und wartet dann auf ACKs oder Timerablauf (epoll + timerfd)
+ *
+ * Parameter:
+ *   req        : neues Request-Paket, wird in den Ringpuffer eingereiht
+ *                (NULL = nur ARQ weiterlaufen lassen)
+ *   winSize    : Fenstergröße (1..ausgehandeltes Maximum)
+ *   windowFull : optionaler Rückgabewert, ob das Sendefenster (oder beim
+ *                Einreihen von req der Ringpuffer) voll ist
+ *
+ * Rückgabewert:
+ *   - Zeiger auf empfangene Antwort (struct answer)
+ *   - NULL, wenn in diesem Schritt keine relevante Antwort
+ *     eingetroffen ist
+ */
+static struct answer *doRequest(struct request *req, int winSize, int *windowFull, int *retransmission) {
+
+    static struct answer ans;
+
+    statsPoll(); // SIGUSR1 -> Zwischenstand nach stderr
+
+    // Rückgabeflags defaulten
+    if (windowFull) *windowFull = 0;
+    if (retransmission) *retransmission = 0;
+
+    // Fenstergröße nur clampen (Reset passiert z.B. in arqSendHello via resetSenderState)
+    if (winSize < 1) winSize = 1;
+    if (winSize > g_winMax) winSize = g_winMax;
+    g_win = winSize;
+
+    /* ------------------ (0) Einreihen: neues Paket in den Ringpuffer ------------------ */
+    if (req != NULL) {
+        enqueueRequest(req, req->name, 0, windowFull);
+    }
+
+    // Pfad-MTU-Suche läuft neben den Daten (Antworten werden mit den ACKs gelesen)
+    probeTick();
+
+    if (g_engine == ARQ_ENGINE_EVENT) {
+        /* ------------------ Event-Engine: senden, solange das Fenster offen ist ------------------ */
+        if (sendPending((int)g_ring, windowFull, retransmission) < 0) return NULL;
+
+        // Nichts unterwegs -> es gibt kein Ereignis, auf das gewartet werden könnte
+        if (g_inFlight <= 0) return NULL;
+
+        int wrc = waitForEvents(&ans); // ACKs werden dabei bereits ausgewertet
+        if (wrc < 0) return NULL;
+
+        checkTimeout(retransmission);
+        return (wrc == 1) ? &ans : NULL;
+    }
+
+    /* ------------------ (1) Sendephase: max 1 Paket pro Slot ------------------ */
+    if (sendPending(1, windowFull, retransmission) < 0) return NULL;
+
+    /* ------------------ (2) Empfangsphase: ACK oder Slotende ------------------ */
+    int wrc = waitForAckOneSlot(&ans); // select() wartet bis ACK oder Slotende; bei frühem ACK idle
+    if (wrc < 0) return NULL;
+
+    int  haveAns = (wrc == 1);
+
+    if (haveAns) {
+        handleAnswer(&ans);
+    }
+
+    /* ------------------ (3) Slotende: Timer prüfen / Timeout ------------------ */
+    // Timer wird am Slotende geprüft (auch wenn ACK früh kam -> idle bis Slotende)
+    checkTimeout(retransmission);
+
+    return haveAns ? &ans : NULL; 
+}
+
+
+/* --------------------------------------------------------------- */
+/*  Externe ARQ-API (Wrapper um doRequest)                         */
+/* --------------------------------------------------------------- */
+
+
+void arqSetCongestion(int algo)
+{
+    g_ccAlgo = algo;
+}
+
+
+
+void arqSetTrace(FILE *f)
+{
+    g_trace = f;
+    g_trace_t0 = nowUs();
+    if (g_trace) {
+        fprintf(g_trace, "t_us,event,cwnd,ssthresh,window,inflight,srtt_us,rate_pps\n");
+    }
+}
+
+
+
+void arqSetMode(int mode)
+{
+    g_modeWanted = (mode == ARQ_MODE_SR) ? ARQ_MODE_SR : ARQ_MODE_GBN;
+}
+
+
+
+void arqSetFileSize(unsigned long long size)
+{
+    g_fileSize = size;
+}
+
+
+
+int arqGetWindow(void)
+{
+    return g_winMax;
+}
+
+
+
+int arqGetMode(void)
+{
+    return g_mode;
+}
+
+
+
+void arqSetDupAckThreshold(int dupAcks)
+{
+    g_dupThresh = (dupAcks < 0) ? 0 : dupAcks;
+}
+
+
+
+void arqSetZeroCopy(int on)
+{
+    g_zeroCopy = on ? 1 : 0;
+}
+
+
+
+void arqSetEngine(int engine)
+{
+    g_engine = (engine == ARQ_ENGINE_SLOT) ? ARQ_ENGINE_SLOT : ARQ_ENGINE_EVENT;
+}
+
+
+
+void arqSetFastOpen(int on)
+{
+    g_fastOpen = on ? 1 : 0;
+}
+
+
+
+void arqSetPayloadMax(unsigned long bytes)
+{
+    if (bytes < BufferSize) bytes = BufferSize;
+    if (bytes > ARQ_PAYLOAD_MAX) bytes = ARQ_PAYLOAD_MAX;
+    g_payloadWant = bytes;
+}
+
+
+
+unsigned long arqGetPayload(void)
+{
+    return __atomic_load_n(&g_payload, __ATOMIC_RELAXED);
+}
+
+
+
+unsigned long arqGetPayloadMax(void)
+{
+    return g_payloadMax;
+}
+
+
+
+// FlNr eines Hello-ACKs auf die Bits beschränken, die der Server für dieses HELLO setzen darf.
+// Alte Server lassen FlNr uninitialisiert: sind unbekannte Bits gesetzt, gilt keine Zusage
+// (GBN, kein 0-RTT, BufferSize).
+static unsigned long helloAnswFlags(unsigned long flNr) {
+    unsigned long known = HELLO_ANSW_MODE | HELLO_ANSW_FASTOPEN | HELLO_ANSW_DATA;
+
+    if (g_payloadWant > BufferSize) known |= 0xFFFFUL << HELLO_ANSW_PAYLOAD_SHIFT; // nur mit HELLO_FLAG_PAYLOAD
+    if ((flNr & ~known) != 0) return 0;
+    if ((flNr & HELLO_ANSW_MODE) > ARQ_MODE_SR) return 0;
+    return flNr;
+}
+
+
+
+// Start-Seq. für einen neuen Transfer: zufällig (ARQ_INITIAL_SEQ nur zum Test)
+static uint32_t pickIsn(void) {
+#ifdef ARQ_INITIAL_SEQ
+    return (uint32_t)ARQ_INITIAL_SEQ;
+#else
+    uint32_t isn;
+    if (getrandom(&isn, sizeof(isn), GRND_NONBLOCK) != (ssize_t)sizeof(isn)) {
+        isn = (uint32_t)nowUs() ^ ((uint32_t)getpid() << 16); // Entropie noch nicht bereit
+    }
+    return isn;
+#endif
+}
+
+
+
+/*
+ * helloExchange: HELLO senden und das Hello-ACK abwarten, danach Fenster,
+ * Modus und Ringpuffer übernehmen. hello ist der vorbereitete Request mit
+ * den HELLO-Optionen und ggf. 0-RTT-Nutzdaten dahinter.
+ * Rückgabewert: 0 bei Erfolg, !=0 bei Fehler.
+ */
+static int helloExchange(int winSize, struct request *hello) {
+    struct request req = *hello; //Request-Paket (Kopie, der Aufrufer behält die Nutzdaten)
+
+    // Gewünschtes Fenster, der Server kann es im Hello-ACK verkleinern
+    if (winSize < 1) winSize = 1;
+    if (winSize > ARQ_MAX_WINDOW) winSize = ARQ_MAX_WINDOW;
+    g_winMax = winSize;
+    if (ringAlloc(winSize, BufferSize) < 0) return 1;
+    probeStart(BufferSize); // bis zum Hello-ACK gilt BufferSize
+
+    // Senderzustand komplett resetten (Fenster, Timer, Retransmit, Ringpuffer)
+    g_isn = pickIsn();
+    resetSenderState(winSize, g_isn);
+
+    // Hello-Request vorbereiten
+    req.ReqType = ReqHello; //HELLO-Pakettyp setzen
+    if (req.FlNr < HELLO_OPT_LEN) req.FlNr = HELLO_OPT_LEN; //HELLO-Optionen als Nutzdaten
+    req.name[HELLO_OPT_MODE] = (char)g_modeWanted; //gewünschter ARQ-Modus
+    wirePutU32((unsigned char *)&req.name[HELLO_OPT_WINDOW], (uint32_t)winSize); //gewünschtes Fenster
+    wirePutU32((unsigned char *)&req.name[HELLO_OPT_ISN], g_isn); //erstes DATA-Paket
+    wirePutU32((unsigned char *)&req.name[HELLO_OPT_SIZE], (uint32_t)(g_fileSize >> 32)); //Dateigröße, obere 32 Bit
+    wirePutU32((unsigned char *)&req.name[HELLO_OPT_SIZE + 4], (uint32_t)g_fileSize); //... untere 32 Bit
+    req.name[HELLO_OPT_FLAGS] = HELLO_FLAG_SACK | HELLO_FLAG_RWND; //SACK-Blöcke (Server nutzt sie nur bei SR) und Empfangsfenster verstanden
+    if (g_fastOpen) req.name[HELLO_OPT_FLAGS] |= HELLO_FLAG_FASTOPEN; //0-RTT, ggf. mit Nutzdaten hinter den Optionen
+    if (g_payloadWant > BufferSize) req.name[HELLO_OPT_FLAGS] |= HELLO_FLAG_PAYLOAD; //größere Pakete nach Zusage und Probe
+
+    // Wichtig: SeNr muss zum Senderzustand passen (erstes Paket: g_next == g_isn)
+    req.SeNr = g_next; //bei HELLO keine Sequenznummer nötig
+
+    int windowFull = 0;
+    int retransmission = 0;
+
+    int hello_sent = 0;
+    long long waitStart = nowUs(); // 0-RTT mit der ganzen Datei: Server kann schon beendet sein
+
+    // Slot-Schleife: pro Intervall max 1 neues Paket; wenn ACK früh kommt -> idle passiert in waitForAckOneSlot()
+    for (;;) {
+        struct answer *ans;
+        
+        if (!hello_sent) {
+            // Erstes Intervall: Hello als "neues Paket" in den ARQ-Core geben
+            ans = doRequest(&req, g_win, &windowFull, &retransmission);
+            hello_sent = 1;
+        }else {
+            // Danach: keine neuen Pakete, nur ARQ weiterlaufen lassen (ACKs/Timeout/Retx)
+            ans = doRequest(NULL, g_win, &windowFull, &retransmission);
+        }
+
+        // doRequest liefert NULL, wenn in diesem Slot kein ACK kam -> weiter im nächsten Slot
+        if (ans == NULL) {
+            // Trug das HELLO die ganze Datei (REQ_FLAG_EOS), ist ein Server mit -n nach dem
+            // (verlorenen) Hello-ACK schon weg; ob die Daten ankamen, ist dann unbekannt
+            if ((req.Flags & REQ_FLAG_EOS) && nowUs() - waitStart >= GBN_CLOSE_MAX_WAIT_MS * 1000LL) {
+                fprintf(stderr, "arqSendHello: no answer for %d ms to 0-RTT hello, transfer state unknown\n",
+                        GBN_CLOSE_MAX_WAIT_MS);
                 return 1;
             }
+            continue;
+        }
 
-            if (ans->AnswType == AnswWarn) {
-                unsigned long code = ans->ErrNo;
-                if (code < 8) {
-                    fprintf(stderr, "arqSendData: warning %lu (%s)\n", code, errorTable[code]);
+        // Antwort auswerten
+        if (ans->AnswType == AnswHello || ans->AnswType == AnswOk) {
+            // Fenster übernehmen; alte Server melden keins -> GBN_MAX_WINDOW
+            unsigned long granted = (ans->AnswType == AnswHello) ? ans->SeNo : 0;
+            if (granted == 0) granted = GBN_MAX_WINDOW;
+            if (granted > ARQ_MAX_WINDOW) granted = ARQ_MAX_WINDOW;
+            g_winMax = (int)granted;
+
+            // Nutzdaten je Paket: alte Server gewähren keine -> BufferSize; eigene Obergrenze
+            // und Fenster mal Nutzdaten (Ringpuffer) begrenzen zusätzlich
+            unsigned long answFlags = (ans->AnswType == AnswHello) ? helloAnswFlags(ans->FlNr) : 0;
+            unsigned long payloadMax = answFlags >> HELLO_ANSW_PAYLOAD_SHIFT;
+            if (payloadMax > g_payloadWant) payloadMax = g_payloadWant;
+            if (payloadMax > (unsigned long)(ARQ_WINDOW_BYTES_MAX / g_winMax)) {
+                payloadMax = (unsigned long)(ARQ_WINDOW_BYTES_MAX / g_winMax);
+            }
+            if (payloadMax < BufferSize) payloadMax = BufferSize;
+            if (ringAlloc(g_winMax, payloadMax) < 0) return 1;
+
+            // Socketpuffer für ein volles Fenster (Datenpakete senden, ACKs empfangen)
+            long want = (long)g_winMax * ARQ_SOCKBUF_FOR(payloadMax);
+            int sockbuf = (want < ARQ_SOCKBUF_MAX) ? (int)want : ARQ_SOCKBUF_MAX;
+            setsockopt(g_sock, SOL_SOCKET, SO_SNDBUF, &sockbuf, sizeof(sockbuf));
+            setsockopt(g_sock, SOL_SOCKET, SO_RCVBUF, &sockbuf, sizeof(sockbuf));
+
+            // Zero-Copy nur in der Event-Engine (sie wertet EPOLLERR aus)
+            if (g_zeroCopy && g_engine == ARQ_ENGINE_EVENT && !g_zcActive) {
+                int one = 1;
+                if (setsockopt(g_sock, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0) {
+                    g_zcActive = 1;
                 } else {
-                    fprintf(stderr, "arqSendData: warning %lu\n", code);
+                    perror("setsockopt(SO_ZEROCOPY), sending with copies");
+                }
+            }
+
+            // 0-RTT nur, wenn der Server es ausdrücklich bestätigt; angenommene Nutzdaten belegen die Start-Seq.
+            g_fastOk = g_fastOpen && (answFlags & HELLO_ANSW_FASTOPEN);
+            int dataTaken = g_fastOk && req.FlNr > HELLO_OPT_LEN && (answFlags & HELLO_ANSW_DATA);
+
+            resetSenderState(winSize, dataTaken ? SEQ_ADD(g_isn, 1) : g_isn);
+            if (ans->RwndValid) g_rwnd = ans->Rwnd;
+            probeStart(payloadMax); // größere Pakete erst nach bestandener Probe
+            if (dataTaken) {
+                hello->FlNr = HELLO_OPT_LEN; // Nutzdaten sind beim Server, nicht erneut senden
+                if (req.Flags & REQ_FLAG_EOS) {
+                    g_eosQueued = 1; // Datei ist schon komplett übertragen
+                    g_eosSeq = g_isn;
                 }
-                // Warn ist nicht zwingend fatal -> weiterlaufen bis bestätigt
             }
 
-            // AnswOk/AnswHello:
-            // Fenster-Sliding passiert bereits in doRequest() über slideWindowTo()
+            // Modus nur übernehmen, wenn der Server ihn ausdrücklich bestätigt (alte Server -> GBN)
+            g_mode = ARQ_MODE_GBN;
+            if (ans->AnswType == AnswHello && g_modeWanted == ARQ_MODE_SR &&
+                (answFlags & HELLO_ANSW_MODE) == ARQ_MODE_SR) {
+                g_mode = ARQ_MODE_SR;
+            }
+            return 0; // Erfolg
+        }
+        if (ans->AnswType == AnswErr) {
+            checkAnswer("arqSendHello", ans); // z.B. ERR_SERVER_BUSY melden
+            return 1; // Serverfehler -> abbrechen
+        }
+
+        // Warnung o.ä. ignorieren hier und weiter warten
+    }
+}
+
+
+
+int arqSendHello(int winSize)
+{
+    memset(&g_helloReq, 0, sizeof(g_helloReq)); //alles auf 0, damit keine Zufallswerte drin sind
+    g_fastOk = 0;
+    g_helloWin = 0;
+
+    // 0-RTT: HELLO erst mit den ersten Nutzdaten (bzw. beim Close) senden, Fehler melden dann diese
+    if (g_fastOpen) {
+        if (winSize < 1) winSize = 1;
+        if (winSize > ARQ_MAX_WINDOW) winSize = ARQ_MAX_WINDOW;
+        g_winMax = winSize;
+        g_mode = g_modeWanted;
+        g_helloWin = winSize;
+        return 0;
+    }
+    return helloExchange(winSize, &g_helloReq);
+}
+
+
+
+static int enqueueData(const char *buf, unsigned long len, unsigned int flags, int winSize, int byRef);
+
+/*
+ * helloFlush: ausstehendes 0-RTT-HELLO samt gesammelter Nutzdaten senden,
+ * mit eos als letztes Paket der Datei. Nimmt der Server die Nutzdaten nicht
+ * an (alter Server, Schreib-Queue voll), werden sie als erstes DATA-Paket
+ * eingereiht. Rückgabewert: 0 bei Erfolg, !=0 bei Fehler.
+ */
+static int helloFlush(int eos) {
+    int winSize = g_helloWin;
+
+    if (winSize == 0) return 0;
+    g_helloWin = 0;
+
+    if (eos && g_helloReq.FlNr > HELLO_OPT_LEN) g_helloReq.Flags |= REQ_FLAG_EOS;
+    if (helloExchange(winSize, &g_helloReq) != 0) return 1;
+
+    if (g_helloReq.FlNr > HELLO_OPT_LEN) {
+        return enqueueData(g_helloReq.name + HELLO_OPT_LEN, g_helloReq.FlNr - HELLO_OPT_LEN,
+                           g_helloReq.Flags, winSize, 0);
+    }
+    return 0;
+}
+
+
+
+/*
+ * helloTake: wie viele Bytes von buf noch ins ausstehende HELLO passen.
+ * Zeilen (REQ_FLAG_LINES) nur ganz, einzelne Zeilen (Flags 0) nur
+ * komplett, Binärblöcke beliebig geteilt. 0 = nichts übernehmen.
+ */
+static unsigned long helloTake(const char *buf, unsigned long len, unsigned int flags) {
+    unsigned long used = (g_helloReq.FlNr > HELLO_OPT_LEN) ? g_helloReq.FlNr - HELLO_OPT_LEN : 0;
+    unsigned long room = HELLO_DATA_MAX - used;
+
+    // Nur Einheiten gleicher Art zusammenfassen, einzelne Zeilen nie
+    if (used > 0 && (flags != g_helloReq.Flags || !(flags & (REQ_FLAG_LINES | REQ_FLAG_BLOCK)))) return 0;
+    if (len <= room) return len;
+    if (flags & REQ_FLAG_BLOCK) return room;
+    if (flags & REQ_FLAG_LINES) {
+        const char *nl = memrchr(buf, '\n', room);
+        return nl ? (unsigned long)(nl - buf) + 1 : 0;
+    }
+    return 0;
+}
+
+
+
+/*
+ * checkAnswer: gemeinsame Auswertung von Warn/Err-Antworten für die API-Funktionen.
+ * Rückgabewert: 1 bei AnswErr (fatal, g_error wird gesetzt), sonst 0.
+ */
+static int checkAnswer(const char *who, const struct answer *ans) {
+    if (ans == NULL) return 0;
+
+    // Rückstau ist Flusskontrolle, keine Meldung wert (Zähler backpressure_received)
+    if (ans->AnswType == AnswWarn && ans->ErrNo == ERR_BACKPRESSURE) return 0;
+
+    if (ans->AnswType == AnswErr || ans->AnswType == AnswWarn) {
+        const char *kind = (ans->AnswType == AnswErr) ? "server error" : "warning";
+        unsigned long code = ans->ErrNo;
+        if (code < 8) {
+            fprintf(stderr, "%s: %s %lu (%s)\n", who, kind, code, errorTable[code]);
+        } else {
+            fprintf(stderr, "%s: %s %lu\n", who, kind, code);
+        }
+        // Warn ist nicht zwingend fatal -> weiterlaufen bis bestätigt
+        if (ans->AnswType == AnswErr) {
+            g_error = 1;
+            return 1;
+        }
+    }
+    // AnswOk/AnswHello: Fenster-Sliding passiert bereits in doRequest() über slideWindowTo()
+    return 0;
+}
+
+
+
+// Daten-Request bauen (SeNr = nächste freie Sequenznummer im Ringpuffer)
+// Die Nutzdaten kopiert enqueueRequest direkt in den Slot, req->name bleibt leer.
+static void buildDataRequest(struct request *req, unsigned long len, unsigned int flags) {
+    req->ReqType = ReqData;
+    req->Flags = (unsigned short)flags;
+
+    // Länge begrenzen (im HELLO gewährte Nutzdaten, mind. BufferSize aus data.h)
+    if (len > g_payloadMax) len = g_payloadMax;
+    req->FlNr = len;
+
+    // Sequenznummer für dieses (genau ein) Datenpaket festlegen
+    // Wichtig: beim Einreihen muss req->SeNr == g_tail sein
+    req->SeNr = g_tail;
+}
+
+
+
+int arqSendData(const struct app_unit *app, int winSize) {
+
+    if (app == NULL) return 1;
+    if (helloFlush(0) != 0) return 1;
+
+    // Fenstergröße clampen
+    if (winSize < 1) winSize = 1;
+    if (winSize > g_winMax) winSize = g_winMax;
+
+    struct request req;
+    memset(&req, 0, sizeof(req));
+    buildDataRequest(&req, (app->len < BufferSize) ? app->len : BufferSize, 0);
+    memcpy(req.name, app->data, (size_t)req.FlNr); // doRequest reiht req.name ein
+    uint32_t mySeq = (uint32_t)req.SeNr;
+
+    int windowFull = 0;
+    int retransmission = 0;
+
+    int queued = 0; // wurde dieses Paket bereits in den Ringpuffer eingereiht?
+
+    for (;;) {
+        // Erfolg: Unser Paket ist kumulativ bestätigt -> base ist über unsere SeNr hinaus
+        if (SEQ_LT(mySeq, g_base)) {
+            return 0;
+        }
+
+        struct answer *ans;
+
+        if (!queued) {
+            // Paket als "neu" anbieten: doRequest reiht es nur ein, wenn der Ringpuffer Platz hat
+            ans = doRequest(&req, winSize, &windowFull, &retransmission);
+
+            // Eingereiht hat doRequest g_tail hochgezählt -> req.SeNr < g_tail
+            if (SEQ_LT(req.SeNr, g_tail)) {
+                queued = 1;
+            }
+        } else {
+            // Unser Paket ist schon unterwegs -> keine neuen Pakete mehr,
+            // nur ACKs/Timeout/Go-Back-N-ReTx weiter abarbeiten
+            ans = doRequest(NULL, winSize, &windowFull, &retransmission);
+        }
+
+        // Antwort auswerten (falls in diesem Slot etwas kam)
+        if (checkAnswer("arqSendData", ans)) {
+            return 1;
         }
 
         // ans == NULL -> kein ACK in diesem Slot, nächster Slot
@@ -534,11 +1795,201 @@ int arqSendData(const struct app_unit *app, int winSize) {
 
 
 
+/* --------------------------------------------------------------- */
+/*  Pipelined API: Einreihen / Poll / Flush                        */
+/* --------------------------------------------------------------- */
+
+int arqEnqueueData(const struct app_unit *app, int winSize) {
+
+    if (app == NULL) return 1;
+
+    return arqEnqueueBuf(app->data, app->len, 0, winSize);
+}
+
+
+
+// Gemeinsamer Teil von arqEnqueueBuf / arqEnqueueRef
+static int enqueueData(const char *buf, unsigned long len, unsigned int flags, int winSize, int byRef) {
+
+    if (buf == NULL && len > 0) return 1;
+    if (g_error) return 1;
+
+    // 0-RTT: Nutzdaten im ausstehenden HELLO sammeln, bis es voll ist
+    if (g_helloWin) {
+        unsigned long take = helloTake(buf, len, flags);
+        if (take > 0) {
+            if (g_helloReq.FlNr < HELLO_OPT_LEN) g_helloReq.FlNr = HELLO_OPT_LEN;
+            memcpy(g_helloReq.name + g_helloReq.FlNr, buf, (size_t)take);
+            g_helloReq.FlNr += take;
+            g_helloReq.Flags = (unsigned short)flags;
+            buf += take;
+            len -= take;
+            if (len == 0) return 0;
+        }
+        if (helloFlush(0) != 0) return 1;
+    }
+
+    // REQ_FLAG_EOS nur, wenn der Server es versteht (sonst folgt ein CLOSE)
+    if (flags & REQ_FLAG_EOS) {
+        if (g_fastOk) {
+            g_eosQueued = 1;
+            g_eosSeq = g_tail;
+        } else {
+            flags &= ~(unsigned int)REQ_FLAG_EOS;
+        }
+    }
+
+    // Fenstergröße clampen
+    if (winSize < 1) winSize = 1;
+    if (winSize > g_winMax) winSize = g_winMax;
+    g_win = winSize;
+
+    // Ringpuffer voll -> so lange Slots abarbeiten, bis ein Platz frei wird
+    while (g_tail - g_base >= g_ring) {
+        if (arqPoll(winSize) < 0) return 1;
+    }
+
+    struct request req;
+    buildDataRequest(&req, len, flags);
+
+    // Direkt einreihen, gesendet wird in den folgenden Schritten (arqPoll/arqFlush)
+    enqueueRequest(&req, buf, byRef && len > 0, NULL);
+    if (g_error) return 1;
+
+    // Event-Engine: sobald ein voller Batch ansteht, schon hier senden
+    if (g_engine == ARQ_ENGINE_EVENT && (int)(g_tail - g_next) >= g_batch) {
+        return arqPush(winSize);
+    }
+
+    return 0;
+}
+
+
+
+int arqEnqueueBuf(const char *buf, unsigned long len, unsigned int flags, int winSize) {
+    return enqueueData(buf, len, flags, winSize, 0);
+}
+
+
+
+int arqEnqueueRef(const char *buf, unsigned long len, unsigned int flags, int winSize) {
+    return enqueueData(buf, len, flags, winSize, 1);
+}
+
+
+
+int arqPush(int winSize) {
+
+    if (g_error) return 1;
+    if (helloFlush(0) != 0) return 1; // Eingabe stockt: 0-RTT-HELLO nicht länger zurückhalten
+
+    // Slot-Engine sendet nur im Slot-Takt (arqPoll)
+    if (g_engine != ARQ_ENGINE_EVENT) return 0;
+
+    if (winSize < 1) winSize = 1;
+    if (winSize > g_winMax) winSize = g_winMax;
+    g_win = winSize;
+
+    int windowFull = 0;
+    int retransmission = 0;
+
+    // Pfad-MTU-Suche auch hier weiterführen: bei stockender Eingabe kommt arqPoll selten
+    probeTick();
+
+    return (sendPending((int)g_ring, &windowFull, &retransmission) < 0) ? 1 : 0;
+}
+
+
+
+int arqPoll(int winSize) {
+
+    if (g_error) return -1;
+    if (helloFlush(0) != 0) return -1;
+
+    int windowFull = 0;
+    int retransmission = 0;
+
+    struct answer *ans = doRequest(NULL, winSize, &windowFull, &retransmission);
+    if (checkAnswer("arqPoll", ans)) {
+        return -1;
+    }
+
+    // Anzahl noch nicht bestätigter (gesendeter + eingereihter) Pakete
+    return (int)(g_tail - g_base);
+}
+
+
+
+int arqFlush(int winSize) {
+
+    int rc;
+
+    // So lange Slots abarbeiten, bis alles eingereihte kumulativ bestätigt ist
+    while ((rc = arqPoll(winSize)) > 0) {
+    }
+
+    return (rc < 0) ? 1 : 0;
+}
+
+
+
+/*
+ * eosWait: 0-RTT-Abschluss ohne CLOSE - warten, bis das Paket mit
+ * REQ_FLAG_EOS bestätigt ist. Der Server kann danach schon beendet sein:
+ * ist nur noch dieses Paket offen, nach GBN_CLOSE_MAX_WAIT_MS ohne jede
+ * Antwort aufgeben (wie beim CLOSE).
+ */
+static int eosWait(int winSize) {
+    int windowFull = 0;
+    int retransmission = 0;
+    long long waitStart = nowUs();
+
+    while (!SEQ_LT(g_eosSeq, g_base)) {
+        struct answer *ans = doRequest(NULL, winSize, &windowFull, &retransmission);
+        if (checkAnswer("arqSendClose", ans)) {
+            return 1;
+        }
+        if (g_base != g_eosSeq) {
+            waitStart = nowUs(); // vorher offene Daten: Server muss noch antworten
+            continue;
+        }
+        long long lastSign = (g_last_answer_us > waitStart) ? g_last_answer_us : waitStart;
+        if (nowUs() - lastSign >= GBN_CLOSE_MAX_WAIT_MS * 1000LL) {
+            fprintf(stderr, "arqSendClose: no answer for %d ms, assuming server closed\n",
+                    GBN_CLOSE_MAX_WAIT_MS);
+            return 0;
+        }
+    }
+    return 0;
+}
+
+
+
 int arqSendClose(int winSize)
 {
     // Fenstergröße clampen (ARQ-State bleibt erhalten)
     if (winSize < 1) winSize = 1;
-    if (winSize > GBN_MAX_WINDOW) winSize = GBN_MAX_WINDOW;
+    if (winSize > g_winMax) winSize = g_winMax;
+
+    // 0-RTT: kleine Dateien liegen noch komplett im HELLO -> als letztes Paket senden
+    if (helloFlush(1) != 0) return 1;
+
+    // 0-RTT: CLOSE ins letzte eingereihte, noch nicht gesendete Paket falten
+    if (g_fastOk && !g_eosQueued && !g_error && SEQ_LT(g_next, g_tail)) {
+        uint32_t last = SEQ_ADD(g_tail, -1);
+        wireOrRequestFlags(slotBuf(idxOf(last)), REQ_FLAG_EOS);
+        g_eosQueued = 1;
+        g_eosSeq = last;
+    }
+    if (g_eosQueued) {
+        return g_error ? 1 : eosWait(winSize);
+    }
+
+    // Pipeline leeren: alle eingereihten Datenpakete müssen vor dem Close bestätigt sein
+    if (arqFlush(winSize) != 0) {
+        fprintf(stderr, "arqSendClose: pipeline could not be drained\n");
+        return 1;
+    }
 
     struct request req;
     memset(&req, 0, sizeof(req));
@@ -547,8 +1998,8 @@ int arqSendClose(int winSize)
     req.FlNr = 0;
 
     // Close ist ein normales GBN-Paket mit eigener Sequenznummer
-    // doRequest erwartet: req.SeNr == g_next, wenn es als neues Paket gesendet wird.
-    unsigned long mySeq = g_next;
+    // doRequest erwartet: req.SeNr == g_tail, wenn es als neues Paket eingereiht wird.
+    uint32_t mySeq = g_tail;
     req.SeNr = mySeq;
 
     //Nutzdaten bei Close nicht relevant, aber sauber nullen
@@ -557,11 +2008,12 @@ int arqSendClose(int winSize)
     int windowFull = 0;
     int retransmission = 0;
 
-    int queued = 0; // wurde Close bereits als neues Paket tatsächlich gesendet/eingequeued?
+    int queued = 0; // wurde Close bereits als neues Paket eingereiht?
+    long long waitStart = nowUs(); // Beginn des Wartens auf das Close-ACK
 
     for (;;) {
         // Erfolg: Close wurde kumulativ bestätigt, Fensterbasis ist weiter als unsere Close-Sequenz
-        if (g_base > mySeq) {
+        if (SEQ_LT(mySeq, g_base)) {
             return 0;
         }
 
@@ -571,9 +2023,8 @@ int arqSendClose(int winSize)
             // Close als neues Paket anbieten (max 1 Sendung pro Slot)
             ans = doRequest(&req, winSize, &windowFull, &retransmission);
 
-            // Wenn Fenster voll war, wurde es NICHT gesendet -> im nächsten Slot erneut versuchen
-            // Wenn es gesendet wurde, erhöht doRequest g_next um 1
-            if (!windowFull && req.SeNr < g_next) {
+            // Wenn der Ringpuffer voll war, wurde es NICHT eingereiht -> im nächsten Slot erneut versuchen
+            if (SEQ_LT(req.SeNr, g_tail)) {
                 queued = 1;
             }
         }else {
@@ -581,29 +2032,18 @@ int arqSendClose(int winSize)
             ans = doRequest(NULL, winSize, &windowFull, &retransmission);
         }
 
-        // Antwort auswerten (falls in diesem Slot was kam
-        if (ans != NULL) {
-            if (ans->AnswType == AnswErr) {
-                unsigned long code = ans->ErrNo;
-                if (code < 8) {
-                    fprintf(stderr, "arqSendClose: server error %lu (%s)\n", code, errorTable[code]);
-                }else {
-                    fprintf(stderr, "arqSendClose: server error %lu\n", code);
-                }
-                return 1;
-            }
+        // Antwort auswerten (falls in diesem Slot was kam)
+        if (checkAnswer("arqSendClose", ans)) {
+            return 1;
+        }
 
-            if (ans->AnswType == AnswWarn) {
-                unsigned long code = ans->ErrNo;
-                if (code < 8) {
-                    fprintf(stderr, "arqSendClose: warning %lu (%s)\n", code, errorTable[code]);
-                }else {
-                    fprintf(stderr, "arqSendClose: warning %lu\n", code);
-                }
-                // Warn ist nicht zwingend fatal -> weiterlaufen lassen bis Close bestätigt ist
-            }
-            // AnswOk/AnswHello: Fenster-Sliding passiert in doRequest() bereits
+        // Der Server beendet sich nach dem Close. Geht das Close-ACK verloren, kommt
+        // keine Antwort mehr -> nach GBN_CLOSE_MAX_WAIT_MS ohne jede Antwort aufgeben.
+        long long lastSign = (g_last_answer_us > waitStart) ? g_last_answer_us : waitStart;
+        if (nowUs() - lastSign >= GBN_CLOSE_MAX_WAIT_MS * 1000LL) {
+            fprintf(stderr, "arqSendClose: no answer for %d ms, assuming server closed\n",
+                    GBN_CLOSE_MAX_WAIT_MS);
+            return 0;
         }
-        // wenn ans == NULL: kein ACK in diesem Slot -> nächster Slot
     }
 }
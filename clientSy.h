@@ -1,6 +1,8 @@
 #ifndef CLIENTSY_H
 #define CLIENTSY_H
 
+#include <stdio.h>
+
 #include "data.h"
 
 /*
@@ -12,12 +14,104 @@
  *   - ARQ-Protokoll (Fenster, Timer, Retransmits)
  */
 
+/* Sende-Engines (arqSetEngine) */
+#define ARQ_ENGINE_EVENT 0  /* ACK-getaktet, epoll + timerfd (Default)             */
+#define ARQ_ENGINE_SLOT  1  /* feste Slots à GBN_TIMEOUT_INT_MS, max. 1 Paket/Slot */
+
+/* Aktuelle RTT-Schätzung des Senders (RFC 6298), alle Zeiten in Mikrosekunden */
+struct arq_rtt_info {
+    long          srtt_us;    /* geglättete RTT                          */
+    long          rttvar_us;  /* RTT-Varianz                             */
+    long          rto_us;     /* aktueller Retransmission-Timeout        */
+    int           backoff;    /* Verdopplungen seit letzter Messung      */
+    unsigned long samples;    /* Anzahl gültiger Messungen (Karn)        */
+};
+
+/* Zähler der gebündelten Datagramm-I/O (Pakete / Systemaufrufe) */
+struct arq_io_stats {
+    unsigned long tx_packets;  /* gesendete Datagramme                    */
+    unsigned long tx_calls;    /* sendmmsg-Aufrufe                        */
+    unsigned long rx_packets;  /* empfangene Antworten                    */
+    unsigned long rx_calls;    /* recvmmsg/recvfrom-Aufrufe               */
+    unsigned long tx_retrans;  /* davon Wiederholungen                    */
+    unsigned long fast_retrans; /* Fast Retransmits (doppelte ACKs)       */
+    unsigned long zc_copied;   /* MSG_ZEROCOPY-Meldungen "doch kopiert"  */
+};
+
 /* UDP- und ARQ-Client initialisieren (Servername & Port) */
 void initClient(char *name, const char *port);
 
 /* UDP- und ARQ-Client schließen (Socket freigeben etc.) */
 void closeClient(void);
 
+/* Max. Datagramme pro sendmmsg/recvmmsg (1..ARQ_BATCH_MAX). */
+void arqSetBatchSize(int batch);
+
+/* Zähler der gebündelten I/O abfragen (z.B. zum Loggen). */
+void arqGetIoStats(struct arq_io_stats *stats);
+
+/* Aktuelle RTT-/RTO-Schätzung abfragen (z.B. zum Loggen). */
+void arqGetRttInfo(struct arq_rtt_info *info);
+
+/* Sende-Engine wählen (ARQ_ENGINE_EVENT / ARQ_ENGINE_SLOT), vor arqSendHello aufrufen. */
+void arqSetEngine(int engine);
+
+/* Staukontrolle wählen (CC_NONE / CC_RENO / CC_BBR aus cc.h), vor arqSendHello aufrufen.
+ * Gesendet wird höchstens min(cwnd, winSize).
+ */
+void arqSetCongestion(int algo);
+
+/* CSV-Trace von Staufenster und Rate je ACK/Timeout nach f schreiben (NULL = aus). */
+void arqSetTrace(FILE *f);
+
+/* Fast Retransmit nach dupAcks doppelten kumulativen ACKs (Default
+ * ARQ_DUPACK_THRESH, 0 = aus: Wiederholung nur nach Timeout).
+ */
+void arqSetDupAckThreshold(int dupAcks);
+
+/* MSG_ZEROCOPY für Datenpakete (nur Event-Engine), vor arqSendHello aufrufen.
+ * Lohnt nur mit arqEnqueueRef; schlägt SO_ZEROCOPY fehl, wird normal kopiert.
+ */
+void arqSetZeroCopy(int on);
+
+/* Gewünschten ARQ-Modus (ARQ_MODE_GBN / ARQ_MODE_SR) für das nächste Hello setzen.
+ * Der Server entscheidet im Hello-ACK; alte Server fallen auf Go-Back-N zurück.
+ */
+void arqSetMode(int mode);
+
+/* Gesamtgröße der Datei in Bytes für das nächste Hello (0 = unbekannt, z.B. Pipe).
+ * Der Server kann die Ausgabedatei damit vorab anlegen.
+ */
+void arqSetFileSize(unsigned long long size);
+
+/* Im Hello ausgehandelter ARQ-Modus. */
+int arqGetMode(void);
+
+/* Im Hello ausgehandelte maximale Fenstergröße (Pakete). */
+int arqGetWindow(void);
+
+/* 0-RTT (vor arqSendHello): das Hello wird erst mit den ersten eingereihten
+ * Nutzdaten gesendet und trägt sie mit, arqSendClose faltet das CLOSE in das
+ * letzte Paket (REQ_FLAG_EOS). Fehler des Hello melden dann diese Aufrufe;
+ * alte Server bekommen Daten und CLOSE wie bisher einzeln.
+ */
+void arqSetFastOpen(int on);
+
+/* Größte Nutzdaten je Paket (BufferSize..ARQ_PAYLOAD_MAX, vor arqSendHello).
+ * Mehr als BufferSize nur, wenn der Server es im Hello gewährt; genutzt wird
+ * eine Größe erst, nachdem eine Probe (ReqProbe) sie über den Pfad gebracht hat.
+ */
+void arqSetPayloadMax(unsigned long bytes);
+
+/* Bestätigte Nutzdatengröße für neue Pakete (BufferSize bis zur ersten
+ * bestandenen Probe, wächst während der Übertragung). Darf aus einem anderen
+ * Thread gelesen werden (z.B. Lese-Thread).
+ */
+unsigned long arqGetPayload(void);
+
+/* Im Hello gewährte Obergrenze der Nutzdaten je Paket. */
+unsigned long arqGetPayloadMax(void);
+
 /* Verbindungsaufbau: Hello senden, Antwort abwarten.
  * Rückgabewert: 0 bei Erfolg, !=0 bei Fehler.
  */
@@ -29,7 +123,48 @@ int arqSendHello(int winSize);
  */
 int arqSendData(const struct app_unit *app, int winSize);
 
-/* Verbindung ordentlich schließen (Close/ACK).
+/*
+ * Pipelined (nicht-blockierende) Sende-API:
+ * Bis zu winSize Pakete gleichzeitig "in flight", eingereihte Pakete
+ * werden in den folgenden Slots (arqPoll/arqFlush/arqSendClose) gesendet.
+ */
+
+/* Eine app_unit in den Ringpuffer einreihen, ohne auf das ACK zu warten.
+ * Blockiert nur, solange der Ringpuffer voll ist.
+ * Rückgabewert: 0 bei Erfolg, !=0 bei Fehler.
+ */
+int arqEnqueueData(const struct app_unit *app, int winSize);
+
+/* Wie arqEnqueueData, aber für beliebige Nutzdaten (max. arqGetPayloadMax(),
+ * sinnvoll arqGetPayload() Bytes) mit Payload-Flags (REQ_FLAG_LINES / REQ_FLAG_BLOCK, siehe data.h).
+ * Rückgabewert: 0 bei Erfolg, !=0 bei Fehler.
+ */
+int arqEnqueueBuf(const char *buf, unsigned long len, unsigned int flags, int winSize);
+
+/* Wie arqEnqueueBuf, aber ohne Kopie: der Ringpuffer merkt sich nur buf/len
+ * und sendet (auch bei Wiederholungen) direkt aus buf, z.B. aus einer per
+ * mmap eingeblendeten Datei. buf muss bis nach arqSendClose gültig bleiben.
+ * Rückgabewert: 0 bei Erfolg, !=0 bei Fehler.
+ */
+int arqEnqueueRef(const char *buf, unsigned long len, unsigned int flags, int winSize);
+
+/* Eingereihte Pakete sofort senden, soweit das Fenster Platz hat, ohne auf
+ * ACKs zu warten (z.B. wenn die Eingabe stockt). Nur Event-Engine.
+ * Rückgabewert: 0 bei Erfolg, !=0 bei Fehler.
+ */
+int arqPush(int winSize);
+
+/* Einen Protokollschritt (Slot) ausführen: senden, ACK auswerten, Timer.
+ * Rückgabewert: Anzahl noch unbestätigter Pakete (>=0), <0 bei Fehler.
+ */
+int arqPoll(int winSize);
+
+/* Warten, bis alle eingereihten Pakete bestätigt sind.
+ * Rückgabewert: 0 bei Erfolg, !=0 bei Fehler.
+ */
+int arqFlush(int winSize);
+
+/* Verbindung ordentlich schließen (Close/ACK), leert vorher die Pipeline.
  * Rückgabewert: 0 bei Erfolg, !=0 bei Fehler.
  */
 int arqSendClose(int winSize);
@@ -16,7 +16,7 @@
 
 #define DEFAULT_LOOPBACK_HOST "::1"
 
-#define BUFFER_SIZE          65500
+#define BUFFER_SIZE          65500         /* größte Nutzdaten je Paket (ARQ_PAYLOAD_MAX) */
 
 #define UNKNOWN_NAME "<unknown>"
 
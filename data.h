@@ -6,6 +6,8 @@
 #ifndef DATA_H_INCLUDED
 #define DATA_H_INCLUDED
 
+#include "config.h"   /* BUFFER_SIZE: Obergrenze der ausgehandelten Nutzdaten */
+
 /* Fehlertexte werden in error.c definiert */
 extern char *errorTable[];
 
@@ -26,16 +28,24 @@ struct app_unit {
  *   ReqHello : Verbindungsaufbau / Beginn der Übertragung
  *   ReqData  : Datenpaket
  *   ReqClose : Übertragung beendet
+ *   ReqProbe : Pfad-MTU-Probe (PLPMTUD), SeNr = Probe-Nummer, FlNr Bytes Füllung
  *
  * SeNr   : Paketnummer (0, 1, 2, ...) im ARQ-Protokoll
  *          (keine Byteposition)
  * FlNr   : Länge der Nutzdaten in Bytes
+ * Flags  : Aufbau der Nutzdaten bei ReqData (REQ_FLAG_*, 0 = eine Zeile)
  */
 struct request {
     unsigned char  ReqType;
 #define ReqHello 'H'
 #define ReqData  'D'
 #define ReqClose 'C'
+#define ReqProbe 'P'
+
+    unsigned short Flags;
+#define REQ_FLAG_LINES 0x0001  /* mehrere ganze Zeilen ('\n'-getrennt) in einem Paket */
+#define REQ_FLAG_BLOCK 0x0002  /* roher Binärblock ohne Zeilenstruktur             */
+#define REQ_FLAG_EOS   0x0004  /* letztes Paket, ersetzt das CLOSE (HELLO_FLAG_FASTOPEN) */
 
     unsigned long  FlNr;   /* Länge der übertragenen Daten in Bytes      */
     unsigned long  SeNr;   /* Byte-Offset (Sequence Number) im File      */
@@ -51,7 +61,9 @@ enum {
     ERR_WRONG_SEQ       = 1, /* falsche Sequenznummer / Out-of-order */
     ERR_FILE_ERROR      = 2, /* Datei konnte nicht verarbeitet werden */
     ERR_ILLEGAL_REQUEST = 3, /* falscher ReqType / Protokollverletzung */
-    /* 4–6 für eigene ARQ-Fehler reserviert */
+    ERR_BACKPRESSURE    = 4, /* Warn: Schreib-Queue voll, Paket nicht angenommen */
+    ERR_SERVER_BUSY     = 5, /* keine freie Session (Server voll) */
+    /* 6 für eigene ARQ-Fehler reserviert */
     ERR_INTERNAL        = 7
 };
 
@@ -61,24 +73,179 @@ enum {
  *  - AnswOk  : SeNo = Nummer des nächsten erwarteten Pakets
  *              (kumulativ: alle Pakete mit SeNr < SeNo sind korrekt angekommen)
  *  - AnswWarn/AnswErr : SeNo = Fehlercode (ERR_*)
+ *  - AnswWarn ERR_BACKPRESSURE: FlNr = kumulatives ACK wie SeNo bei AnswOk,
+ *              das Paket FlNr wurde nicht angenommen und ist zu wiederholen
+ *  - AnswProbe: SeNo = Nummer der Probe, FlNr = ihre Größe (Echo, kein ACK)
+ *
+ * SACK (nur SR, im HELLO ausgehandelt): Sack[0..SackCount) sind Bereiche
+ * [Start, Ende) bereits gepufferter Pakete hinter SeNo, der Bereich mit dem
+ * auslösenden Paket zuerst (wie TCP, RFC 2018).
+ *
+ * Flusskontrolle (im HELLO ausgehandelt, HELLO_FLAG_RWND): Rwnd = so viele
+ * Pakete ab dem kumulativ bestätigten (SeNo, bei ERR_BACKPRESSURE FlNr, beim
+ * HELLO die Start-Seq.) nimmt der Server noch an. FlNr ist bereits belegt,
+ * Rwnd steht daher als eigenes Feld hinter dem Header (wire.h).
  */
+#define ARQ_SACK_BLOCKS 4
+
 struct answer {
     unsigned char AnswType;
 #define AnswHello 'H'
 #define AnswOk    'O'
 #define AnswWarn  'W'
+#define AnswProbe 'P'
 #define AnswErr   0xFF
 
-    unsigned long FlNr;  /* derzeit ungenutzt, für spätere Erweiterungen */
+    unsigned long FlNr;  /* HELLO: Modus, SR: SeNr + 1 des auslösenden Pakets */
     unsigned long SeNo;  /* siehe Erklärung oben                          */
 
+    unsigned char SackCount;                     /* 0 = keine SACK-Blöcke */
+    unsigned long Sack[ARQ_SACK_BLOCKS][2];      /* [Start, Ende)         */
+
+    unsigned char RwndValid;                     /* Rwnd wird mitgesendet */
+    unsigned long Rwnd;                          /* Empfangsfenster in Paketen, siehe oben */
+
 #define ErrNo SeNo       /* Alias: bei Warn/Err ist SeNo der Fehlercode   */
 };
 
+/* Gebündelte Datagramm-I/O (sendmmsg/recvmmsg), Client und Server */
+#define ARQ_BATCH_MAX        64   /* max. Datagramme pro Systemaufruf              */
+#define ARQ_BATCH_DEFAULT    16   /* Default, per -b einstellbar                   */
+
+/* HELLO-Optionen (Payload des ReqHello, Mehrbyte-Felder Big Endian):
+ *   name[HELLO_OPT_MODE]      u8   gewünschter ARQ-Modus
+ *   name[HELLO_OPT_WINDOW]    u32  gewünschte Fenstergröße in Paketen
+ *   name[HELLO_OPT_ISN]       u32  Sequenznummer des ersten DATA-Pakets
+ *   name[HELLO_OPT_SIZE]      u64  Gesamtgröße der Datei in Bytes (0 = unbekannt)
+ *   name[HELLO_OPT_FLAGS]     u8   HELLO_FLAG_* (Client versteht SACK-Blöcke ...)
+ *   name[HELLO_OPT_LEN] ...        mit HELLO_FLAG_FASTOPEN: erste Nutzdaten (0-RTT),
+ *                                  SeNr = Start-Seq., Aufbau wie ReqData laut Flags
+ *   (ältere Clients senden nur den Modus bzw. FlNr = 0 -> GBN, GBN_MAX_WINDOW, 0, unbekannt)
+ *
+ * AnswHello: FlNr = vom Server gewählter Modus (Bits 0..7) | HELLO_ANSW_*
+ *                   | gewährte Nutzdaten je Paket << HELLO_ANSW_PAYLOAD_SHIFT
+ *                     (nur mit HELLO_FLAG_PAYLOAD, 0 = alter Server -> BufferSize)
+ *            SeNo = gewährte Fenstergröße (0 = alter Server -> GBN_MAX_WINDOW)
+ *
+ * 0-RTT (HELLO_FLAG_FASTOPEN): Nutzdaten im HELLO werden mit dem Hello-ACK
+ * bestätigt (HELLO_ANSW_DATA), das erste DATA-Paket hat dann Start-Seq. + 1.
+ * Statt des CLOSE trägt das letzte Paket REQ_FLAG_EOS, bei kleinen Dateien
+ * schon das HELLO. Beides nur, wenn der Server HELLO_ANSW_FASTOPEN meldet.
+ *
+ * Nutzdatengröße (HELLO_FLAG_PAYLOAD): ohne Aushandlung BufferSize. Der
+ * Server gewährt bis zu ARQ_PAYLOAD_MAX, der Client tastet sich per ReqProbe
+ * an die größte Paketgröße heran, die der Pfad unfragmentiert durchlässt
+ * (DPLPMTUD, RFC 8899), und nutzt sie erst nach einer bestätigten Probe.
+ *
+ * Im Modus ARQ_MODE_SR trägt AnswOk zusätzlich FlNr = SeNr + 1 des Pakets,
+ * das diese Antwort ausgelöst hat (selektives ACK, 0 = keins), und mit
+ * HELLO_FLAG_SACK bis zu ARQ_SACK_BLOCKS Bereiche gepufferter Pakete.
+ */
+#define ARQ_MODE_GBN         0    /* Go-Back-N: Empfänger verwirft Out-of-order   */
+#define ARQ_MODE_SR          1    /* Selective Repeat: Empfänger puffert          */
+
+#define HELLO_OPT_MODE       0    /* Byte-Offset des Modus in der HELLO-Payload   */
+#define HELLO_OPT_WINDOW     1    /* Byte-Offset der Fenstergröße                 */
+#define HELLO_OPT_ISN        5    /* Byte-Offset der Start-Sequenznummer          */
+#define HELLO_OPT_SIZE       9    /* Byte-Offset der Dateigröße                   */
+#define HELLO_OPT_FLAGS      17   /* Byte-Offset der HELLO-Flags                  */
+#define HELLO_OPT_LEN        18   /* Länge der HELLO-Optionen                     */
+
+#define HELLO_FLAG_SACK      0x01 /* Antworten dürfen SACK-Blöcke tragen          */
+#define HELLO_FLAG_RWND      0x02 /* Antworten dürfen ein Empfangsfenster tragen  */
+#define HELLO_FLAG_FASTOPEN  0x04 /* 0-RTT: Nutzdaten im HELLO, REQ_FLAG_EOS      */
+#define HELLO_FLAG_PAYLOAD   0x08 /* Client nimmt Nutzdaten > BufferSize an       */
+
+#define HELLO_ANSW_MODE      0xff  /* AnswHello.FlNr: Bits des Modus              */
+#define HELLO_ANSW_FASTOPEN  0x100 /* ... Server versteht 0-RTT und REQ_FLAG_EOS  */
+#define HELLO_ANSW_DATA      0x200 /* ... Nutzdaten aus dem HELLO angenommen      */
+#define HELLO_ANSW_PAYLOAD_SHIFT 16  /* ... Bits 16..31: gewährte Nutzdaten je Paket */
+#define HELLO_DATA_MAX       (BufferSize - HELLO_OPT_LEN) /* Nutzdaten im HELLO   */
+
 /* ARQ-Protokollparameter (Client-Seite, zentral dokumentiert) */
-#define GBN_MAX_WINDOW       10
-#define GBN_BUFFER_SIZE      (2 * GBN_MAX_WINDOW) // als Ringpuffer zu implementieren auf Client-Seite
+#define GBN_MAX_WINDOW       10   /* Default-Fenster, wenn der Peer keins aushandelt */
+#define GBN_BUFFER_SIZE      (2 * GBN_MAX_WINDOW) // Ringpuffer des Clients: >= 2 * Fenster, zur Laufzeit angelegt
+
+/* Obergrenze für das im HELLO ausgehandelte Fenster. Sequenznummern sind
+ * 32 Bit und werden als Seriennummern verglichen (wire.h, SEQ_DIFF), das
+ * Fenster muss daher weit unter 2^31 bleiben.
+ */
+#define ARQ_MAX_WINDOW       16384
+
+/* Socketpuffer werden passend zum Fenster vergrößert (SO_RCVBUF/SO_SNDBUF),
+ * sonst verwirft der Kernel bei großen Fenstern schon vor dem Empfänger.
+ * Der Kernel begrenzt zusätzlich auf net.core.rmem_max / wmem_max.
+ */
+#define ARQ_SOCKBUF_PER_PKT  2048               /* Kernel-Speicher je Datagramm (grob) */
+#define ARQ_SOCKBUF_MAX      (64 * 1024 * 1024)
+#define ARQ_SOCKBUF_FOR(payload) (ARQ_SOCKBUF_PER_PKT - BufferSize + (long)(payload)) /* ... bei größeren Paketen */
+
+/* Nutzdaten je Paket: BufferSize gilt immer, größere Pakete bis
+ * ARQ_PAYLOAD_MAX (BUFFER_SIZE aus config.h, passt ins u16-FlNr des
+ * Leitungsformats) nur nach Aushandlung im HELLO. Fenster mal Nutzdaten
+ * bleibt unter ARQ_WINDOW_BYTES_MAX (Ringpuffer des Clients, Reorder-Puffer
+ * des Servers), bei großen Fenstern gewährt der Server entsprechend weniger.
+ */
+#define ARQ_PAYLOAD_MAX      BUFFER_SIZE
+#define ARQ_WINDOW_BYTES_MAX (32L * 1024 * 1024)
+
+/* Server: Reorder-Puffer (SR) aller Sessions und Worker zusammen. Reicht der
+ * Rest nicht für das Fenster einer neuen Session, gewährt der Server ein
+ * entsprechend kleineres (halbiert, mindestens 1). */
+#define ARQ_SR_BYTES_TOTAL_MAX (256L * 1024 * 1024)
+
+/* Client: Pfad-MTU-Suche per ReqProbe. Erst die gewährte Obergrenze, dann
+ * binäre Suche, bis die Grenzen weniger als ARQ_PROBE_GRAIN Bytes auseinander
+ * liegen. Eine Größe gilt nach ARQ_PROBE_TRIES unbeantworteten Proben (nach
+ * RTO, 2 RTO, 4 RTO; MAX_PROBES in RFC 8899) oder EMSGSIZE beim Senden als zu
+ * groß. Nach ARQ_PROBE_RAISE_MS wird oberhalb der bestätigten Größe erneut
+ * gesucht (PMTU_RAISE_TIMER, dort 600 s - hier kürzer, da Transfers kurz sind
+ * und eine verworfene Größe sonst für den Rest des Transfers verloren wäre). */
+#define ARQ_PROBE_TRIES      3
+#define ARQ_PROBE_GRAIN      32
+#define ARQ_PROBE_RAISE_MS   10000
+
+/* Server: gleichzeitige Sessions (eine je Peer-Adresse) und Leerlaufzeit,
+ * nach der eine Session ohne Pakete verworfen wird */
+#define ARQ_MAX_SESSIONS     1024
+#define ARQ_SESSION_IDLE_MS  30000
+#define ARQ_MAX_WORKERS      64     /* Worker-Threads (je ein SO_REUSEPORT-Socket) */
+
+/* Server: verzögerte ACKs. Pakete in Reihenfolge werden kumulativ nach
+ * ARQ_ACK_EVERY Paketen (höchstens halbes Fenster) bzw. ARQ_ACK_DELAY_MS
+ * bestätigt, Lücken, Duplikate, HELLO und CLOSE sofort. 1 = jedes Paket. */
+#define ARQ_ACK_EVERY        2
+#define ARQ_ACK_DELAY_MS     1
+#define ARQ_ACK_DELAY_MAX_MS 200    /* muss unter der min. Leerlaufzeit bleiben    */
+#define ARQ_ACK_QUICK        16     /* erste DATA-Pakete einer Session sofort      */
+
+/* Server: Schreib-Thread je Worker, über eine SPSC-Queue mit Nutzdaten
+ * versorgt. Bestätigt wird, sobald ein Paket eingereiht ist; ist die Queue
+ * voll, antwortet der Server mit AnswWarn ERR_BACKPRESSURE. Das gewährte
+ * Fenster bleibt unter der Queue-Tiefe. */
+#define ARQ_WRITEQ_MAX       65536  /* Einträge je Worker (Default 0 = ohne Thread) */
+#define ARQ_WRITEQ_BYTES_MAX (256L * 1024 * 1024) /* ... mal max. Nutzdaten je Eintrag */
+
+/* Client: Pause nach ERR_BACKPRESSURE vor der Wiederholung ab base,
+ * verdoppelt sich bei anhaltendem Rückstau */
+#define ARQ_BP_PAUSE_MIN_US  1000
+#define ARQ_BP_PAUSE_MAX_US  200000
+
+/* Start-Sequenznummer des Clients: zufällig je Transfer, damit der Server einen
+ * neuen Transfer von derselben Adresse nicht für ein wiederholtes HELLO hält.
+ * Fest nur zum Test (z.B. -DARQ_INITIAL_SEQ=0xFFFFFF00 für den Überlauf). */
 #define GBN_TIMEOUT_INT_MS   100  /* Zeiteinheit eines Intervalls in Millisekunden */
 #define GBN_TIMEOUT_UNITS    3    /* Timeout in Einheiten à TIMEOUT_INT   */
+#define GBN_CLOSE_MAX_WAIT_MS 3000 /* Wartezeit ohne Antwort, bis der Client das Close aufgibt */
+#define ARQ_CLOSE_LINGER_MS  1000 /* Server (-n): nach dem letzten Transfer per EOS noch Wiederholungen bestätigen */
+
+/* Adaptiver Retransmission-Timeout (RFC 6298): RTO = SRTT + max(G, 4 * RTTVAR).
+ * Vor der ersten RTT-Messung gilt der feste Timeout GBN_TIMEOUT_UNITS * GBN_TIMEOUT_INT_MS.
+ */
+#define GBN_RTO_INIT_MS      (GBN_TIMEOUT_UNITS * GBN_TIMEOUT_INT_MS)
+#define GBN_RTO_MIN_MS       20     /* Untergrenze, schützt vor Retransmit-Stürmen   */
+#define GBN_RTO_MAX_MS       60000  /* Obergrenze, auch für exponentielles Backoff   */
+#define GBN_RTO_CLOCK_G_US   1000   /* Uhrengranularität G in Mikrosekunden          */
+#define ARQ_DUPACK_THRESH    3      /* doppelte ACKs bis zum Fast Retransmit (0 = aus) */
 
 #endif /* DATA_H_INCLUDED */
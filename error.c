@@ -5,8 +5,8 @@ char *errorTable[] =  {
     /* 1 */ "Wrong sequence number",
     /* 2 */ "File error (open/write)",
     /* 3 */ "Illegal request type",
-    /* 4 */ "Reserved",
-    /* 5 */ "Reserved",
+    /* 4 */ "Server write queue full (back-pressure)",
+    /* 5 */ "Server busy (no free session)",
     /* 6 */ "Reserved",
     /* 7 */ "Server internal error"
 };
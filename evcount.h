@@ -0,0 +1,58 @@
+/* evcount.h - Warten auf einen lock-freien SPSC-Ring ohne Abfrageschleife
+ *
+ * Eventcount über einen Futex: der Wartende meldet sich an (evPrepare),
+ * prüft seine Bedingung (Ring leer bzw. voll) erneut und schläft nur, wenn
+ * sie noch gilt (evWait, sonst evCancel). Die Gegenseite ruft nach dem
+ * Veröffentlichen (release-Store von head/tail) evSignal auf; ohne
+ * angemeldete Wartende kostet das nur einen Fence und einen Load.
+ *
+ * Die beiden Fences ordnen "Wartender angemeldet" und "Ring geändert"
+ * gegeneinander: entweder sieht der Wartende die Änderung bei der zweiten
+ * Prüfung, oder evSignal sieht den Wartenden und weckt ihn.
+ */
+
+#ifndef EVCOUNT_H_INCLUDED
+#define EVCOUNT_H_INCLUDED
+
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+struct evcount {
+    unsigned int seq;               /* Futex-Wort, evSignal zählt hoch */
+    int          waiters;           /* angemeldete Wartende            */
+};
+
+/* Wartenden anmelden; danach Bedingung prüfen, dann evWait bzw. evCancel */
+static inline unsigned int evPrepare(struct evcount *ev)
+{
+    __atomic_fetch_add(&ev->waiters, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return __atomic_load_n(&ev->seq, __ATOMIC_SEQ_CST);
+}
+
+static inline void evCancel(struct evcount *ev)
+{
+    __atomic_fetch_sub(&ev->waiters, 1, __ATOMIC_SEQ_CST);
+}
+
+/* Schlafen, bis evSignal nach evPrepare aufgerufen wurde (kehrt auch
+ * vorzeitig zurück, z.B. bei Signalen: Aufrufer prüft in einer Schleife) */
+static inline void evWait(struct evcount *ev, unsigned int key)
+{
+    syscall(SYS_futex, &ev->seq, FUTEX_WAIT_PRIVATE, key, NULL, NULL, 0);
+    evCancel(ev);
+}
+
+/* nach dem Veröffentlichen: angemeldete Wartende wecken */
+static inline void evSignal(struct evcount *ev)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ev->waiters, __ATOMIC_RELAXED) > 0) {
+        __atomic_fetch_add(&ev->seq, 1, __ATOMIC_SEQ_CST);
+        syscall(SYS_futex, &ev->seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+#endif /* EVCOUNT_H_INCLUDED */
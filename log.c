@@ -0,0 +1,263 @@
+/* log.c - Ereignis-Log: Ring je Thread, Flusher-Thread, Text-Dekoder (siehe log.h) */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "log.h"
+
+int logLevel = LOG_INFO;
+
+/* Ring eines Threads: genau ein Erzeuger (der Thread), Verbraucher sind
+ * Flusher und logSync, untereinander über drain serialisiert.
+ * head/tail laufen frei, Index = Zähler & (LOG_RING_SIZE - 1).
+ */
+struct log_ring {
+    struct log_record rec[LOG_RING_SIZE];
+    unsigned long     head;       /* nächster freier Platz (nur Erzeuger)   */
+    unsigned long     tail;       /* nächster zu lesender (nur Verbraucher) */
+    unsigned long     dropped;    /* wegen vollem Ring verworfen            */
+    pthread_mutex_t   drain;
+    int               id;
+};
+
+static struct log_ring *rings[LOG_MAX_RINGS];
+static int ringCount = 0;                      /* vergebene Ring-Nummern (atomar) */
+static __thread struct log_ring *myRing = NULL;
+static __thread int myRingFailed = 0;
+
+static FILE *binOut = NULL;                    /* NULL = Text nach stdout */
+static pthread_t flusher;
+static volatile int flusherRunning = 0;
+
+/* Textform je Ereignis, Argumente arg[0..3] */
+static const char *const logFormat[EV_COUNT] = {
+    [EV_RX_PACKET]        = "[Server] Received packet: Type=%c, SeNr=%u, FlNr=%u\n",
+    [EV_TX_ANSWER]        = "[Server] Sent answer: Type=%c, SeNo=%u (next expected)\n",
+    [EV_REQ_DROPPED]      = "[Server] Request packet DROPPED (simulated loss)\n",
+    [EV_ACK_DROPPED]      = "[Server] ACK DROPPED (simulated loss) for SeNo=%u\n",
+    [EV_HELLO]            = "[Server] HELLO received\n",
+    [EV_DATA]             = "[Server] DATA received: session %u, SeNr=%u, FlNr=%u, nextExpected=%u\n",
+    [EV_DATA_ACCEPT]      = "[Server] Accepting DATA with correct SeNr=%u\n",
+    [EV_DATA_BUFFERED]    = "[Server] OUT-OF-ORDER: received SeNr=%u, expected %u -> BUFFERED\n",
+    [EV_DATA_DROPPED]     = "[Server] OUT-OF-ORDER: received SeNr=%u, expected %u -> DROPPED\n",
+    [EV_DATA_DELIVER]     = "[Server] Delivering buffered DATA SeNr=%u\n",
+    [EV_DATA_NO_SESSION]  = "[Server] DATA empfangen ohne aktive Session\n",
+    [EV_CLOSE]            = "[Server] CLOSE received\n",
+    [EV_CLOSE_DROPPED]    = "[Server] OUT-OF-ORDER CLOSE: SeNr=%u, expected %u -> DROPPED\n",
+    [EV_CLOSE_NO_SESSION] = "[Server] CLOSE ohne aktive Session\n",
+    [EV_UNKNOWN_TYPE]     = "[Server] Unknown ReqType: %c\n",
+    [EV_DATA_BACKPRESSURE] = "[Server] Write queue full, SeNr=%u not accepted\n",
+};
+
+static const char *const levelNames[] = { "off", "error", "info", "debug" };
+
+int logParseLevel(const char *name)
+{
+    int k;
+
+    for (k = 0; k < (int)(sizeof(levelNames) / sizeof(levelNames[0])); k++) {
+        if (strcmp(name, levelNames[k]) == 0) {
+            return k;
+        }
+    }
+    return -1;
+}
+
+void logSetLevel(int level)
+{
+    if (level < LOG_OFF) level = LOG_OFF;
+    if (level > LOG_DEBUG) level = LOG_DEBUG;
+    logLevel = level;
+}
+
+void logSetBinary(FILE *f)
+{
+    binOut = f;
+}
+
+/* Ring für den aufrufenden Thread anlegen und registrieren */
+static struct log_ring *ringAttach(void)
+{
+    struct log_ring *r;
+    int id;
+
+    if (myRingFailed) {
+        return NULL;
+    }
+    id = __atomic_fetch_add(&ringCount, 1, __ATOMIC_RELAXED);
+    if (id >= LOG_MAX_RINGS || (r = calloc(1, sizeof(*r))) == NULL) {
+        fprintf(stderr, "[Log] no event ring for thread, events dropped\n");
+        myRingFailed = 1;
+        return NULL;
+    }
+    pthread_mutex_init(&r->drain, NULL);
+    r->id = id;
+    __atomic_store_n(&rings[id], r, __ATOMIC_RELEASE);
+    myRing = r;
+    return r;
+}
+
+void logEvent(int level, int ev, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3)
+{
+    struct log_ring *r = myRing ? myRing : ringAttach();
+    struct log_record *rec;
+    struct timespec ts;
+    unsigned long h;
+
+    if (!r) {
+        return;
+    }
+    h = r->head;
+    if (h - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) >= LOG_RING_SIZE) {
+        __atomic_fetch_add(&r->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    rec = &r->rec[h & (LOG_RING_SIZE - 1)];
+    rec->tsNs = (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+    rec->ev = (uint16_t)ev;
+    rec->level = (uint8_t)level;
+    rec->thread = (uint8_t)r->id;
+    rec->arg[0] = a0;
+    rec->arg[1] = a1;
+    rec->arg[2] = a2;
+    rec->arg[3] = a3;
+    rec->reserved = 0;
+    __atomic_store_n(&r->head, h + 1, __ATOMIC_RELEASE);
+}
+
+void logFormatRecord(FILE *out, const struct log_record *rec)
+{
+    if (rec->ev >= EV_COUNT || !logFormat[rec->ev]) {
+        fprintf(out, "[Log] unknown event %u\n", rec->ev);
+        return;
+    }
+    fprintf(out, logFormat[rec->ev], rec->arg[0], rec->arg[1], rec->arg[2], rec->arg[3]);
+}
+
+/* Alle anstehenden Datensätze eines Rings ausgeben */
+static void ringDrain(struct log_ring *r)
+{
+    unsigned long t, h;
+
+    pthread_mutex_lock(&r->drain);
+    t = r->tail;
+    h = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    for (; t != h; t++) {
+        const struct log_record *rec = &r->rec[t & (LOG_RING_SIZE - 1)];
+        if (binOut) {
+            fwrite(rec, sizeof(*rec), 1, binOut);
+        } else {
+            logFormatRecord(stdout, rec);
+        }
+    }
+    __atomic_store_n(&r->tail, t, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&r->drain);
+}
+
+static void drainAll(void)
+{
+    int n = __atomic_load_n(&ringCount, __ATOMIC_RELAXED);
+    int k;
+
+    if (n > LOG_MAX_RINGS) {
+        n = LOG_MAX_RINGS;
+    }
+    for (k = 0; k < n; k++) {
+        struct log_ring *r = __atomic_load_n(&rings[k], __ATOMIC_ACQUIRE);
+        if (r) {
+            ringDrain(r);
+        }
+    }
+}
+
+void logSync(void)
+{
+    if (myRing) {
+        ringDrain(myRing);
+    }
+}
+
+static void *flusherMain(void *arg)
+{
+    struct timespec pause = { 0, LOG_FLUSH_MS * 1000000L };
+
+    (void)arg;
+    while (flusherRunning) {
+        drainAll();
+        nanosleep(&pause, NULL);
+    }
+    return NULL;
+}
+
+int logStart(void)
+{
+    if (flusherRunning) {
+        return 0;
+    }
+    if (binOut) {
+        fwrite(LOG_MAGIC, 1, strlen(LOG_MAGIC), binOut);
+    }
+    flusherRunning = 1;
+    if (pthread_create(&flusher, NULL, flusherMain, NULL) != 0) {
+        fprintf(stderr, "[Log] cannot start flusher thread\n");
+        flusherRunning = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void logStop(void)
+{
+    unsigned long dropped = 0;
+    int n, k;
+
+    if (flusherRunning) {
+        flusherRunning = 0;
+        pthread_join(flusher, NULL);
+    }
+    drainAll();
+
+    n = __atomic_load_n(&ringCount, __ATOMIC_RELAXED);
+    for (k = 0; k < n && k < LOG_MAX_RINGS; k++) {
+        if (rings[k]) {
+            dropped += rings[k]->dropped;
+        }
+    }
+    if (dropped > 0) {
+        fprintf(stderr, "[Log] %lu events dropped (ring full)\n", dropped);
+    }
+    if (binOut) {
+        fflush(binOut);
+    }
+    fflush(stdout);
+}
+
+long logDecode(FILE *in, FILE *out, int stamps)
+{
+    char magic[sizeof(LOG_MAGIC) - 1];
+    struct log_record rec;
+    uint64_t t0 = 0;
+    long count = 0;
+
+    if (fread(magic, 1, sizeof(magic), in) != sizeof(magic) ||
+        memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0) {
+        return -1;
+    }
+    while (fread(&rec, sizeof(rec), 1, in) == 1) {
+        if (count == 0) {
+            t0 = rec.tsNs;
+        }
+        if (stamps) {
+            fprintf(out, "%12.6f t%-2u ", (double)(int64_t)(rec.tsNs - t0) / 1e9, rec.thread);
+        }
+        logFormatRecord(out, &rec);
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,107 @@
+/* log.h - Ereignis-Log mit binären Datensätzen in einem Ring je Thread
+ *
+ * Häufige Ereignisse (je Paket) werden nicht per printf formatiert, sondern
+ * als Datensatz fester Größe (struct log_record) in einen lock-freien Ring
+ * des erzeugenden Threads gelegt. Ein Flusher-Thread leert die Ringe
+ * periodisch und schreibt die Datensätze entweder binär (logSetBinary,
+ * später mit logdump lesbar) oder gleich als Text (logDecode-Format).
+ *
+ * Ist der Level eines Ereignisses abgeschaltet, kostet LOG_EV nur einen
+ * Vergleich. Ist ein Ring voll, wird das Ereignis verworfen und gezählt,
+ * der Erzeuger blockiert nie.
+ */
+
+#ifndef LOG_H_INCLUDED
+#define LOG_H_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define LOG_OFF    0
+#define LOG_ERROR  1
+#define LOG_INFO   2   /* Sessions, Zusammenfassungen (Default) */
+#define LOG_DEBUG  3   /* jedes Paket                           */
+
+#define LOG_RING_SIZE    16384   /* Datensätze je Thread (2er-Potenz)  */
+#define LOG_MAX_RINGS    72      /* Threads mit Ring (Worker + Hauptthread) */
+#define LOG_FLUSH_MS     20      /* Intervall des Flusher-Threads       */
+#define LOG_MAGIC        "ARQLOG1\n"
+
+/* Ereignisse; Reihenfolge = Index in logFormat (log.c) und im Binärformat */
+enum log_event {
+    EV_RX_PACKET = 0,     /* Type, SeNr, FlNr                  */
+    EV_TX_ANSWER,         /* Type, SeNo                        */
+    EV_REQ_DROPPED,       /* simulierter Request-Verlust       */
+    EV_ACK_DROPPED,       /* SeNo                              */
+    EV_HELLO,
+    EV_DATA,              /* Session, SeNr, FlNr, nextExpected */
+    EV_DATA_ACCEPT,       /* SeNr                              */
+    EV_DATA_BUFFERED,     /* SeNr, nextExpected                */
+    EV_DATA_DROPPED,      /* SeNr, nextExpected                */
+    EV_DATA_DELIVER,      /* SeNr (aus dem Reorder-Puffer)     */
+    EV_DATA_NO_SESSION,
+    EV_CLOSE,
+    EV_CLOSE_DROPPED,     /* SeNr, nextExpected                */
+    EV_CLOSE_NO_SESSION,
+    EV_UNKNOWN_TYPE,      /* Type                              */
+    EV_DATA_BACKPRESSURE, /* SeNr (Schreib-Queue voll)         */
+    EV_COUNT
+};
+
+/* Binärer Datensatz (32 Byte, Host-Byteorder) */
+struct log_record {
+    uint64_t tsNs;        /* CLOCK_MONOTONIC                   */
+    uint16_t ev;          /* enum log_event                    */
+    uint8_t  level;
+    uint8_t  thread;      /* Ring-/Thread-Nummer               */
+    uint32_t arg[4];
+    uint32_t reserved;
+};
+
+extern int logLevel;
+
+#define LOG_ENABLED(lvl)  __builtin_expect((lvl) <= logLevel, 0)
+
+#define LOG_EV(lvl, ev, a0, a1, a2, a3)                                          \
+    do {                                                                         \
+        if (LOG_ENABLED(lvl)) {                                                  \
+            logEvent((lvl), (ev), (uint32_t)(a0), (uint32_t)(a1),                \
+                     (uint32_t)(a2), (uint32_t)(a3));                            \
+        }                                                                        \
+    } while (0)
+
+/* Seltene Meldungen (Sessions, Zusammenfassungen) weiter direkt per printf,
+ * vorher den eigenen Ring leeren, damit die Reihenfolge stimmt */
+#define LOG_PRINTF(lvl, ...)                                                     \
+    do {                                                                         \
+        if ((lvl) <= logLevel) {                                                 \
+            logSync();                                                           \
+            printf(__VA_ARGS__);                                                 \
+        }                                                                        \
+    } while (0)
+
+/* Name -> LOG_*, -1 wenn unbekannt ("off", "error", "info", "debug") */
+int logParseLevel(const char *name);
+void logSetLevel(int level);
+
+/* Datensätze binär nach f schreiben statt als Text nach stdout */
+void logSetBinary(FILE *f);
+
+/* Flusher-Thread starten / anhalten (leert danach alle Ringe) */
+int logStart(void);
+void logStop(void);
+
+/* Ring des aufrufenden Threads sofort leeren, z.B. vor einem direkten
+ * printf, damit die Reihenfolge der Ausgaben erhalten bleibt */
+void logSync(void);
+
+void logEvent(int level, int ev, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+/* Einen Datensatz als Textzeile ausgeben (Format wie die frühere printf-Ausgabe) */
+void logFormatRecord(FILE *out, const struct log_record *rec);
+
+/* Binär-Log (logSetBinary) lesen und als Text ausgeben; mit Zeitstempel,
+ * wenn stamps != 0. Rückgabe: Anzahl Datensätze, <0 bei Formatfehler */
+long logDecode(FILE *in, FILE *out, int stamps);
+
+#endif /* LOG_H_INCLUDED */
@@ -0,0 +1,38 @@
+/* logdump.c - Binär-Log des Servers (server -d <datei>) als Text ausgeben */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+
+int main(int argc, char *argv[])
+{
+    FILE *in;
+    long n;
+    int stamps = 0;
+    int arg = 1;
+
+    if (argc > 1 && strcmp(argv[1], "-t") == 0) {
+        stamps = 1;  /* Zeit seit dem ersten Datensatz und Thread-Nummer voranstellen */
+        arg++;
+    }
+    if (arg != argc - 1) {
+        fprintf(stderr, "Usage: %s [-t] <logfile>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    in = fopen(argv[arg], "rb");
+    if (!in) {
+        perror(argv[arg]);
+        return EXIT_FAILURE;
+    }
+    n = logDecode(in, stdout, stamps);
+    fclose(in);
+    if (n < 0) {
+        fprintf(stderr, "%s: not a server event log\n", argv[arg]);
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "%ld records\n", n);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,474 @@
+/* proxy.c - lokaler UDP-Proxy mit Kanalmodell (chan.h) zwischen Client und Server
+ *
+ *   ./client -a ::1 -p 4444 ...  ->  ./proxy -l 4444 -p 3333 ...  ->  ./server -p 3333 ...
+ *
+ * Jeder Client (Absenderadresse) bekommt einen eigenen Upstream-Socket zum
+ * Server, damit der Server die Sessions weiterhin auseinanderhält. Pakete
+ * beider Richtungen laufen durch ein eigenes Kanalmodell (Verlust, Verzögerung,
+ * Jitter, Umordnung, Duplikate, Engpassrate) und warten bis zur Zustellung in
+ * einem Min-Heap nach Zustellzeit.
+ */
+
+#define _GNU_SOURCE /* ppoll */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+
+#include "config.h"
+#include "chan.h"
+
+#define PROXY_MAX_FLOWS   64
+#define PROXY_IDLE_MS     30000     /* Flow ohne Pakete nach so vielen ms freigeben */
+#define PROXY_PKT_MAX     65536
+
+/* ein Client und sein Upstream-Socket */
+struct flow {
+    int                     used;
+    int                     up;          /* verbunden mit dem Server */
+    struct sockaddr_storage addr;        /* Client */
+    socklen_t               addrlen;
+    long long               lastUs;
+};
+
+/* wartendes Paket */
+struct pkt {
+    long long      releaseUs;
+    unsigned long  seq;                  /* gleiche Zustellzeit: Reihenfolge der Ankunft */
+    int            flow;
+    int            dir;                  /* CHAN_DIR_REQ: zum Server, CHAN_DIR_ACK: zum Client */
+    size_t         len;
+    char          *data;
+};
+
+static struct flow flows[PROXY_MAX_FLOWS];
+static struct pkt *heap = NULL;
+static int heapLen = 0, heapCap = 0;
+static unsigned long pktSeq = 0;
+static unsigned long sent[2];
+static struct chan chans[2];
+static int listen_sock = -1;
+static struct sockaddr_storage server_addr;
+static socklen_t server_addrlen = 0;
+static volatile sig_atomic_t stop_requested = 0;
+
+static long long nowUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void onStopSignal(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+static void usage(const char *progName)
+{
+    fprintf(stderr, "Usage: %s -l <listenPort> [-a <server>] [-p <serverPort>] [-u <chan>] [-d <chan>]\n",
+            progName);
+    fprintf(stderr, "   -l <port>    : Port, auf dem die Clients senden\n");
+    fprintf(stderr, "   -a <server>  : Serveradresse (Default: %s)\n", DEFAULT_LOOPBACK_HOST);
+    fprintf(stderr, "   -p <port>    : Server-Port (Default: %s)\n", DEFAULT_PORT);
+    fprintf(stderr, "   -u <chan>    : Kanalmodell Client -> Server (Requests)\n");
+    fprintf(stderr, "   -d <chan>    : Kanalmodell Server -> Client (Antworten)\n");
+    fprintf(stderr, "                  z.B. \"loss=0.01,delay=20,jitter=5,reorder=0.02,dup=0.01,rate=10m,seed=3\"\n");
+    exit(EXIT_FAILURE);
+}
+
+/* --------------------------------------------------------------- */
+/*  Warteschlange: Min-Heap nach (releaseUs, seq)                  */
+/* --------------------------------------------------------------- */
+
+static int pktBefore(const struct pkt *a, const struct pkt *b)
+{
+    return a->releaseUs < b->releaseUs ||
+           (a->releaseUs == b->releaseUs && a->seq < b->seq);
+}
+
+static int heapPush(const struct pkt *p)
+{
+    int i;
+
+    if (heapLen == heapCap) {
+        int n = heapCap ? heapCap * 2 : 256;
+        struct pkt *h = realloc(heap, (size_t)n * sizeof(*h));
+        if (!h) {
+            return -1;
+        }
+        heap = h;
+        heapCap = n;
+    }
+    i = heapLen++;
+    while (i > 0 && pktBefore(p, &heap[(i - 1) / 2])) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = *p;
+    return 0;
+}
+
+static void heapPop(struct pkt *out)
+{
+    struct pkt last;
+    int i = 0;
+
+    *out = heap[0];
+    last = heap[--heapLen];
+    for (;;) {
+        int c = 2 * i + 1;
+        if (c >= heapLen) {
+            break;
+        }
+        if (c + 1 < heapLen && pktBefore(&heap[c + 1], &heap[c])) {
+            c++;
+        }
+        if (!pktBefore(&heap[c], &last)) {
+            break;
+        }
+        heap[i] = heap[c];
+        i = c;
+    }
+    if (heapLen > 0) {
+        heap[i] = last;
+    }
+}
+
+/* --------------------------------------------------------------- */
+/*  Sockets und Flows                                              */
+/* --------------------------------------------------------------- */
+
+static int initSockets(const char *listenPort, const char *server, const char *port)
+{
+    struct addrinfo hints;
+    struct addrinfo *res = NULL;
+    int ret;
+
+    /* Zieladresse des Servers */
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = PF_INET6;
+    hints.ai_socktype = SOCK_DGRAM;
+    ret = getaddrinfo(server, port, &hints, &res);
+    if (ret != 0) {
+        fprintf(stderr, "getaddrinfo(%s,%s): %s\n", server, port, gai_strerror(ret));
+        return -1;
+    }
+    memcpy(&server_addr, res->ai_addr, res->ai_addrlen);
+    server_addrlen = res->ai_addrlen;
+    freeaddrinfo(res);
+
+    /* Socket für die Clients */
+    hints.ai_flags = AI_PASSIVE;
+    ret = getaddrinfo(NULL, listenPort, &hints, &res);
+    if (ret != 0) {
+        fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(ret));
+        return -1;
+    }
+    listen_sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (listen_sock < 0) {
+        perror("socket");
+        freeaddrinfo(res);
+        return -1;
+    }
+    if (bind(listen_sock, res->ai_addr, res->ai_addrlen) < 0) {
+        perror("bind");
+        close(listen_sock);
+        freeaddrinfo(res);
+        return -1;
+    }
+    freeaddrinfo(res);
+    return 0;
+}
+
+/* Flow zur Client-Adresse suchen bzw. anlegen, -1 = Tabelle voll */
+static int flowFor(const struct sockaddr_storage *addr, socklen_t addrlen, long long now)
+{
+    int k, freeSlot = -1;
+
+    for (k = 0; k < PROXY_MAX_FLOWS; k++) {
+        if (flows[k].used) {
+            if (flows[k].addrlen == addrlen && memcmp(&flows[k].addr, addr, addrlen) == 0) {
+                flows[k].lastUs = now;
+                return k;
+            }
+        } else if (freeSlot < 0) {
+            freeSlot = k;
+        }
+    }
+    if (freeSlot < 0) {
+        return -1;
+    }
+
+    flows[freeSlot].up = socket(server_addr.ss_family, SOCK_DGRAM, 0);
+    if (flows[freeSlot].up < 0) {
+        perror("socket");
+        return -1;
+    }
+    if (connect(flows[freeSlot].up, (struct sockaddr *)&server_addr, server_addrlen) < 0) {
+        perror("connect");
+        close(flows[freeSlot].up);
+        return -1;
+    }
+    flows[freeSlot].used = 1;
+    memcpy(&flows[freeSlot].addr, addr, addrlen);
+    flows[freeSlot].addrlen = addrlen;
+    flows[freeSlot].lastUs = now;
+    return freeSlot;
+}
+
+/* Flows ohne Verkehr und ohne wartende Pakete freigeben */
+static void flowExpire(long long now)
+{
+    int k, i;
+
+    for (k = 0; k < PROXY_MAX_FLOWS; k++) {
+        if (!flows[k].used || now - flows[k].lastUs < (long long)PROXY_IDLE_MS * 1000) {
+            continue;
+        }
+        for (i = 0; i < heapLen && heap[i].flow != k; i++) {
+        }
+        if (i == heapLen) {
+            close(flows[k].up);
+            flows[k].used = 0;
+        }
+    }
+}
+
+/* Datagramm durch das Kanalmodell der Richtung in die Warteschlange */
+static void enqueue(int flow, int dir, const char *buf, size_t len, long long now)
+{
+    long long rel[2];
+    int n, k;
+
+    n = chanSchedule(&chans[dir], now, len, rel);
+    for (k = 0; k < n; k++) {
+        struct pkt p;
+        p.releaseUs = rel[k];
+        p.seq = pktSeq++;
+        p.flow = flow;
+        p.dir = dir;
+        p.len = len;
+        p.data = malloc(len ? len : 1);
+        if (!p.data || heapPush(&p) < 0) {
+            free(p.data);
+            fprintf(stderr, "proxy: out of memory, packet dropped\n");
+            return;
+        }
+        memcpy(p.data, buf, len);
+    }
+}
+
+/* fällige Pakete zustellen */
+static void deliver(long long now)
+{
+    struct pkt p;
+    ssize_t rc;
+
+    while (heapLen > 0 && heap[0].releaseUs <= now) {
+        heapPop(&p);
+        if (flows[p.flow].used) {
+            if (p.dir == CHAN_DIR_REQ) {
+                rc = send(flows[p.flow].up, p.data, p.len, 0);
+            } else {
+                rc = sendto(listen_sock, p.data, p.len, 0,
+                            (struct sockaddr *)&flows[p.flow].addr, flows[p.flow].addrlen);
+            }
+            if (rc < 0) {
+                if (errno != ECONNREFUSED) {
+                    perror("proxy: send");
+                }
+            } else {
+                sent[p.dir]++;
+            }
+        }
+        free(p.data);
+    }
+}
+
+static void report(const char *name, int dir)
+{
+    const struct chan *c = &chans[dir];
+
+    printf("Proxy: %s: %lu packets, %lu dropped, %lu duplicated, %lu reordered, %lu delivered\n",
+           name, c->packets, c->dropped, c->duplicated, c->reordered, sent[dir]);
+}
+
+/* --- main: Argumente auswerten, Pakete weiterleiten --- */
+
+int main(int argc, char *argv[])
+{
+    const char *listenPort = NULL;
+    const char *server = DEFAULT_LOOPBACK_HOST;
+    const char *port = DEFAULT_PORT;
+    struct chan_cfg cfg[2];
+    struct pollfd pfd[1 + PROXY_MAX_FLOWS];
+    int pflow[1 + PROXY_MAX_FLOWS];
+    static char buf[PROXY_PKT_MAX];
+    struct sigaction sa;
+    char desc[256];
+    long long lastExpire;
+    long i;
+
+    chanDefaults(&cfg[CHAN_DIR_REQ]);
+    chanDefaults(&cfg[CHAN_DIR_ACK]);
+
+    /* Programmargumente auswerten */
+    for (i = 1; i < argc; i++) {
+        if (((argv[i][0] != '-') && (argv[i][0] != '/')) ||
+            (argv[i][1] == 0) || (argv[i][2] != 0) || !argv[i + 1]) {
+            usage(argv[0]);
+        }
+        switch (tolower((unsigned char)argv[i][1])) {
+        case 'l': /* eigener Port */
+            listenPort = argv[++i];
+            break;
+        case 'a': /* Serveradresse */
+            server = argv[++i];
+            break;
+        case 'p': /* Server-Port */
+            port = argv[++i];
+            break;
+        case 'u': /* Client -> Server */
+            if (chanParse(&cfg[CHAN_DIR_REQ], argv[++i], CHAN_DIR_REQ) < 0) {
+                usage(argv[0]);
+            }
+            break;
+        case 'd': /* Server -> Client */
+            if (chanParse(&cfg[CHAN_DIR_ACK], argv[++i], CHAN_DIR_ACK) < 0) {
+                usage(argv[0]);
+            }
+            break;
+        default:
+            usage(argv[0]);
+            break;
+        }
+    }
+    if (!listenPort) {
+        usage(argv[0]);
+    }
+
+    if (initSockets(listenPort, server, port) < 0) {
+        return EXIT_FAILURE;
+    }
+    chanInit(&chans[CHAN_DIR_REQ], &cfg[CHAN_DIR_REQ], CHAN_DIR_REQ);
+    chanInit(&chans[CHAN_DIR_ACK], &cfg[CHAN_DIR_ACK], CHAN_DIR_ACK);
+
+    printf("Proxy: port %s -> [%s]:%s\n", listenPort, server, port);
+    chanDescribe(&cfg[CHAN_DIR_REQ], desc, sizeof(desc));
+    printf("Proxy: up:   %s\n", desc);
+    chanDescribe(&cfg[CHAN_DIR_ACK], desc, sizeof(desc));
+    printf("Proxy: down: %s\n", desc);
+    fflush(stdout);
+
+    /* ohne SA_RESTART, damit ppoll bei SIGINT/SIGTERM zurückkehrt */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onStopSignal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    lastExpire = nowUs();
+    while (!stop_requested) {
+        struct timespec ts, *tsp = NULL;
+        long long now;
+        int n = 0, k, rc;
+
+        pfd[n].fd = listen_sock;
+        pfd[n].events = POLLIN;
+        pflow[n++] = -1;
+        for (k = 0; k < PROXY_MAX_FLOWS; k++) {
+            if (flows[k].used) {
+                pfd[n].fd = flows[k].up;
+                pfd[n].events = POLLIN;
+                pflow[n++] = k;
+            }
+        }
+
+        /* höchstens bis zum nächsten fälligen Paket warten */
+        now = nowUs();
+        if (heapLen > 0) {
+            long long wait = heap[0].releaseUs - now;
+            if (wait < 0) wait = 0;
+            ts.tv_sec = wait / 1000000;
+            ts.tv_nsec = (wait % 1000000) * 1000;
+            tsp = &ts;
+        }
+        rc = ppoll(pfd, (nfds_t)n, tsp, NULL);
+        if (rc < 0 && errno != EINTR) {
+            perror("ppoll");
+            break;
+        }
+
+        now = nowUs();
+        for (k = 0; rc > 0 && k < n; k++) {
+            ssize_t len;
+
+            if (!(pfd[k].revents & POLLIN)) {
+                continue;
+            }
+            if (pflow[k] < 0) {
+                /* vom Client: Flow zuordnen, Richtung Server */
+                struct sockaddr_storage from;
+                socklen_t fromlen = sizeof(from);
+                int f;
+
+                len = recvfrom(listen_sock, buf, sizeof(buf), 0, (struct sockaddr *)&from, &fromlen);
+                if (len < 0) {
+                    continue;
+                }
+                f = flowFor(&from, fromlen, now);
+                if (f < 0) {
+                    fprintf(stderr, "proxy: no free flow, packet dropped\n");
+                    continue;
+                }
+                enqueue(f, CHAN_DIR_REQ, buf, (size_t)len, now);
+            } else {
+                /* vom Server: zurück an den Client des Flows */
+                len = recv(pfd[k].fd, buf, sizeof(buf), 0);
+                if (len < 0) {
+                    continue;
+                }
+                flows[pflow[k]].lastUs = now;
+                enqueue(pflow[k], CHAN_DIR_ACK, buf, (size_t)len, now);
+            }
+        }
+
+        deliver(nowUs());
+
+        if (now - lastExpire >= 1000000) {
+            flowExpire(now);
+            lastExpire = now;
+        }
+    }
+
+    report("up", CHAN_DIR_REQ);
+    report("down", CHAN_DIR_ACK);
+
+    while (heapLen > 0) {
+        struct pkt p;
+        heapPop(&p);
+        free(p.data);
+    }
+    free(heap);
+    for (i = 0; i < PROXY_MAX_FLOWS; i++) {
+        if (flows[i].used) {
+            close(flows[i].up);
+        }
+    }
+    close(listen_sock);
+    chanRelease(&chans[CHAN_DIR_REQ]);
+    chanRelease(&chans[CHAN_DIR_ACK]);
+    chanFree(&cfg[CHAN_DIR_REQ]);
+    chanFree(&cfg[CHAN_DIR_ACK]);
+    return EXIT_SUCCESS;
+}
@@ -1,93 +1,278 @@
+#define _GNU_SOURCE /* fallocate, madvise */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/statvfs.h>
 
 #include "data.h"
 #include "config.h"
 #include "serverSy.h"
+#include "log.h"
+#include "chan.h"
 
-/* Anwendungszustand: Ausgabedatei */
+/* Anwendungszustand: Ausgabedatei (Vorlage für den Namen, siehe outputName) */
 static const char *gOutputFile = NULL;
-static FILE       *gFp         = NULL;
-static int         gFileOk     = 0;
+
+/* Ausgabe ohne angekündigte Größe: Daten in einem ausgerichteten Block
+ * sammeln und blockweise per pwrite schreiben */
+#define OUT_BLOCK_SIZE   (1024 * 1024)
+#define OUT_BLOCK_ALIGN  4096
+
+/* höchstens so viel der angekündigten Größe vorab anlegen und mappen,
+ * der Rest läuft über den Blockpuffer */
+#define OUT_PREALLOC_MAX (1ULL << 30)
+
+/* Zustand je Transfer, als Session-Kontext an der ARQ-Schicht abgelegt.
+ * Mit angekündigter Größe (HELLO) wird die Datei vorab angelegt (fallocate)
+ * und über mmap beschrieben; was darüber hinausgeht bzw. ohne Größe, läuft
+ * über den Blockpuffer.
+ */
+struct transfer {
+    int                fd;
+    char              *map;      /* gemappte Datei, NULL = nur Blockpuffer */
+    size_t             mapLen;   /* = vorab angelegte Dateigröße           */
+    unsigned long long off;      /* bisher übergebene Bytes (= Dateiende)  */
+    char              *blk;      /* Blockpuffer, beginnt bei off - blkLen  */
+    size_t             blkLen;
+    char               name[FILENAME_MAX];
+};
 
 static void usage(const char *progName)
 {
-    fprintf(stderr, "Usage: %s -p <port> -f <outfile> [-r <lossReq>] [-a <lossAck>]\n",
+    fprintf(stderr, "Usage: %s -p <port> -f <outfile> [-r <lossReq|chan>] [-a <lossAck|chan>] [-b <batch>] [-w <maxWindow>]\n"
+                    "       [-n <transfers>] [-s <sessions>] [-i <idleMs>] [-t <workers>] [-c]\n"
+                    "       [-k <n>[:ms]] [-l <level>] [-d <logfile>] [-u <ctlsocket>] [-q <depth>] [-x <bytes>]\n",
             progName);
     fprintf(stderr, "   -p <port>    : Server-Port (Default: %s)\n", DEFAULT_PORT);
     fprintf(stderr, "   -f <outfile> : Ausgabedatei\n");
-    fprintf(stderr, "   -r <lossReq> : Request-Verlustwahrscheinlichkeit (0.0..1.0)\n");
-    fprintf(stderr, "   -a <lossAck> : ACK-Verlustwahrscheinlichkeit (0.0..1.0)\n");
+    fprintf(stderr, "   -r <lossReq> : Request-Verlustwahrscheinlichkeit (0.0..1.0) oder Kanalmodell,\n"
+                    "                  z.B. \"ge=0.01:0.3,seed=7\" / \"replay=logs/T3_pktloss.log\" (siehe chan.h)\n");
+    fprintf(stderr, "   -a <lossAck> : ACK-Verlustwahrscheinlichkeit bzw. Kanalmodell für ACKs\n");
+    fprintf(stderr, "   -b <batch>   : Datagramme pro recvmmsg/sendmmsg (1..%d, Default: %d)\n",
+            ARQ_BATCH_MAX, ARQ_BATCH_DEFAULT);
+    fprintf(stderr, "   -w <window>  : max. gewährtes Fenster in Paketen (1..%d, Default: %d)\n",
+            ARQ_MAX_WINDOW, ARQ_MAX_WINDOW);
+    fprintf(stderr, "   -n <count>   : nach count abgeschlossenen Transfers beenden (Default: 0 = nie)\n");
+    fprintf(stderr, "   -s <count>   : max. gleichzeitige Sessions (Default: %d)\n", ARQ_MAX_SESSIONS);
+    fprintf(stderr, "   -i <ms>      : Leerlaufzeit bis zum Verwerfen einer Session (Default: %d)\n",
+            ARQ_SESSION_IDLE_MS);
+    fprintf(stderr, "   -t <count>   : Worker-Threads mit je eigenem Socket (1..%d, Default: 1)\n",
+            ARQ_MAX_WORKERS);
+    fprintf(stderr, "   -c           : Worker-Threads auf CPUs pinnen\n");
+    fprintf(stderr, "   -k <n>[:ms]  : ACK erst nach n Paketen in Reihenfolge bzw. ms (Default: %d:%d, 1 = jedes)\n",
+            ARQ_ACK_EVERY, ARQ_ACK_DELAY_MS);
+    fprintf(stderr, "   -l <level>   : Log-Level off|error|info|debug (Default: info, debug = jedes Paket)\n");
+    fprintf(stderr, "   -d <file>    : Ereignisse binär in file schreiben (Text mit logdump)\n");
+    fprintf(stderr, "   -u <path>    : Metriken (Prometheus-Text) über Unix-Socket path, SIGUSR1 -> stderr\n");
+    fprintf(stderr, "                  (ein vorhandener Socket wird ersetzt, eine andere Datei nicht)\n");
+    fprintf(stderr, "   -q <depth>   : Schreib-Thread je Worker, Queue mit depth Paketen (..%d, Default: 0 = aus)\n",
+            ARQ_WRITEQ_MAX);
+    fprintf(stderr, "   -x <bytes>   : max. gewährte Nutzdaten je Paket (%d..%d, Default: %d)\n",
+            BufferSize, ARQ_PAYLOAD_MAX, ARQ_PAYLOAD_MAX);
+    fprintf(stderr, "   <outfile> mit %%u: Transfer-Nummer im Namen, sonst <outfile>, <outfile>.1, ...\n");
     exit(EXIT_FAILURE);
 }
 
 /* Anwendungscallbacks für die ARQ-Schicht */
 
-/* Ausgabedatei öffnen/neu anlegen. */
+/*
+ * Ausgabedatei für Transfer id: enthält -f ein "%u", wird dort die Nummer
+ * eingesetzt; sonst schreibt der erste Transfer nach <outfile>, jeder
+ * weitere nach <outfile>.<id>.
+ */
+static void outputName(char *buf, size_t size, unsigned int id)
+{
+    const char *pct = strstr(gOutputFile, "%u");
+
+    if (pct) {
+        /* -f ist kein Formatstring: nur das erste "%u" ersetzen, Rest unverändert */
+        snprintf(buf, size, "%.*s%u%s", (int)(pct - gOutputFile), gOutputFile, id, pct + 2);
+    } else if (id == 0) {
+        snprintf(buf, size, "%s", gOutputFile);
+    } else {
+        snprintf(buf, size, "%s.%u", gOutputFile, id);
+    }
+}
+
+/* Blockpuffer an seine Dateiposition schreiben. Rückgabe: 0 oder <0 bei Fehler */
+static int flushBlock(struct transfer *t)
+{
+    off_t pos = (off_t)(t->off - t->blkLen);
+    size_t done = 0;
+    ssize_t n;
+
+    while (done < t->blkLen) {
+        n = pwrite(t->fd, t->blk + done, t->blkLen - done, pos + (off_t)done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("pwrite");
+            return -1;
+        }
+        done += (size_t)n;
+    }
+    t->blkLen = 0;
+    return 0;
+}
+
+/*
+ * Datei vorab anlegen und mappen: die vom Client angekündigte Größe, höchstens
+ * OUT_PREALLOC_MAX. Mehr als frei ist, wird abgelehnt. Rückgabe: 0 = gemappt,
+ * 1 = nicht möglich (Blockpuffer verwenden), <0 = kein Platz.
+ */
+static int mapOutput(struct transfer *t, unsigned long long size)
+{
+    struct statvfs fs;
+    void *p;
+
+    if (size == 0) {
+        return 1;
+    }
+    if (fstatvfs(t->fd, &fs) == 0 && size > (unsigned long long)fs.f_bavail * fs.f_frsize) {
+        fprintf(stderr, "Server: cannot allocate %llu bytes for '%s': %s\n",
+                size, t->name, strerror(ENOSPC));
+        return -1;
+    }
+    if (size > OUT_PREALLOC_MAX) {
+        size = OUT_PREALLOC_MAX;
+    }
+    if (size > (unsigned long long)SIZE_MAX) {
+        return 1;
+    }
+    /* fallocate statt posix_fallocate: glibc emuliert letzteres ohne
+     * Unterstützung des Dateisystems durch Schreiben jedes Blocks */
+    if (fallocate(t->fd, 0, 0, (off_t)size) < 0) {
+        if (errno == ENOSPC || errno == EFBIG) {
+            fprintf(stderr, "Server: cannot allocate %llu bytes for '%s': %s\n",
+                    size, t->name, strerror(errno));
+            return -1;
+        }
+        return 1;  /* z.B. EOPNOTSUPP: ohne Vorab-Anlage weiter */
+    }
+    p = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, t->fd, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap");
+        if (ftruncate(t->fd, 0) < 0) {  /* Vorab-Anlage zurücknehmen */
+            perror("ftruncate");
+        }
+        return 1;
+    }
+    madvise(p, (size_t)size, MADV_SEQUENTIAL);
+    t->map = p;
+    t->mapLen = (size_t)size;
+    return 0;
+}
+
+/* Ausgabedatei des neuen Transfers öffnen/neu anlegen. */
 static int appStartTransfer(void)
 {
-    gFileOk = 0;
+    struct transfer *t;
+    int rc;
 
     if (!gOutputFile) {
         fprintf(stderr, "Server: no output file specified.\n");
         return -1;
     }
 
-    /* TODO:
-     *   - Datei gOutputFile zum Schreiben öffnen 
-     *   - Zeiger in gFp ablegen
-     *   - bei Erfolg gFileOk = 1 setzen
-     *   - bei Fehler Fehlermeldung ausgeben und <0 zurückgeben
-     */
-    gFp = fopen(gOutputFile, "w");
-    if (!gFp) {
-        fprintf(stderr, "Server: failed to open output file '%s'.\n", gOutputFile);
+    t = calloc(1, sizeof(*t));
+    if (!t) {
+        fprintf(stderr, "Server: out of memory.\n");
         return -1;
     }
+    outputName(t->name, sizeof(t->name), arqGetSessionId());
 
-    gFileOk = 1;
+    t->fd = open(t->name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (t->fd < 0) {
+        fprintf(stderr, "Server: failed to open output file '%s'.\n", t->name);
+        free(t);
+        return -1;
+    }
 
-    printf("Server: start transfer -> writing to '%s'\n", gOutputFile);
+    rc = mapOutput(t, arqGetSessionSize());
+    if (rc < 0) {
+        close(t->fd);
+        unlink(t->name);
+        free(t);
+        return -1;
+    }
+
+    arqSetSessionCtx(t);
+
+    LOG_PRINTF(LOG_INFO, "Server: start transfer %u -> writing to '%s' (%s, %llu bytes announced)\n",
+               arqGetSessionId(), t->name, t->map ? "mmap" : "pwrite", arqGetSessionSize());
     return 0;
 }
 
-/* Nutzdaten in Datei schreiben. */
+/* Nutzdaten an das Ende der Datei des Transfers schreiben. */
 static int appWriteData(const char *buf, unsigned long len)
 {
-    /* TODO:
-     *   - prüfen, ob gFileOk und gFp gültig sind
-     *   - len Bytes aus buf in gFp schreiben (fwrite)
-     *   - bei Fehler <0 zurückgeben
-     *   - bei Erfolg 0 zurückgeben
-     */
-    if (!gFileOk || !gFp) {
+    struct transfer *t = arqGetSessionCtx();
+
+    if (!t || t->fd < 0) {
         fprintf(stderr, "Server: file not ready for writing.\n");
         return -1;
     }
 
-    if (fwrite(buf, 1, len, gFp) != len) {
-        fprintf(stderr, "Server: failed to write data to file.\n");
+    /* vorab angelegter Bereich: direkt in die gemappte Datei */
+    if (t->map && t->off + len <= t->mapLen) {
+        memcpy(t->map + t->off, buf, len);
+        t->off += len;
+        return 0;
+    }
+
+    /* sonst (bzw. mehr als angekündigt): über den Blockpuffer */
+    if (!t->blk && posix_memalign((void **)&t->blk, OUT_BLOCK_ALIGN, OUT_BLOCK_SIZE) != 0) {
+        t->blk = NULL;
+        fprintf(stderr, "Server: out of memory.\n");
+        return -1;
+    }
+    if (t->blkLen + len > OUT_BLOCK_SIZE && flushBlock(t) < 0) {
+        fprintf(stderr, "Server: failed to write data to '%s'.\n", t->name);
         return -1;
     }
+    memcpy(t->blk + t->blkLen, buf, len);
+    t->blkLen += len;
+    t->off += len;
 
     return 0;
 }
 
-/* Datei schließen. */
+/* Datei des Transfers abschließen: Rest schreiben, auf die tatsächliche Länge kürzen. */
 static void appEndTransfer(void)
 {
-    /* TODO:
-     *   - falls gFp != NULL: Datei schließen (fclose)
-     *   - gFp auf NULL setzen
-     *   - gFileOk zurücksetzen
-     */
-    if (gFp != NULL) {
-        fclose(gFp);
-    }
-    gFp = NULL;
-    gFileOk = 0;
+    struct transfer *t = arqGetSessionCtx();
+    unsigned long long written;
+
+    if (!t) {
+        return;
+    }
+    written = t->off;
+    if (t->blkLen > 0 && flushBlock(t) < 0) {
+        fprintf(stderr, "Server: failed to write data to '%s'.\n", t->name);
+        written = t->off - t->blkLen;
+    }
+    if (t->map) {
+        /* Rückschreiben anstoßen, ohne die Empfangsschleife zu blockieren */
+        msync(t->map, t->mapLen, MS_ASYNC);
+        munmap(t->map, t->mapLen);
+    }
+    /* weniger geschrieben als vorab angelegt (abgebrochener Transfer, Schreibfehler):
+     * Rest abschneiden, die Datei enthält nur tatsächlich geschriebene Bytes */
+    if (t->map && written < t->mapLen && ftruncate(t->fd, (off_t)written) < 0) {
+        perror("ftruncate");
+    }
+    close(t->fd);
+    LOG_PRINTF(LOG_INFO, "Server: end transfer %u ('%s', %llu bytes)\n", arqGetSessionId(), t->name, t->off);
+    free(t->blk);
+    free(t);
+    arqSetSessionCtx(NULL);
 }
 
 /* --- main: Argumente auswerten, ARQ-Schicht starten --- */
@@ -95,10 +280,28 @@ static void appEndTransfer(void)
 int main(int argc, char *argv[])
 {
     const char *port = DEFAULT_PORT;
-    double lossReq   = 0.0;
-    double lossAck   = 0.0;
+    struct chan_cfg reqCfg, ackCfg;
+    int    batchSize = ARQ_BATCH_DEFAULT;
+    int    maxWindow = ARQ_MAX_WINDOW;
+    int    maxTransfers = 0;
+    int    maxSessions  = ARQ_MAX_SESSIONS;
+    long   idleMs       = ARQ_SESSION_IDLE_MS;
+    int    workers      = 1;
+    int    affinity     = 0;
+    int    ackEvery     = ARQ_ACK_EVERY;
+    long   ackDelayMs   = ARQ_ACK_DELAY_MS;
+    int    level        = LOG_INFO;
+    const char *logFile = NULL;
+    const char *ctlSocket = NULL;
+    int    writerQueue  = 0;
+    long   maxPayload   = ARQ_PAYLOAD_MAX;
+    FILE  *logFp        = NULL;
+    char   chanDesc[256];
     long i;
 
+    chanDefaults(&reqCfg);
+    chanDefaults(&ackCfg);
+
     /* Programmargumente auswerten */
     if (argc > 1) {
         for (i = 1; i < argc; i++) {
@@ -125,7 +328,9 @@ int main(int argc, char *argv[])
 
                 case 'r': /* Request-Verlust */
                     if (argv[i + 1] && argv[i + 1][0] != '-') {
-                        lossReq = atof(argv[++i]);
+                        if (chanParse(&reqCfg, argv[++i], CHAN_DIR_REQ) < 0) {
+                            usage(argv[0]);
+                        }
                         break;
                     }
                     usage(argv[0]);
@@ -133,12 +338,122 @@ int main(int argc, char *argv[])
 
                 case 'a': /* ACK-Verlust */
                     if (argv[i + 1] && argv[i + 1][0] != '-') {
-                        lossAck = atof(argv[++i]);
+                        if (chanParse(&ackCfg, argv[++i], CHAN_DIR_ACK) < 0) {
+                            usage(argv[0]);
+                        }
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'b': /* Batchgröße */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        batchSize = atoi(argv[++i]);
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'w': /* max. Fenstergröße */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        maxWindow = atoi(argv[++i]);
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'n': /* Anzahl Transfers bis zum Beenden */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        maxTransfers = atoi(argv[++i]);
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 's': /* max. Sessions */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        maxSessions = atoi(argv[++i]);
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'i': /* Leerlaufzeit */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        idleMs = atol(argv[++i]);
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 't': /* Worker-Threads */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        workers = atoi(argv[++i]);
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'k': /* verzögerte ACKs: n[:ms] */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        char *ms = strchr(argv[++i], ':');
+                        ackEvery = atoi(argv[i]);
+                        if (ms) {
+                            ackDelayMs = atol(ms + 1);
+                        }
+                        if (ackEvery < 1 || ackDelayMs < 0) {
+                            usage(argv[0]);
+                        }
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'l': /* Log-Level */
+                    if (argv[i + 1] && argv[i + 1][0] != '-' &&
+                        (level = logParseLevel(argv[i + 1])) >= 0) {
+                        i++;
                         break;
                     }
                     usage(argv[0]);
                     break;
 
+                case 'd': /* Binär-Log */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        logFile = argv[++i];
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'u': /* Kontroll-Socket für Metriken */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        ctlSocket = argv[++i];
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'q': /* Schreib-Thread mit Queue-Tiefe */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        writerQueue = atoi(argv[++i]);
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'x': /* max. Nutzdaten je Paket */
+                    if (argv[i + 1] && argv[i + 1][0] != '-') {
+                        maxPayload = atol(argv[++i]);
+                        break;
+                    }
+                    usage(argv[0]);
+                    break;
+
+                case 'c': /* CPU-Affinität (ohne Argument) */
+                    affinity = 1;
+                    break;
+
                 default:
                     usage(argv[0]);
                     break;
@@ -154,13 +469,46 @@ int main(int argc, char *argv[])
     }
 
     printf("Server: listening on port %s\n", port);
-    printf("Server: lossReq = %f, lossAck = %f\n", lossReq, lossAck);
+    /* Kanalmodell je Richtung (loss allein ist bei ge= bzw. replay= 0) */
+    chanDescribe(&reqCfg, chanDesc, sizeof(chanDesc));
+    printf("Server: lossReq = %s\n", chanDesc);
+    chanDescribe(&ackCfg, chanDesc, sizeof(chanDesc));
+    printf("Server: lossAck = %s\n", chanDesc);
+
+    arqServerSetBatchSize(batchSize);
+    arqServerSetMaxWindow(maxWindow);
+    arqServerSetMaxPayload(maxPayload < 0 ? 0 : (unsigned long)maxPayload);
+    arqServerSetMaxSessions(maxSessions);
+    arqServerSetIdleTimeout(idleMs);
+    arqServerSetMaxTransfers(maxTransfers);
+    arqServerSetDelayedAck(ackEvery, ackDelayMs);
+    arqServerSetChannel(&reqCfg, &ackCfg);
+    arqServerSetControlSocket(ctlSocket);
+    arqServerSetWriterQueue(writerQueue);
+    arqServerSetWorkers(workers);
+    arqServerSetAffinity(affinity);
 
-    if (arqServerLoop(port, lossReq, lossAck,
+    logSetLevel(level);
+    if (logFile) {
+        logFp = fopen(logFile, "wb");
+        if (!logFp) {
+            fprintf(stderr, "Server: cannot open log file '%s'.\n", logFile);
+            return EXIT_FAILURE;
+        }
+        logSetBinary(logFp);
+    }
+
+    if (arqServerLoop(port, reqCfg.loss, ackCfg.loss,
                       appStartTransfer, appWriteData, appEndTransfer) < 0) {
         fprintf(stderr, "Server: arqServerLoop failed\n");
         return EXIT_FAILURE;
     }
 
+    if (logFp) {
+        fclose(logFp);
+    }
+    chanFree(&reqCfg);
+    chanFree(&ackCfg);
+
     return EXIT_SUCCESS;
 }
@@ -2,6 +2,9 @@
  *
  * Schichten:
  *   - SAP-Schicht (UDP): initServer, getRequest, sendAnswer, exitServer
+ *   - Sessions: Tabelle je Peer-Adresse, Leerlauf-Ablauf über ein Timer-Rad
+ *   - Worker: optional mehrere Threads mit je eigenem SO_REUSEPORT-Socket,
+ *     Batch-Puffern und Session-Tabelle (thread-lokal, ohne Locks)
  *   - ARQ-Schicht: processRequest(), arqServerLoop()
  *
  * Die Anwendung (Datei öffnen/schreiben/schließen) wird über Callbacks
@@ -15,11 +18,18 @@
  *     unverändert beibehalten werden.
  */
 
+#define _GNU_SOURCE /* recvmmsg/sendmmsg, pthread_setaffinity_np */
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
@@ -27,11 +37,45 @@
 #include "data.h"
 #include "config.h"
 #include "serverSy.h"
+#include "wire.h"
+#include "log.h"
+#include "chan.h"
+#include "stats.h"
+#include "evcount.h"
+
+/* Zustand der SAP-Schicht und der Batch-Puffer ist thread-lokal: jeder
+ * Worker (arqServerSetWorkers) hat seinen eigenen Socket und eigene Puffer,
+ * ohne Worker-Threads verhält sich alles wie bisher global.
+ */
 
 /* Globale Variablen für die SAP-Schicht */
-static int server_socket = -1;                    /* UDP/IPv6 Socket-Deskriptor */
-static struct sockaddr_storage client_addr;      /* zuletzt verbundener Client */
-static socklen_t client_addr_len;                /* Länge der Client-Adresse */
+static __thread int server_socket = -1;           /* UDP/IPv6 Socket-Deskriptor */
+static __thread struct sockaddr_storage client_addr; /* zuletzt verbundener Client */
+static __thread socklen_t client_addr_len;       /* Länge der Client-Adresse */
+static int reuse_port = 0;                       /* SO_REUSEPORT setzen (mehrere Worker) */
+
+/* Gebündelte I/O (recvmmsg/sendmmsg): Puffer je Datagramm im Batch */
+static int batch_size = ARQ_BATCH_DEFAULT;                 /* Datagramme pro Aufruf */
+static __thread unsigned char          *rx_buf = NULL;              /* empfangene Datagramme, je rx_stride Bytes */
+static __thread size_t                  rx_stride = WIRE_REQ_MAX;   /* Header + größte gewährte Nutzdaten */
+static __thread struct request          rx_req[ARQ_BATCH_MAX];      /* dekodierte Request-Header */
+static __thread const char             *rx_payload[ARQ_BATCH_MAX];  /* Nutzdaten (zeigt in rx_buf) */
+static __thread int                     rx_ok[ARQ_BATCH_MAX];       /* Datagramm gültig dekodiert? */
+static __thread struct sockaddr_storage rx_addr[ARQ_BATCH_MAX];     /* Absender je Request */
+static __thread struct mmsghdr          rx_msg[ARQ_BATCH_MAX];
+static __thread struct iovec            rx_iov[ARQ_BATCH_MAX];
+static __thread struct answer           tx_answ[ARQ_BATCH_MAX];     /* gesammelte Antworten */
+static __thread unsigned char           tx_buf[ARQ_BATCH_MAX][WIRE_ANSW_MAX]; /* ... kodiert */
+static __thread struct mmsghdr          tx_msg[ARQ_BATCH_MAX];
+static __thread struct iovec            tx_iov[ARQ_BATCH_MAX];
+static __thread int                     tx_count = 0;
+
+/* Zähler: Pakete und Systemaufrufe, zeigt die Ersparnis durch das Bündeln */
+static __thread unsigned long io_rx_packets = 0, io_rx_calls = 0;
+static __thread unsigned long io_tx_packets = 0, io_tx_calls = 0;
+/* Zähler: an die Anwendung übergebene Bytes, Zeitpunkt erster/letzter Daten (ms) */
+static __thread unsigned long long io_app_bytes = 0;
+static __thread long long io_app_first = 0, io_app_last = 0;
 
 /* --------------------------------------------------------------- */
 /*  SAP-Schicht (UDP)                                              */
@@ -77,6 +121,14 @@ int initServer(const char *port)
         return -1;
     }
 
+    /* Mehrere Worker teilen sich den Port, der Kernel verteilt per Flow-Hash */
+    if (reuse_port) {
+        int on = 1;
+        if (setsockopt(server_socket, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0) {
+            perror("setsockopt(SO_REUSEPORT)");
+        }
+    }
+
     /* Socket an lokale Adresse binden */
     if (bind(server_socket, res->ai_addr, res->ai_addrlen) < 0) {
         perror("bind");
@@ -87,7 +139,7 @@ int initServer(const char *port)
     }
 
     freeaddrinfo(res);
-    printf("[Server] Socket initialized on port %s\n", port);
+    LOG_PRINTF(LOG_INFO, "[Server] Socket initialized on port %s\n", port);
     return 0;
 }
 
@@ -101,6 +153,7 @@ int initServer(const char *port)
 struct request *getRequest(void)
 {
     static struct request req;
+    static unsigned char buf[WIRE_REQ_MAX];
     ssize_t n;
 
     if (server_socket < 0) {
@@ -112,7 +165,7 @@ struct request *getRequest(void)
     client_addr_len = sizeof(client_addr);
 
     /* Paket vom Socket lesen */
-    n = recvfrom(server_socket, &req, sizeof(req), 0,
+    n = recvfrom(server_socket, buf, sizeof(buf), 0,
                  (struct sockaddr *)&client_addr, &client_addr_len);
     
     if (n < 0) {
@@ -122,13 +175,13 @@ struct request *getRequest(void)
         return NULL;
     }
 
-    if (n < (ssize_t)sizeof(struct request)) {
-        fprintf(stderr, "getRequest: packet too small (%zd bytes)\n", n);
+    /* Leitungsformat dekodieren (Nutzdaten nach req.name kopieren) */
+    if (wireDecodeRequest(buf, (size_t)n, &req, NULL) < 0) {
+        fprintf(stderr, "getRequest: malformed packet (%zd bytes)\n", n);
         return NULL;
     }
 
-    printf("[Server] Received packet: Type=%c, SeNr=%lu, FlNr=%lu\n",
-           req.ReqType, req.SeNr, req.FlNr);
+    LOG_EV(LOG_DEBUG, EV_RX_PACKET, req.ReqType, req.SeNr, req.FlNr, 0);
 
     return &req;
 }
@@ -142,6 +195,8 @@ struct request *getRequest(void)
  */
 int sendAnswer(struct answer *answerPtr)
 {
+    unsigned char buf[WIRE_ANSW_MAX];
+    size_t len;
     ssize_t n;
 
     if (!answerPtr) {
@@ -154,7 +209,8 @@ int sendAnswer(struct answer *answerPtr)
         return -1;
     }
 
-    n = sendto(server_socket, answerPtr, sizeof(struct answer), 0,
+    len = wireEncodeAnswer(buf, sizeof(buf), answerPtr);
+    n = sendto(server_socket, buf, len, 0,
                (struct sockaddr *)&client_addr, client_addr_len);
 
     if (n < 0) {
@@ -162,9 +218,135 @@ int sendAnswer(struct answer *answerPtr)
         return -1;
     }
 
-    printf("[Server] Sent answer: Type=%c, SeNo=%lu (next expected)\n",
-           answerPtr->AnswType, answerPtr->SeNo);
+    LOG_EV(LOG_DEBUG, EV_TX_ANSWER, answerPtr->AnswType, answerPtr->SeNo, 0, 0);
+
+    return 0;
+}
+
+/**
+ * getRequests: Batch-Variante von getRequest()
+ *   - Blockierend bis mindestens ein Paket da ist, dann alle weiteren
+ *     bereits anstehenden (bis batch_size) im selben recvmmsg-Aufruf
+ *   - Absenderadresse je Paket in rx_addr[]
+ *   - timeoutMs >= 0: höchstens so lange auf das erste Paket warten
+ *
+ * Rückgabe: Anzahl Pakete in rx_req[] (>=0), <0 bei Fehler
+ */
+static int getRequests(int timeoutMs)
+{
+    int i, n;
+
+    if (server_socket < 0) {
+        fprintf(stderr, "getRequests: server not initialized\n");
+        return -1;
+    }
+
+    /* kürzer als der Tick (SO_RCVTIMEO) warten, z.B. bis zum nächsten verzögerten ACK */
+    if (timeoutMs >= 0) {
+        struct pollfd pfd;
+        pfd.fd = server_socket;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, timeoutMs) <= 0) {
+            return 0;  /* Zeit abgelaufen oder Signal */
+        }
+    }
+
+    for (i = 0; i < batch_size; i++) {
+        rx_iov[i].iov_base = rx_buf + (size_t)i * rx_stride;
+        rx_iov[i].iov_len  = rx_stride;
+        memset(&rx_msg[i], 0, sizeof(rx_msg[i]));
+        rx_msg[i].msg_hdr.msg_name    = &rx_addr[i];
+        rx_msg[i].msg_hdr.msg_namelen = sizeof(rx_addr[i]);
+        rx_msg[i].msg_hdr.msg_iov     = &rx_iov[i];
+        rx_msg[i].msg_hdr.msg_iovlen  = 1;
+    }
+
+    n = recvmmsg(server_socket, rx_msg, (unsigned int)batch_size, MSG_WAITFORONE, NULL);
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            perror("recvmmsg");
+        }
+        return (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    io_rx_calls++;
+    io_rx_packets += (unsigned long)n;
+    STAT_ADD(ST_REQ_RX, n);
+
+    /* Leitungsformat dekodieren, Nutzdaten bleiben in rx_buf (keine Kopie) */
+    for (i = 0; i < n; i++) {
+        rx_ok[i] = (wireDecodeRequest(rx_buf + (size_t)i * rx_stride, rx_msg[i].msg_len,
+                                      &rx_req[i], &rx_payload[i]) == 0);
+        if (!rx_ok[i]) {
+            fprintf(stderr, "getRequest: malformed packet (%u bytes)\n", rx_msg[i].msg_len);
+            continue;
+        }
+        LOG_EV(LOG_DEBUG, EV_RX_PACKET, rx_req[i].ReqType, rx_req[i].SeNr, rx_req[i].FlNr, 0);
+    }
+    return n;
+}
+
+static int sendAnswers(void);
+
+/*
+ * queueAnswer: Antwort an addr in den Sende-Batch legen (addr muss bis
+ * sendAnswers gültig bleiben, z.B. rx_addr[] oder die Session).
+ */
+static void queueAnswer(const struct answer *answerPtr, const struct sockaddr_storage *addr,
+                        socklen_t addrlen)
+{
+    struct mmsghdr *m;
+
+    if (tx_count >= ARQ_BATCH_MAX) {
+        sendAnswers();  /* voll, z.B. durch verzögerte ACKs vieler Sessions */
+    }
+    m = &tx_msg[tx_count];
+
+    tx_answ[tx_count] = *answerPtr;
+    STAT_INC(ST_ACKS_TX);
+    tx_iov[tx_count].iov_base = tx_buf[tx_count];
+    tx_iov[tx_count].iov_len  = wireEncodeAnswer(tx_buf[tx_count], sizeof(tx_buf[tx_count]),
+                                                 answerPtr);
+
+    memset(m, 0, sizeof(*m));
+    m->msg_hdr.msg_name    = (void *)addr;
+    m->msg_hdr.msg_namelen = addrlen;
+    m->msg_hdr.msg_iov     = &tx_iov[tx_count];
+    m->msg_hdr.msg_iovlen  = 1;
+    tx_count++;
+}
+
+/*
+ * sendAnswers: Batch-Variante von sendAnswer() - alle gesammelten
+ * Antworten mit möglichst wenigen sendmmsg-Aufrufen senden.
+ *
+ * Rückgabe: 0 bei Erfolg, <0 bei Fehler
+ */
+static int sendAnswers(void)
+{
+    int done = 0, n, i;
+
+    while (done < tx_count) {
+        n = sendmmsg(server_socket, &tx_msg[done], (unsigned int)(tx_count - done), 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("sendmmsg");
+            tx_count = 0;
+            return -1;
+        }
+        io_tx_calls++;
+        io_tx_packets += (unsigned long)n;
+
+        if (LOG_ENABLED(LOG_DEBUG)) {
+            for (i = done; i < done + n; i++) {
+                LOG_EV(LOG_DEBUG, EV_TX_ANSWER, tx_answ[i].AnswType, tx_answ[i].SeNo, 0, 0);
+            }
+        }
+        done += n;
+    }
 
+    tx_count = 0;
     return 0;
 }
 
@@ -179,235 +361,1795 @@ int exitServer(void)
         close(server_socket);
         server_socket = -1;
     }
-    printf("[Server] Server shutdown\n");
+    LOG_PRINTF(LOG_INFO, "[Server] Server shutdown\n");
     return 0;
 }
 
 /* --------------------------------------------------------------- */
-/*  ARQ-/GBN-Logik (Empfänger)                                     */
+/*  Sessions: eine pro Peer-Adresse                                */
 /* --------------------------------------------------------------- */
 
-/* Globale Zustandsvariablen für die ARQ-Logik */
-static unsigned long nextExpected = 0;  /* Nächst erwartete Sequenznummer */
-static int session_active = 0;          /* Session aktiv? (nach HELLO) */
+/* Empfangszustand eines Clients. Lebt vom ersten HELLO bis zum Ablauf
+ * der Leerlaufzeit; nach dem CLOSE bleibt sie noch so lange bestehen,
+ * damit wiederholte CLOSEs (verlorenes Close-ACK) erneut bestätigt werden.
+ */
+struct session {
+    struct sockaddr_storage addr;   /* Peer-Adresse (Schlüssel)                   */
+    socklen_t      addrlen;
+    unsigned int   id;              /* Transfer-Nummer (0, 1, 2, ...)              */
+    int            active;          /* nach HELLO, bis CLOSE                       */
+    int            started;         /* appStart erfolgreich, appEnd steht noch aus */
+    unsigned long  nextExpected;    /* nächst erwartete Sequenznummer (32 Bit)     */
+    unsigned long  isn;             /* Start-Sequenznummer aus dem HELLO           */
+    int            mode;            /* im HELLO ausgehandelter ARQ-Modus           */
+    int            window;          /* im HELLO gewährtes Fenster                  */
+    unsigned long  payload;         /* ... gewährte Nutzdaten je Paket (Bytes)     */
+    int            sack;            /* Client versteht SACK-Blöcke (nur SR)        */
+    int            rwnd;            /* Client versteht das Empfangsfenster (Rwnd)  */
+    int            fastOpen;        /* 0-RTT: HELLO-Nutzdaten und REQ_FLAG_EOS     */
+    int            helloData;       /* Nutzdaten aus dem HELLO angenommen          */
+    int            eos;             /* Paket mit REQ_FLAG_EOS übergeben            */
+    int            closed;          /* per CLOSE/EOS beendet, wartet auf den Ablauf */
+    unsigned long long size;        /* im HELLO angekündigte Dateigröße (0 = ?)    */
+    void          *ctx;             /* Anwendungskontext (arqSetSessionCtx)        */
+    long long      expires;         /* Ablauf der Leerlaufzeit (ms, monoton)       */
+    struct session *wheelNext;      /* Liste im Timer-Rad-Slot                     */
+
+    /* Verzögerte ACKs (ackDefer/ackFlush) */
+    int            ackPending;      /* Pakete in Reihenfolge seit dem letzten ACK  */
+    int            ackThresh;       /* ... ab so vielen sofort bestätigen          */
+    int            ackQuick;        /* so viele Pakete noch ohne Verzögerung       */
+    long long      ackDue;          /* spätestes ACK (ms, monoton)                 */
+    long long      ackSinceUs;      /* erstes zurückgehaltene Paket (µs, Statistik) */
+    int            ackListed;       /* in ack_list eingetragen                     */
+    struct session *ackNext;
+
+    /* Selective Repeat: Reorder-Puffer, zur Laufzeit für das gewährte Fenster
+     * angelegt (srAlloc), indiziert über SeNr & sr_mask, je sr_stride Bytes.
+     * Gültig sind nur Pakete mit nextExpected < SeNr < nextExpected + window.
+     */
+    unsigned long   sr_slots;
+    unsigned long   sr_mask;
+    unsigned long   sr_count;       /* gepufferte Pakete (Lücke offen, wenn > 0)   */
+    unsigned char  *sr_valid;
+    unsigned long  *sr_len;
+    unsigned short *sr_flags;
+    char           *sr_data;
+    unsigned long   sr_stride;
+};
+
+/* Session-Tabelle: Open Addressing mit linearer Sondierung über den Hash
+ * der Peer-Adresse, Löschen per Rückwärtsverschiebung (ohne Grabsteine).
+ * Leerlauf-Ablauf über ein Timer-Rad mit SESSION_WHEEL_SLOTS Slots à
+ * SESSION_WHEEL_TICK_MS; Sessions werden beim Erreichen ihres Slots nur
+ * geprüft und ggf. neu einsortiert, Aktivität setzt lediglich expires.
+ */
+#define SESSION_WHEEL_SLOTS    256
+#define SESSION_WHEEL_TICK_MS  250
+
+struct session_table {
+    struct session **slot;          /* Hash-Tabelle (NULL = frei)        */
+    unsigned long    mask;          /* Größe - 1 (Größe 2er-Potenz)      */
+    int              count;
+    struct session  *wheel[SESSION_WHEEL_SLOTS];
+    long long        wheelTick;     /* zuletzt abgearbeiteter Tick       */
+};
+
+static __thread struct session_table sessions;
+static __thread struct session *cur_session = NULL; /* Session des laufenden Callbacks */
+static __thread struct session *ack_list = NULL;    /* Sessions mit offenem verzögerten ACK */
+static __thread struct writeq  *writer = NULL;      /* Schreib-Queue des Workers, NULL = direkt */
+
+static int max_window = ARQ_MAX_WINDOW;      /* größtes Fenster, das im HELLO gewährt wird */
+static unsigned long max_payload = ARQ_PAYLOAD_MAX; /* größte Nutzdaten je Paket, die gewährt werden */
+static int max_sessions = ARQ_MAX_SESSIONS;  /* gleichzeitige Sessions */
+static long idle_ms = ARQ_SESSION_IDLE_MS;   /* Leerlaufzeit bis zum Ablauf */
+static int max_transfers = 0;                /* nach so vielen CLOSEs beenden (0 = nie) */
+static int ack_every = ARQ_ACK_EVERY;        /* verzögerte ACKs: spätestens nach so vielen Paketen */
+static long ack_delay_ms = ARQ_ACK_DELAY_MS; /* ... bzw. nach so vielen ms */
+static unsigned int next_id = 0;             /* Transfer-Nummer für das nächste HELLO (atomar) */
+static unsigned long sr_bytes = 0;           /* Reorder-Puffer aller Sessions in Bytes (atomar) */
+static int transfers_done = 0;               /* abgeschlossene Transfers aller Worker (atomar) */
+static volatile sig_atomic_t stop_requested = 0;
+static int all_done = 0;                     /* max_transfers erreicht: alle Worker beenden (atomar) */
+static long long linger_until = 0;           /* ... vorher bis dahin nur noch Wiederholungen bestätigen (ms, atomar) */
+
+/* Kanalmodell für simulierten Verlust, NULL = Bernoulli aus lossReq/lossAck */
+static const struct chan_cfg *chan_req_cfg = NULL;
+static const struct chan_cfg *chan_ack_cfg = NULL;
+
+static const char *ctl_path = NULL;          /* Kontroll-Socket (Metriken), NULL = keiner */
+
+/* Schreib-Thread: appWrite/appEnd laufen entkoppelt vom ACK-Pfad.
+ * Genau ein Produzent (Worker) und ein Konsument (Schreib-Thread): tail
+ * schreibt nur der Worker, head nur der Schreib-Thread, veröffentlicht per
+ * release/acquire. Beide liegen auf eigenen Cache-Lines. Bei leerer bzw.
+ * voller Queue wird per Eventcount (evcount.h) geschlafen statt abgefragt. */
+#define WQ_DATA      0
+#define WQ_END       1                       /* appEnd nach allen Daten des Transfers */
+#define WQ_FAILED_MAX 64                     /* gemerkte Transfers mit fehlgeschlagenem appWrite */
+
+struct wq_entry {
+    int            op;                       /* WQ_DATA / WQ_END */
+    unsigned int   id;                       /* Session-Sicht für die Callbacks */
+    void          *ctx;
+    unsigned long long size;
+    long long      queuedUs;                 /* Einreihen (Statistik) */
+    unsigned long  len;
+    unsigned short flags;
+    char           data[];                   /* max_payload Bytes (writeq.stride) */
+};
+
+struct writeq {
+    unsigned char   *ring;                   /* Einträge zu je stride Bytes */
+    unsigned long    mask;
+    size_t           stride;
+    pthread_t        thread;
+    unsigned long    tail __attribute__((aligned(64))); /* Worker: nächster freier Eintrag */
+    unsigned long    headCache;              /* Worker: zuletzt gelesener head */
+    struct evcount   notEmpty;               /* Worker weckt den wartenden Schreib-Thread */
+    unsigned long    head __attribute__((aligned(64))); /* Schreib-Thread: nächster Eintrag */
+    struct evcount   notFull;                /* Schreib-Thread weckt den wartenden Worker */
+    /* Ring der id + 1 fehlgeschlagener Transfers, failedCount zählt alle Einträge */
+    unsigned int     failedId[WQ_FAILED_MAX];
+    unsigned int     failedCount;
+    int              stop;
+};
+
+static int writeq_depth = 0;                 /* Einträge je Worker, 0 = ohne Schreib-Thread */
+
+/* Worker-Threads: je eigener Socket (SO_REUSEPORT), eigene Session-Tabelle */
+static int worker_count = 1;
+static int worker_affinity = 0;              /* Worker k auf die k-te erlaubte CPU pinnen */
+
+struct worker {
+    int           id;
+    int           cpu;                       /* gepinnte CPU, -1 = keine */
+    pthread_t     thread;
+    int           rc;                        /* Rückgabe der Empfangsschleife */
+    const char   *port;
+    struct chan   chanReq, chanAck;          /* eigener Zufallsstrom je Worker und Richtung */
+    struct writeq wq;                        /* Schreib-Queue (writeq_depth > 0) */
+    /* Statistik, beim Beenden aus den thread-lokalen Zählern übernommen */
+    int           transfers;
+    unsigned long rxPackets, rxCalls, txPackets, txCalls;
+    unsigned long long bytes;
+    long long     activeMs;                  /* erste bis letzte Datenübergabe */
+};
 
 /* Globale Callback-Funktionszeiger */
 static appStartFn g_appStart = NULL;
 static appWriteFn g_appWrite = NULL;
 static appEndFn   g_appEnd   = NULL;
 
-/*
- * Hilfsfunktion: Simuliert Paketverlust
- *   - Gibt 1 zurück (verwerfen), wenn rand() < loss_rate * RAND_MAX
- *   - Ansonsten 0 (behalten)
- */
-static int simulate_loss(double loss_rate)
+static long long nowMs(void)
 {
-    if (loss_rate <= 0.0) return 0;
-    if (loss_rate >= 1.0) return 1;
-    return (rand() < (int)(loss_rate * RAND_MAX)) ? 1 : 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 }
 
-/*
- * processRequest:
- *  - nimmt ein Request-Paket entgegen
- *  - führt die ARQ-/GBN-Empfangslogik aus
- *  - erzeugt eine passende Antwort (ACK/Fehler)
- *
- *   ReqHello:
- *     - Sequenznummernzustand initialisieren (nextExpected = 0)
- *     - Anwendung per appStartFn informieren
- *     - eine passende Antwort (AnswHello) eintragen
- *
- *   ReqData:
- *     - Sequenznummer prüfen
- *     - nur bei ReqType == ReqData AND SeNr == nextExpected: 
- *       * Nutzdaten an appWriteFn übergeben
- *       * nextExpected inkrementieren
- *     - ggf. ACK (AnswOk) mit nextExpected senden
- *       
- *   ReqClose:
- *     - appEndFn aufrufen
- *     - Abschluss-ACK senden
- *
- * lossReq:
- *   - simulierte Paketverlustrate für Requests (0.0..1.0)
- *     (z.B. über Zufallszahlvergleich ein Paket "fallen lassen")
- *
- * Rückgabewert:
- *   - Zeiger auf ausgefüllte Antwortstruktur (answPtr)
- *   - NULL, wenn das Request-Paket vollständig verworfen wurde
- */
-static struct answer *processRequest(struct request *reqPtr,
-                                     struct answer *answPtr,
-                                     double lossReq)
+static long long nowUs(void)
 {
-    if (!reqPtr || !answPtr) {
-        fprintf(stderr, "processRequest: invalid pointers\n");
-        return NULL;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Hash (FNV-1a) über Port und Adresse, Flowinfo bleibt außen vor */
+static unsigned long sessionHash(const struct sockaddr_storage *a)
+{
+    const unsigned char *p;
+    size_t n, k;
+    unsigned long h = 2166136261UL;
+
+    if (a->ss_family == AF_INET6) {
+        const struct sockaddr_in6 *a6 = (const struct sockaddr_in6 *)a;
+        h = (h ^ (a6->sin6_port & 0xff)) * 16777619UL;
+        h = (h ^ (a6->sin6_port >> 8)) * 16777619UL;
+        p = a6->sin6_addr.s6_addr;
+        n = sizeof(a6->sin6_addr);
+    } else {
+        p = (const unsigned char *)a;
+        n = sizeof(struct sockaddr_in);
     }
+    for (k = 0; k < n; k++) {
+        h = (h ^ p[k]) * 16777619UL;
+    }
+    return h;
+}
 
-    /* Paketverlust auf Sender-Seite simulieren */
-    if (simulate_loss(lossReq)) {
-        printf("[Server] Request packet DROPPED (simulated loss)\n");
-        return NULL;  /* Paket verworfen, kein ACK */
+static int sessionKeyEq(const struct sockaddr_storage *a, const struct sockaddr_storage *b)
+{
+    if (a->ss_family != b->ss_family) {
+        return 0;
+    }
+    if (a->ss_family == AF_INET6) {
+        const struct sockaddr_in6 *a6 = (const struct sockaddr_in6 *)a;
+        const struct sockaddr_in6 *b6 = (const struct sockaddr_in6 *)b;
+        return a6->sin6_port == b6->sin6_port &&
+               memcmp(&a6->sin6_addr, &b6->sin6_addr, sizeof(a6->sin6_addr)) == 0;
     }
+    return memcmp(a, b, sizeof(struct sockaddr_in)) == 0;
+}
 
-    /* Paketverarbeitung nach Typ */
-    switch (reqPtr->ReqType) {
+/* Adresse als "[addr]:port" für Logausgaben */
+static const char *sessionPeer(const struct session *s)
+{
+    static char buf[NI_MAXHOST + NI_MAXSERV + 4];
+    char host[NI_MAXHOST], serv[NI_MAXSERV];
 
-    case ReqHello:
-        printf("[Server] HELLO received\n");
-        
-        /* Session initialisieren */
-        nextExpected = 0;
-        session_active = 1;
-        
-        /* Anwendung starten */
-        if (g_appStart && g_appStart() < 0) {
-            fprintf(stderr, "[Server] appStart failed\n");
-            answPtr->AnswType = AnswErr;
-            answPtr->ErrNo = ERR_FILE_ERROR;
-        } else {
-            answPtr->AnswType = AnswHello;
-            answPtr->SeNo = 0;
+    if (getnameinfo((const struct sockaddr *)&s->addr, s->addrlen, host, sizeof(host),
+                    serv, sizeof(serv), NI_NUMERICHOST | NI_NUMERICSERV) != 0) {
+        return "?";
+    }
+    snprintf(buf, sizeof(buf), "[%s]:%s", host, serv);
+    return buf;
+}
+
+static int sessionTableInit(struct session_table *t, int maxSessions)
+{
+    unsigned long size = 1;
+
+    /* Füllgrad höchstens 1/2, damit die Sondierungsketten kurz bleiben */
+    while (size < 2UL * (unsigned long)maxSessions) {
+        size <<= 1;
+    }
+    memset(t, 0, sizeof(*t));
+    t->slot = calloc(size, sizeof(*t->slot));
+    if (!t->slot) {
+        return -1;
+    }
+    t->mask = size - 1;
+    t->wheelTick = nowMs() / SESSION_WHEEL_TICK_MS;
+    return 0;
+}
+
+static struct session *sessionFind(struct session_table *t, const struct sockaddr_storage *addr)
+{
+    unsigned long i = sessionHash(addr) & t->mask;
+
+    while (t->slot[i]) {
+        if (sessionKeyEq(&t->slot[i]->addr, addr)) {
+            return t->slot[i];
         }
-        break;
+        i = (i + 1) & t->mask;
+    }
+    return NULL;
+}
 
-    case ReqData:
-        printf("[Server] DATA received: SeNr=%lu, FlNr=%lu, nextExpected=%lu\n",
-               reqPtr->SeNr, reqPtr->FlNr, nextExpected);
+/* Session ins Timer-Rad einsortieren (Slot ihres Ablauf-Ticks) */
+static void wheelInsert(struct session_table *t, struct session *s)
+{
+    long long tick = s->expires / SESSION_WHEEL_TICK_MS;
 
-        if (!session_active) {
-            printf("[Server] DATA empfangen ohne aktive Session\n");
-            answPtr->AnswType = AnswErr;
-            answPtr->ErrNo = ERR_ILLEGAL_REQUEST;
-            answPtr->SeNo = nextExpected;
-        } else if (reqPtr->SeNr == nextExpected) {
-            /* *** RECEIVER-REGEL: Nur erwartete Sequenznummer akzeptieren *** */
-            printf("[Server] Accepting DATA with correct SeNr=%lu\n", reqPtr->SeNr);
-            
-            /* Nutzdaten an Anwendung übergeben */
-            if (g_appWrite) {
-                if (g_appWrite(reqPtr->name, reqPtr->FlNr) < 0) {
-                    fprintf(stderr, "[Server] appWrite failed\n");
-                    answPtr->AnswType = AnswErr;
-                    answPtr->ErrNo = ERR_FILE_ERROR;
-                    answPtr->SeNo = nextExpected;
-                } else {
-                    /* Erfolgreich geschrieben -> nächste Seq erwarten */
-                    nextExpected++;
-                    answPtr->AnswType = AnswOk;
-                    answPtr->SeNo = nextExpected;  /* Kumulativ */
-                }
-            } else {
-                nextExpected++;
-                answPtr->AnswType = AnswOk;
-                answPtr->SeNo = nextExpected;
-            }
-        } else {
-            /* DROPPEN: Out-of-order Paket */
-            printf("[Server] OUT-OF-ORDER: received SeNr=%lu, expected %lu -> DROPPED\n",
-                   reqPtr->SeNr, nextExpected);
-            /* Aber trotzdem ACK mit aktuell erwarteter Sequenznummer senden */
-            answPtr->AnswType = AnswOk;
-            answPtr->SeNo = nextExpected;  /* Kumulativ */
+    if (tick <= t->wheelTick) {
+        tick = t->wheelTick + 1;
+    }
+    s->wheelNext = t->wheel[tick % SESSION_WHEEL_SLOTS];
+    t->wheel[tick % SESSION_WHEEL_SLOTS] = s;
+}
+
+static struct session *sessionCreate(struct session_table *t, const struct sockaddr_storage *addr,
+                                     socklen_t addrlen)
+{
+    struct session *s;
+    unsigned long i;
+
+    if (t->count >= max_sessions) {
+        return NULL;
+    }
+    s = calloc(1, sizeof(*s));
+    if (!s) {
+        return NULL;
+    }
+    memcpy(&s->addr, addr, sizeof(s->addr));
+    s->addrlen = addrlen;
+    s->expires = nowMs() + idle_ms;
+
+    i = sessionHash(addr) & t->mask;
+    while (t->slot[i]) {
+        i = (i + 1) & t->mask;
+    }
+    t->slot[i] = s;
+    t->count++;
+    wheelInsert(t, s);
+    return s;
+}
+
+/* Session aus der Hash-Tabelle nehmen; nachfolgende Einträge der Sondierungskette
+ * rücken auf, wenn ihr Heimat-Slot nicht zwischen Lücke und aktueller Position liegt */
+static void sessionRemove(struct session_table *t, struct session *s)
+{
+    unsigned long i = sessionHash(&s->addr) & t->mask;
+    unsigned long j, home;
+
+    while (t->slot[i] != s) {
+        i = (i + 1) & t->mask;
+    }
+    t->slot[i] = NULL;
+    t->count--;
+
+    for (j = (i + 1) & t->mask; t->slot[j]; j = (j + 1) & t->mask) {
+        home = sessionHash(&t->slot[j]->addr) & t->mask;
+        if (((j - home) & t->mask) >= ((j - i) & t->mask)) {
+            t->slot[i] = t->slot[j];
+            t->slot[j] = NULL;
+            i = j;
         }
-        break;
+    }
+}
 
-    case ReqClose:
-        printf("[Server] CLOSE received\n");
-        
-        if (!session_active) {
-            printf("[Server] CLOSE ohne aktive Session\n");
-            answPtr->AnswType = AnswErr;
-            answPtr->ErrNo = ERR_ILLEGAL_REQUEST;
-        } else {
-            /* Anwendung beenden */
-            if (g_appEnd) {
-                g_appEnd();
+/*
+ * appWriteRecords: Nutzdaten an appWrite übergeben, bei REQ_FLAG_LINES je
+ * Zeile ein Aufruf. Rückgabe: 0 bei Erfolg, <0 wenn appWrite fehlschlägt.
+ */
+static int appWriteRecords(const char *buf, unsigned long len, unsigned short flags)
+{
+    if (flags & REQ_FLAG_LINES) {
+        const char *p = buf;
+        const char *end = buf + len;
+        while (p < end) {
+            const char *nl = memchr(p, '\n', (size_t)(end - p));
+            unsigned long rec = nl ? (unsigned long)(nl - p + 1) : (unsigned long)(end - p);
+            if (g_appWrite(p, rec) < 0) {
+                fprintf(stderr, "[Server] appWrite failed\n");
+                return -1;
             }
-            session_active = 0;
-            answPtr->AnswType = AnswOk;
-            answPtr->SeNo = nextExpected;  /* Finale Seq */
+            p += rec;
         }
-        break;
+    } else if (g_appWrite(buf, len) < 0) {
+        fprintf(stderr, "[Server] appWrite failed\n");
+        return -1;
+    }
+    return 0;
+}
 
-    default:
-        printf("[Server] Unknown ReqType: %c\n", reqPtr->ReqType);
-        answPtr->AnswType = AnswErr;
-        answPtr->ErrNo = ERR_ILLEGAL_REQUEST;
-        break;
+/* Schreib-Queue: freie Einträge (Worker), head nur bei Bedarf neu lesen */
+static unsigned long wqRoom(struct writeq *q, unsigned long need)
+{
+    unsigned long room = q->mask + 1 - (q->tail - q->headCache);
+
+    if (room < need) {
+        q->headCache = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+        room = q->mask + 1 - (q->tail - q->headCache);
     }
+    return room;
+}
 
-    return answPtr;
+static struct wq_entry *wqEntry(struct writeq *q, unsigned long pos)
+{
+    return (struct wq_entry *)(q->ring + (pos & q->mask) * q->stride);
 }
 
-/* --------------------------------------------------------------- */
-/*  ARQ-Server-Hauptschleife                                       */
-/* --------------------------------------------------------------- */
+/* nächsten Eintrag für s belegen (Platz vorher mit wqRoom prüfen) */
+static struct wq_entry *wqSlot(struct writeq *q, const struct session *s, int op)
+{
+    struct wq_entry *e = wqEntry(q, q->tail);
 
-int arqServerLoop(const char *port,
-                  double lossReq,
-                  double lossAck,
-                  appStartFn appStart,
-                  appWriteFn appWrite,
-                  appEndFn appEnd)
+    e->op = op;
+    e->id = s->id;
+    e->ctx = s->ctx;
+    e->size = s->size;
+    e->queuedUs = nowUs();
+    return e;
+}
+
+static void wqPush(struct writeq *q)
 {
-    struct request *reqPtr;
-    struct answer answer;
-    int ret;
+    __atomic_store_n(&q->tail, q->tail + 1, __ATOMIC_RELEASE);
+    evSignal(&q->notEmpty);
+}
 
-    /* Callbacks speichern */
-    g_appStart = appStart;
-    g_appWrite = appWrite;
-    g_appEnd = appEnd;
+/* Schreib-Queue hat keinen Platz für das nächste Paket samt gepufferter
+ * Nachfolger (SR), mit eos zusätzlich für das appEnd */
+static int wqFull(const struct session *s, int eos)
+{
+    unsigned long need = 1 + s->sr_count + (eos ? 1 : 0);
 
-    /* Server initialisieren */
-    if (initServer(port) < 0) {
-        fprintf(stderr, "[Server] Failed to initialize server\n");
-        return -1;
+    return writer && wqRoom(writer, need) < need;
+}
+
+/*
+ * sessionRwnd: Empfangsfenster für die Antwort - so viele Pakete ab dem
+ * kumulativ bestätigten nimmt die Session noch an. Ohne Schreib-Thread das
+ * gewährte Fenster, mit Schreib-Thread höchstens der freie Platz der Queue
+ * (die Worker-Queue teilen sich alle Sessions des Workers).
+ */
+static unsigned long sessionRwnd(const struct session *s)
+{
+    unsigned long w = (unsigned long)s->window;
+    unsigned long room;
+
+    if (writer && (room = wqRoom(writer, w)) < w) {
+        w = room;
     }
+    return w;
+}
 
-    printf("[Server] Starting ARQ loop (lossReq=%.2f, lossAck=%.2f)\n", lossReq, lossAck);
+/* id + 1 steht im Fehler-Ring von q (Worker und Schreib-Thread) */
+static int wqFailedId(struct writeq *q, unsigned int id1)
+{
+    unsigned int n = __atomic_load_n(&q->failedCount, __ATOMIC_ACQUIRE);
+    unsigned int k;
 
-    /* Hauptschleife: Pakete empfangen und verarbeiten */
-    while (1) {
-        /* Paket vom Client empfangen */
-        reqPtr = getRequest();
-        if (!reqPtr) {
-            /* Timeout oder Fehler - weitermachen */
-            continue;
+    if (n > WQ_FAILED_MAX) {
+        n = WQ_FAILED_MAX;
+    }
+    for (k = 0; k < n; k++) {
+        if (__atomic_load_n(&q->failedId[k], __ATOMIC_RELAXED) == id1) {
+            return 1;
         }
+    }
+    return 0;
+}
 
-        /* ARQ-Logik: Request verarbeiten */
-        if (processRequest(reqPtr, &answer, lossReq) == NULL) {
-            /* Paket wurde wegen simuliertem Verlust verworfen */
-            continue;
-        }
+/* appWrite des Transfers ist im Schreib-Thread fehlgeschlagen */
+static int wqFailed(const struct session *s)
+{
+    return writer && wqFailedId(writer, s->id + 1);
+}
 
-        /* ACK-Verlust simulieren */
-        if (simulate_loss(lossAck)) {
-            printf("[Server] ACK DROPPED (simulated loss) for SeNo=%lu\n", answer.SeNo);
-            continue;  /* ACK nicht senden */
-        }
+/*
+ * writerThread: Einträge der Queue in Reihenfolge an appWrite/appEnd geben.
+ * Die Callbacks sehen über cur_session eine Kopie der Session-Felder vom
+ * Einreihen, die Session selbst kann längst neu vergeben sein. Endet, wenn
+ * stop gesetzt und die Queue leer ist.
+ */
+static void *writerThread(void *arg)
+{
+    struct writeq *q = arg;
+    struct session view;
+    unsigned long head = q->head, tail;
+    unsigned int failed = 0;                 /* zuletzt fehlgeschlagener Transfer (id + 1) */
+    unsigned int key;
 
-        /* ACK senden */
-        ret = sendAnswer(&answer);
-        if (ret < 0) {
-            fprintf(stderr, "[Server] Failed to send answer\n");
-            /* Schleife fortsetzen - bei ernstlichen Fehlern könnte man auch abbrechen */
+    memset(&view, 0, sizeof(view));
+    cur_session = &view;
+    for (;;) {
+        tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            /* stop wird nach dem letzten Eintrag gesetzt: danach tail erneut lesen */
+            if (__atomic_load_n(&q->stop, __ATOMIC_ACQUIRE) &&
+                __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) == head) {
+                break;
+            }
+            key = evPrepare(&q->notEmpty);
+            if (__atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) == head &&
+                !__atomic_load_n(&q->stop, __ATOMIC_ACQUIRE)) {
+                evWait(&q->notEmpty, key);
+            } else {
+                evCancel(&q->notEmpty);
+            }
+            continue;
         }
-
-        /* Wenn CLOSE mit Erfolg abgeschlossen: Session beenden */
-        if (!session_active && answer.AnswType == AnswOk) {
-            printf("[Server] Session closed, exiting loop\n");
-            break;  /* Schleife beenden */
+        while (head != tail) {
+            struct wq_entry *e = wqEntry(q, head);
+            view.id = e->id;
+            view.ctx = e->ctx;
+            view.size = e->size;
+            if (e->op == WQ_END) {
+                if (g_appEnd) {
+                    g_appEnd();
+                }
+            } else if (g_appWrite && failed != e->id + 1 && !wqFailedId(q, e->id + 1) &&
+                       appWriteRecords(e->data, e->len, e->flags) < 0) {
+                /* der Worker meldet ERR_FILE_ERROR beim nächsten Paket des Transfers;
+                 * ein Ring statt eines Felds, damit ein zweiter Fehler den ersten
+                 * nicht überschreibt, solange dessen Session noch Pakete schickt */
+                failed = e->id + 1;
+                __atomic_store_n(&q->failedId[q->failedCount % WQ_FAILED_MAX], failed,
+                                 __ATOMIC_RELAXED);
+                __atomic_store_n(&q->failedCount, q->failedCount + 1, __ATOMIC_RELEASE);
+            }
+            STAT_HIST(SH_WRITE_LAG, nowUs() - e->queuedUs);
+            head++;
+            __atomic_store_n(&q->head, head, __ATOMIC_RELEASE);
+            evSignal(&q->notFull);
         }
     }
+    cur_session = NULL;
+    return NULL;
+}
 
-    /* Server cleanup */
-    exitServer();
-    printf("[Server] arqServerLoop terminated\n");
-    return 0;
+/*
+ * writerStart: Queue für depth Einträge (2er-Potenz) mit je payload Bytes
+ * Nutzdaten anlegen und den Schreib-Thread starten.
+ * Rückgabe: 0 bei Erfolg, <0 bei Fehler.
+ */
+static int writerStart(struct writeq *q, int depth, unsigned long payload)
+{
+    unsigned long n = 1;
+
+    while (n < (unsigned long)depth) {
+        n <<= 1;
+    }
+    memset(q, 0, sizeof(*q));
+    q->stride = (sizeof(struct wq_entry) + payload + 7) & ~(size_t)7;
+    q->ring = malloc(n * q->stride);
+    if (!q->ring) {
+        return -1;
+    }
+    q->mask = n - 1;
+    if (pthread_create(&q->thread, NULL, writerThread, q) != 0) {
+        free(q->ring);
+        q->ring = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/* writerStop: Queue leeren lassen, Schreib-Thread beenden */
+static void writerStop(struct writeq *q)
+{
+    if (!q->ring) {
+        return;
+    }
+    __atomic_store_n(&q->stop, 1, __ATOMIC_RELEASE);
+    evSignal(&q->notEmpty);
+    pthread_join(q->thread, NULL);
+    free(q->ring);
+    q->ring = NULL;
+}
+
+/*
+ * sessionEnd: Laufenden Transfer der Session beenden (appEnd mit ihrem
+ * Kontext). Mit Schreib-Thread wird appEnd hinter den Daten eingereiht; bei
+ * voller Queue wird hier gewartet (CLOSE und REQ_FLAG_EOS prüfen vorher und
+ * antworten stattdessen mit ERR_BACKPRESSURE).
+ */
+static void sessionEnd(struct session *s)
+{
+    if (s->started) {
+        if (writer) {
+            while (wqRoom(writer, 1) < 1) {
+                unsigned int key = evPrepare(&writer->notFull);
+                if (wqRoom(writer, 1) < 1) {
+                    evWait(&writer->notFull, key);
+                } else {
+                    evCancel(&writer->notFull);
+                }
+            }
+            wqSlot(writer, s, WQ_END);
+            wqPush(writer);
+        } else {
+            cur_session = s;
+            if (g_appEnd) {
+                g_appEnd();
+            }
+            cur_session = NULL;
+        }
+        s->started = 0;
+    }
+    s->active = 0;
+}
+
+/* Reorder-Puffer freigeben und aus sr_bytes austragen */
+static void srRelease(struct session *s)
+{
+    __atomic_fetch_sub(&sr_bytes, s->sr_slots * s->sr_stride, __ATOMIC_RELAXED);
+    free(s->sr_valid);
+    free(s->sr_len);
+    free(s->sr_flags);
+    free(s->sr_data);
+    s->sr_valid = NULL;
+    s->sr_len = NULL;
+    s->sr_flags = NULL;
+    s->sr_data = NULL;
+    s->sr_slots = 0;
+    s->sr_mask = 0;
+    s->sr_stride = 0;
+    s->sr_count = 0;
+}
+
+static void sessionFree(struct session *s)
+{
+    srRelease(s);
+    free(s);
+}
+
+/*
+ * sessionExpire: fällige Slots des Timer-Rads abarbeiten.
+ *   - Sessions, deren Leerlaufzeit abgelaufen ist, werden beendet und entfernt
+ *     (unvollständige Transfers mit Meldung, appEnd schließt die Datei)
+ *   - alle anderen werden gemäß ihrem aktuellen expires neu einsortiert
+ */
+static void sessionExpire(struct session_table *t, long long now)
+{
+    long long tick = now / SESSION_WHEEL_TICK_MS;
+    long long steps = tick - t->wheelTick;
+    struct session *s, *list;
+
+    if (steps > SESSION_WHEEL_SLOTS) {
+        steps = SESSION_WHEEL_SLOTS;  /* nach langer Pause jeden Slot einmal */
+    }
+    for (; steps > 0; steps--) {
+        t->wheelTick++;
+        list = t->wheel[t->wheelTick % SESSION_WHEEL_SLOTS];
+        t->wheel[t->wheelTick % SESSION_WHEEL_SLOTS] = NULL;
+
+        while ((s = list) != NULL) {
+            list = s->wheelNext;
+            if (s->expires > now) {
+                wheelInsert(t, s);
+                continue;
+            }
+            STAT_INC(ST_SESSIONS_EXPIRED);
+            if (s->active) {
+                LOG_PRINTF(LOG_INFO, "[Server] Session %u %s expired after %ld ms idle, transfer incomplete\n",
+                           s->id, sessionPeer(s), idle_ms);
+            }
+            sessionEnd(s);
+            sessionRemove(t, s);
+            sessionFree(s);
+        }
+    }
+    t->wheelTick = tick;
+}
+
+/* --------------------------------------------------------------- */
+/*  ARQ-/GBN-Logik (Empfänger)                                     */
+/* --------------------------------------------------------------- */
+
+/*
+ * deliverData: Nutzdaten an die Anwendung übergeben und nextExpected weiterzählen.
+ * Zusammengefasste Zeilen (REQ_FLAG_LINES) werden wieder in einzelne Datensätze
+ * (je inkl. '\n') zerlegt, Binärblöcke (REQ_FLAG_BLOCK) unverändert weitergereicht.
+ * Mit Schreib-Thread wird nur eingereiht, appWrite läuft dort.
+ * Rückgabe: 0 bei Erfolg, <0 wenn appWrite fehlschlägt.
+ */
+static int deliverData(struct session *s, const char *buf, unsigned long len, unsigned short flags)
+{
+    if (writer) {
+        /* nur einreihen, Platz hat processRequest vorab geprüft (wqFull) */
+        struct wq_entry *e = wqSlot(writer, s, WQ_DATA);
+        e->len = len;
+        e->flags = flags;
+        memcpy(e->data, buf, len);
+        wqPush(writer);
+    } else if (g_appWrite && appWriteRecords(buf, len, flags) < 0) {
+        return -1;
+    }
+    io_app_bytes += len;
+    STAT_ADD(ST_BYTES_DELIVERED, len);
+    io_app_last = nowMs();
+    if (io_app_first == 0) {
+        io_app_first = io_app_last;
+    }
+    s->nextExpected = SEQ_ADD(s->nextExpected, 1);
+    if (flags & REQ_FLAG_EOS) {
+        s->eos = 1;
+    }
+    return 0;
+}
+
+/* Einträge des Reorder-Puffers für window Pakete (2er-Potenz, wächst nur) */
+static unsigned long srSlots(const struct session *s, int window)
+{
+    unsigned long want = 1;
+
+    while (want < (unsigned long)window) {
+        want <<= 1;
+    }
+    return (want < s->sr_slots) ? s->sr_slots : want;
+}
+
+/* Nutzdatenbytes des Reorder-Puffers nach srAlloc für window Pakete */
+static unsigned long srBytes(const struct session *s, int window)
+{
+    return srSlots(s, window) * (s->payload > s->sr_stride ? s->payload : s->sr_stride);
+}
+
+/* Reorder-Puffer auf want Einträge à stride Bytes vergrößern, <0 wenn kein Speicher */
+static int srGrow(struct session *s, unsigned long want, unsigned long stride)
+{
+    void *p;
+
+    if ((p = realloc(s->sr_valid, want)) != NULL) s->sr_valid = p;
+    else return -1;
+    if ((p = realloc(s->sr_len, want * sizeof(*s->sr_len))) != NULL) s->sr_len = p;
+    else return -1;
+    if ((p = realloc(s->sr_flags, want * sizeof(*s->sr_flags))) != NULL) s->sr_flags = p;
+    else return -1;
+    if ((p = realloc(s->sr_data, want * stride)) != NULL) s->sr_data = p;
+    else return -1;
+    s->sr_stride = stride;
+    s->sr_slots = want;
+    s->sr_mask = want - 1;
+    return 0;
+}
+
+/*
+ * srAlloc: Reorder-Puffer der Session für s->window Pakete à s->payload Bytes
+ * anlegen (2er-Potenz, wächst nur) und leeren. Alle Sessions zusammen bleiben
+ * unter ARQ_SR_BYTES_TOTAL_MAX (sr_bytes, nur die Nutzdaten): reicht der Rest
+ * nicht, wird s->window halbiert, bis er reicht (mindestens 1 Paket).
+ * Rückgabe: 0 bei Erfolg, <0 wenn kein Speicher.
+ */
+static int srAlloc(struct session *s)
+{
+    unsigned long have = s->sr_slots * s->sr_stride;  /* schon gezählt */
+    unsigned long total = __atomic_load_n(&sr_bytes, __ATOMIC_RELAXED);
+    unsigned long other, avail, need;
+    int window;
+
+    /* Platz reservieren, bevor er belegt wird (mehrere Worker gleichzeitig) */
+    do {
+        other = total - have;
+        avail = (other < ARQ_SR_BYTES_TOTAL_MAX) ? ARQ_SR_BYTES_TOTAL_MAX - other : 0;
+        window = s->window;
+        while (window > 1 && srBytes(s, window) > avail) {
+            window = (window + 1) / 2;
+        }
+        need = srBytes(s, window);
+    } while (!__atomic_compare_exchange_n(&sr_bytes, &total, other + need, 0,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    if (window < s->window) {
+        LOG_PRINTF(LOG_INFO, "[Server] Session %u: window %d -> %d (reorder buffers at %lu of %lu MiB)\n",
+                   s->id, s->window, window, other >> 20, (unsigned long)ARQ_SR_BYTES_TOTAL_MAX >> 20);
+        s->window = window;
+    }
+
+    if (need > have && srGrow(s, srSlots(s, window), need / srSlots(s, window)) < 0) {
+        /* Puffer unverändert: Reservierung zurückgeben */
+        __atomic_fetch_sub(&sr_bytes, need - have, __ATOMIC_RELAXED);
+        return -1;
+    }
+    memset(s->sr_valid, 0, s->sr_slots);
+    s->sr_count = 0;
+    return 0;
+}
+
+/*
+ * srFlush: Selective Repeat - zusammenhängende Pakete ab nextExpected aus dem
+ * Reorder-Puffer in Reihenfolge an die Anwendung übergeben.
+ * Rückgabe: 0 bei Erfolg, <0 wenn appWrite fehlschlägt.
+ */
+static int srFlush(struct session *s)
+{
+    for (;;) {
+        unsigned long i = s->nextExpected & s->sr_mask;
+        if (!s->sr_valid[i]) {
+            return 0;
+        }
+        LOG_EV(LOG_DEBUG, EV_DATA_DELIVER, s->nextExpected, 0, 0, 0);
+        s->sr_valid[i] = 0;
+        s->sr_count--;
+        if (deliverData(s, s->sr_data + i * s->sr_stride, s->sr_len[i], s->sr_flags[i]) < 0) {
+            return -1;
+        }
+    }
+}
+
+/* SR-Reorder-Puffer: Paket seq gepuffert? (nur für seq im Fenster gültig) */
+#define SR_HAVE(s, seq)  ((s)->sr_valid[(seq) & (s)->sr_mask])
+
+/*
+ * sackFill: SACK-Blöcke der gepufferten Pakete hinter nextExpected eintragen.
+ * Der Block mit dem auslösenden Paket seNr zuerst, dann die übrigen
+ * aufsteigend; die Suche endet nach sr_count gepufferten Paketen.
+ */
+static void sackFill(struct session *s, struct answer *a, unsigned long seNr)
+{
+    uint32_t end = SEQ_ADD(s->nextExpected, s->window);
+    uint32_t q, start, firstStart = 0;
+    unsigned long seen = 0;
+
+    a->SackCount = 0;
+    if (s->sr_count == 0) {
+        return;
+    }
+
+    q = (uint32_t)seNr;
+    if (SEQ_LT(s->nextExpected, q) && SEQ_LT(q, end) && SR_HAVE(s, q)) {
+        start = q;
+        while (SEQ_DIFF(start, s->nextExpected) > 1 && SR_HAVE(s, start - 1)) {
+            start--;
+        }
+        while (SEQ_LT(q, end) && SR_HAVE(s, q)) {
+            q++;
+        }
+        a->Sack[0][0] = start;
+        a->Sack[0][1] = q;
+        a->SackCount = 1;
+        firstStart = start;
+    }
+
+    q = SEQ_ADD(s->nextExpected, 1);
+    while (SEQ_LT(q, end) && seen < s->sr_count && a->SackCount < ARQ_SACK_BLOCKS) {
+        if (!SR_HAVE(s, q)) {
+            q++;
+            continue;
+        }
+        start = q;
+        while (SEQ_LT(q, end) && SR_HAVE(s, q)) {
+            q++;
+            seen++;
+        }
+        if (a->SackCount == 0 || start != firstStart) {
+            a->Sack[a->SackCount][0] = start;
+            a->Sack[a->SackCount][1] = q;
+            a->SackCount++;
+        }
+    }
+}
+
+/*
+ * ackDefer: ACK für ein in Reihenfolge angenommenes DATA-Paket zurückhalten?
+ * Nein am Anfang der Session (ackQuick), direkt nach Lücken und solange bei SR
+ * noch Pakete im Reorder-Puffer liegen - dort braucht der Sender das ACK sofort.
+ * Sonst wird die Session in ack_list eingetragen; ackFlush bestätigt kumulativ
+ * nach ackThresh Paketen (spätestens am Ende des Empfangs-Batches) oder ackDue.
+ * Rückgabe: 1 = ACK zurückgehalten, 0 = sofort bestätigen
+ */
+static int ackDefer(struct session *s)
+{
+    int thresh = ack_every;
+
+    if (thresh > s->window / 2) {
+        thresh = s->window / 2;  /* kleines Fenster: Sender nicht bis zum Timer blockieren */
+    }
+    if (thresh <= 1 || s->ackQuick > 0 || (s->mode == ARQ_MODE_SR && s->sr_count > 0)) {
+        if (s->ackQuick > 0) {
+            s->ackQuick--;
+        }
+        return 0;
+    }
+    if (s->ackPending++ == 0) {
+        s->ackDue = nowMs() + ack_delay_ms;
+        s->ackSinceUs = nowUs();
+    }
+    STAT_INC(ST_ACKS_DELAYED);
+    s->ackThresh = thresh;
+    if (!s->ackListed) {
+        s->ackListed = 1;
+        s->ackNext = ack_list;
+        ack_list = s;
+    }
+    return 1;
+}
+
+/*
+ * ackFlush: zurückgehaltene ACKs in den Sende-Batch legen - bei genug Paketen,
+ * abgelaufenem ackDue oder force. Mehrere Pakete eines Batches ergeben so ein
+ * einziges kumulatives ACK (Stretch-ACK). Eine Session in ack_list läuft nicht
+ * ab, da ack_delay_ms kürzer ist als die Leerlaufzeit.
+ */
+static void ackFlush(long long now, struct chan *ackChan, int force)
+{
+    struct session **pp = &ack_list;
+    struct session *s;
+    struct answer answer;
+
+    while ((s = *pp) != NULL) {
+        if (s->ackPending > 0 && !force && s->ackPending < s->ackThresh && now < s->ackDue) {
+            pp = &s->ackNext;
+            continue;
+        }
+        if (s->ackPending > 0) {
+            memset(&answer, 0, sizeof(answer));
+            answer.AnswType = AnswOk;
+            answer.SeNo = s->nextExpected;  /* Kumulativ */
+            answer.RwndValid = (unsigned char)s->rwnd;
+            answer.Rwnd = s->rwnd ? sessionRwnd(s) : 0;
+            STAT_HIST(SH_ACK_HOLD, nowUs() - s->ackSinceUs);
+            if (chanDrop(ackChan)) {
+                LOG_EV(LOG_DEBUG, EV_ACK_DROPPED, answer.SeNo, 0, 0, 0);
+                STAT_INC(ST_SIM_ACK_DROPPED);
+            } else {
+                queueAnswer(&answer, &s->addr, s->addrlen);
+            }
+            s->ackPending = 0;
+        }
+        /* aus der Liste nehmen (auch, wenn ein sofortiges ACK alles bestätigt hat) */
+        *pp = s->ackNext;
+        s->ackListed = 0;
+    }
+}
+
+/* Wartezeit bis zum nächsten fälligen verzögerten ACK, -1 = keins offen */
+static int ackTimeout(long long now)
+{
+    long long due = -1;
+    struct session *s;
+
+    for (s = ack_list; s; s = s->ackNext) {
+        if (s->ackPending > 0 && (due < 0 || s->ackDue < due)) {
+            due = s->ackDue;
+        }
+    }
+    if (due < 0) {
+        return -1;
+    }
+    return (due > now) ? (int)(due - now) : 0;
+}
+
+/*
+ * sessionClose: Transfer nach dem CLOSE bzw. dem Paket mit REQ_FLAG_EOS
+ * beenden; die Session bleibt für wiederholte Pakete bis zum Ablauf bestehen.
+ * *closed = 1 nach CLOSE, 2 nach REQ_FLAG_EOS (0-RTT, Client wiederholt ggf. noch)
+ */
+static void sessionClose(struct session *s, int *closed)
+{
+    sessionEnd(s);
+    srRelease(s);  /* bis zum Ablauf nur noch Wiederholungen bestätigen, Puffer für andere frei */
+    s->closed = 1;
+    LOG_PRINTF(LOG_INFO, "[Server] Session %u %s closed\n", s->id, sessionPeer(s));
+    if (closed) {
+        *closed = s->eos ? 2 : 1;
+    }
+}
+
+/*
+ * processRequest:
+ *  - nimmt ein Request-Paket entgegen (dekodierter Header + Zeiger auf die Nutzdaten)
+ *  - ordnet es über die Absenderadresse einer Session zu (HELLO legt sie an)
+ *  - führt die ARQ-/GBN-Empfangslogik aus
+ *  - erzeugt eine passende Antwort (ACK/Fehler)
+ *
+ *   ReqHello:
+ *     - Session anlegen bzw. neuen Transfer beginnen
+ *       (wiederholtes HELLO mit derselben Start-Seq.: nur erneut bestätigen)
+ *     - 0-RTT: Nutzdaten hinter den Optionen wie ein DATA-Paket mit der
+ *       Start-Seq. übergeben, mit REQ_FLAG_EOS den Transfer gleich beenden
+ *     - Sequenznummernzustand initialisieren (nextExpected = Start-Seq. aus dem HELLO)
+ *     - ARQ-Modus (GBN/SR) und Fenstergröße aus den HELLO-Optionen aushandeln
+ *     - Anwendung per appStartFn informieren
+ *     - eine passende Antwort (AnswHello) eintragen
+ *
+ *   ReqData:
+ *     - Sequenznummer prüfen
+ *     - nur bei ReqType == ReqData AND SeNr == nextExpected:
+ *       * Nutzdaten an appWriteFn übergeben
+ *       * nextExpected inkrementieren
+ *       * SR: zusammenhängende Pakete aus dem Reorder-Puffer nachliefern
+ *     - SR: Out-of-order Pakete im Fenster puffern statt verwerfen
+ *     - ggf. ACK (AnswOk) mit nextExpected senden (SR: + selektives ACK in FlNr)
+ *     - in Reihenfolge: ACK ggf. verzögern (ackDefer), Lücken/Duplikate sofort
+ *     - REQ_FLAG_EOS: nach der Übergabe wie CLOSE abschließen (ohne eigene Seq.)
+ *     - nach dem Abschluss: Duplikate erneut kumulativ bestätigen
+ *
+ *   ReqClose:
+ *     - appEndFn aufrufen
+ *     - Abschluss-ACK senden (auch erneut für ein wiederholtes CLOSE)
+ *
+ * reqChan:
+ *   - Kanalmodell für simulierten Request-Verlust (chanDrop, reproduzierbar per Seed)
+ *
+ * Rückgabewert:
+ *   - Zeiger auf ausgefüllte Antwortstruktur (answPtr)
+ *   - NULL, wenn das Request-Paket vollständig verworfen wurde oder
+ *     sein ACK verzögert wird (ackDefer)
+ *   - *closed = 1 (2 mit REQ_FLAG_EOS), wenn mit diesem Request ein Transfer abgeschlossen wurde
+ */
+static struct answer *processRequest(struct request *reqPtr,
+                                     const char *payload,
+                                     const struct sockaddr_storage *peer,
+                                     socklen_t peerlen,
+                                     struct answer *answPtr,
+                                     struct chan *reqChan,
+                                     int *closed)
+{
+    struct session *s;
+
+    if (!reqPtr || !answPtr) {
+        fprintf(stderr, "processRequest: invalid pointers\n");
+        return NULL;
+    }
+
+    /* Paketverlust auf Sender-Seite simulieren */
+    if (chanDrop(reqChan)) {
+        LOG_EV(LOG_DEBUG, EV_REQ_DROPPED, 0, 0, 0, 0);
+        STAT_INC(ST_SIM_REQ_DROPPED);
+        return NULL;  /* Paket verworfen, kein ACK */
+    }
+
+    s = sessionFind(&sessions, peer);
+    if (s) {
+        s->expires = nowMs() + idle_ms;
+    }
+
+    /* Paketverarbeitung nach Typ */
+    switch (reqPtr->ReqType) {
+
+    case ReqHello: {
+        int mode = ARQ_MODE_GBN;
+        int window = GBN_MAX_WINDOW;
+        unsigned long isn = 0;
+        unsigned long long size = 0;
+        int sack = 0;
+        int rwnd = 0;
+        int fastOpen = 0;
+        unsigned long dataLen = 0;
+        unsigned long payloadMax = BufferSize;
+
+        LOG_EV(LOG_DEBUG, EV_HELLO, 0, 0, 0, 0);
+
+        /* HELLO-Optionen: alte Clients senden weniger bzw. keine -> GBN, GBN_MAX_WINDOW, 0 */
+        if (reqPtr->FlNr > HELLO_OPT_MODE &&
+            payload[HELLO_OPT_MODE] == ARQ_MODE_SR) {
+            mode = ARQ_MODE_SR;
+        }
+        if (reqPtr->FlNr >= HELLO_OPT_WINDOW + 4) {
+            uint32_t w = wireGetU32((const unsigned char *)payload + HELLO_OPT_WINDOW);
+            if (w > 0) {
+                window = (w < (uint32_t)max_window) ? (int)w : max_window;
+            }
+        }
+        if (reqPtr->FlNr >= HELLO_OPT_ISN + 4) {
+            isn = wireGetU32((const unsigned char *)payload + HELLO_OPT_ISN);
+        }
+        if (reqPtr->FlNr >= HELLO_OPT_SIZE + 8) {
+            size = ((unsigned long long)wireGetU32((const unsigned char *)payload + HELLO_OPT_SIZE) << 32) |
+                   wireGetU32((const unsigned char *)payload + HELLO_OPT_SIZE + 4);
+        }
+        if (reqPtr->FlNr > HELLO_OPT_FLAGS &&
+            (payload[HELLO_OPT_FLAGS] & HELLO_FLAG_SACK) && mode == ARQ_MODE_SR) {
+            sack = 1;
+        }
+        if (reqPtr->FlNr > HELLO_OPT_FLAGS && (payload[HELLO_OPT_FLAGS] & HELLO_FLAG_RWND)) {
+            rwnd = 1;
+        }
+        if (reqPtr->FlNr > HELLO_OPT_FLAGS && (payload[HELLO_OPT_FLAGS] & HELLO_FLAG_FASTOPEN)) {
+            fastOpen = 1;
+            dataLen = (reqPtr->FlNr > HELLO_OPT_LEN) ? reqPtr->FlNr - HELLO_OPT_LEN : 0;
+        }
+        if (reqPtr->FlNr > HELLO_OPT_FLAGS && (payload[HELLO_OPT_FLAGS] & HELLO_FLAG_PAYLOAD)) {
+            /* größere Pakete: Fenster mal Nutzdaten höchstens ARQ_WINDOW_BYTES_MAX */
+            payloadMax = (unsigned long)(ARQ_WINDOW_BYTES_MAX / window);
+            if (payloadMax > max_payload) payloadMax = max_payload;
+            if (payloadMax < BufferSize) payloadMax = BufferSize;
+        }
+
+        /* Wiederholtes HELLO (Hello-ACK verloren, Kopie oder verspätet): nur erneut
+         * bestätigen, auch wenn schon DATA angekommen ist bzw. der Transfer per CLOSE
+         * oder EOS beendet ist. Nur eine andere Start-Seq. beginnt neu. */
+        if (s && s->isn == isn && (s->active || s->closed)) {
+            answPtr->AnswType = AnswHello;
+            answPtr->SeNo = (unsigned long)s->window;
+            answPtr->FlNr = (unsigned long)s->mode |
+                            (s->fastOpen ? HELLO_ANSW_FASTOPEN : 0) |
+                            (s->helloData ? HELLO_ANSW_DATA : 0) |
+                            (payloadMax > BufferSize ? s->payload << HELLO_ANSW_PAYLOAD_SHIFT : 0);
+            break;
+        }
+
+        if (__atomic_load_n(&linger_until, __ATOMIC_RELAXED)) {
+            /* max_transfers erreicht: keine neuen Transfers mehr */
+            return NULL;
+        }
+        if (!s) {
+            s = sessionCreate(&sessions, peer, peerlen);
+            if (!s) {
+                fprintf(stderr, "[Server] no session slot for new client (max. %d)\n", max_sessions);
+                answPtr->AnswType = AnswErr;
+                answPtr->ErrNo = ERR_SERVER_BUSY;
+                STAT_INC(ST_SESSIONS_REJECTED);
+                break;
+            }
+        } else if (s->active) {
+            /* HELLO mit neuer Start-Seq. mitten im Transfer: alten Transfer abschließen */
+            LOG_PRINTF(LOG_INFO, "[Server] Session %u restarted by new HELLO\n", s->id);
+            sessionEnd(s);
+        }
+
+        /* Session (neuer Transfer) initialisieren */
+        s->id = __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED);
+        s->mode = mode;
+        s->window = window;
+        s->payload = payloadMax;
+        s->sack = sack;
+        s->rwnd = rwnd;
+        s->fastOpen = fastOpen;
+        s->helloData = 0;
+        s->eos = 0;
+        s->closed = 0;
+        s->isn = isn;
+        s->size = size;
+        s->nextExpected = isn;
+        s->active = 1;
+        s->ackQuick = ARQ_ACK_QUICK;
+        STAT_INC(ST_SESSIONS_OPENED);
+        LOG_PRINTF(LOG_INFO, "[Server] Session %u %s: ARQ mode %s, window %d, payload %lu, first SeNr %lu (%d sessions)\n",
+                   s->id, sessionPeer(s), mode == ARQ_MODE_SR ? (sack ? "SR+SACK" : "SR") : "GBN", window,
+                   payloadMax, isn, sessions.count);
+
+        cur_session = s;
+        if (mode == ARQ_MODE_SR && srAlloc(s) < 0) {
+            fprintf(stderr, "[Server] cannot allocate reorder buffer for %d packets\n", window);
+            s->active = 0;
+            answPtr->AnswType = AnswErr;
+            answPtr->ErrNo = ERR_INTERNAL;
+        } else if (g_appStart && g_appStart() < 0) {
+            /* Anwendung starten */
+            fprintf(stderr, "[Server] appStart failed\n");
+            s->active = 0;
+            answPtr->AnswType = AnswErr;
+            answPtr->ErrNo = ERR_FILE_ERROR;
+        } else {
+            s->started = 1;
+            answPtr->AnswType = AnswHello;
+            answPtr->SeNo = (unsigned long)s->window;  /* SR: ggf. von srAlloc verkleinert */
+            answPtr->FlNr = (unsigned long)mode | (fastOpen ? HELLO_ANSW_FASTOPEN : 0) |
+                            (payloadMax > BufferSize ? payloadMax << HELLO_ANSW_PAYLOAD_SHIFT : 0);
+
+            /* 0-RTT: ohne Platz in der Schreib-Queue nicht annehmen, der
+             * Client sendet die Daten dann als erstes DATA-Paket */
+            if (dataLen > 0 && !wqFull(s, reqPtr->Flags & REQ_FLAG_EOS)) {
+                LOG_EV(LOG_DEBUG, EV_DATA_ACCEPT, isn, 0, 0, 0);
+                STAT_INC(ST_DATA_IN_ORDER);
+                if (deliverData(s, payload + HELLO_OPT_LEN, dataLen, reqPtr->Flags) < 0) {
+                    answPtr->AnswType = AnswErr;
+                    answPtr->ErrNo = ERR_FILE_ERROR;
+                } else {
+                    s->helloData = 1;
+                    answPtr->FlNr |= HELLO_ANSW_DATA;
+                    if (s->eos) {
+                        sessionClose(s, closed);
+                    }
+                }
+            }
+        }
+        cur_session = NULL;
+        break;
+    }
+
+    case ReqData:
+        if (s && !s->active && s->started == 0 && SEQ_LT(reqPtr->SeNr, s->nextExpected) &&
+            SEQ_DIFF(s->nextExpected, reqPtr->SeNr) <= s->window) {
+            /* Transfer schon abgeschlossen (REQ_FLAG_EOS), ACK verloren: erneut bestätigen */
+            STAT_INC(ST_DATA_DISCARDED);
+            answPtr->AnswType = AnswOk;
+            answPtr->SeNo = s->nextExpected;
+            answPtr->FlNr = (s->mode == ARQ_MODE_SR) ? SEQ_ADD(reqPtr->SeNr, 1) : 0;
+            break;
+        }
+        if (!s || !s->active) {
+            LOG_EV(LOG_DEBUG, EV_DATA_NO_SESSION, 0, 0, 0, 0);
+            answPtr->AnswType = AnswErr;
+            answPtr->ErrNo = ERR_ILLEGAL_REQUEST;
+            break;
+        }
+
+        LOG_EV(LOG_DEBUG, EV_DATA, s->id, reqPtr->SeNr, reqPtr->FlNr, s->nextExpected);
+
+        if (wqFailed(s)) {
+            /* appWrite im Schreib-Thread fehlgeschlagen */
+            answPtr->AnswType = AnswErr;
+            answPtr->ErrNo = ERR_FILE_ERROR;
+            break;
+        }
+
+        /* SR: selektives ACK für genau dieses Paket (auch Duplikate erneut bestätigen) */
+        answPtr->FlNr = (s->mode == ARQ_MODE_SR) ? SEQ_ADD(reqPtr->SeNr, 1) : 0;
+
+        cur_session = s;
+        if (reqPtr->SeNr == s->nextExpected && wqFull(s, reqPtr->Flags & REQ_FLAG_EOS)) {
+            /* Schreib-Queue voll: Paket nicht annehmen, Sender bremsen (FlNr = kumulatives ACK) */
+            LOG_EV(LOG_DEBUG, EV_DATA_BACKPRESSURE, reqPtr->SeNr, 0, 0, 0);
+            STAT_INC(ST_BACKPRESSURE);
+            answPtr->AnswType = AnswWarn;
+            answPtr->ErrNo = ERR_BACKPRESSURE;
+            answPtr->FlNr = s->nextExpected;
+        } else if (reqPtr->SeNr == s->nextExpected) {
+            /* *** RECEIVER-REGEL: Nur erwartete Sequenznummer akzeptieren *** */
+            LOG_EV(LOG_DEBUG, EV_DATA_ACCEPT, reqPtr->SeNr, 0, 0, 0);
+            STAT_INC(ST_DATA_IN_ORDER);
+
+            /* Nutzdaten an Anwendung übergeben, bei SR gepufferte Nachfolger gleich mit */
+            if (deliverData(s, payload, reqPtr->FlNr, reqPtr->Flags) < 0 ||
+                (s->mode == ARQ_MODE_SR && srFlush(s) < 0)) {
+                answPtr->AnswType = AnswErr;
+                answPtr->ErrNo = ERR_FILE_ERROR;
+            } else if (s->eos) {
+                /* letztes Paket übergeben: Transfer wie mit CLOSE beenden, sofort bestätigen */
+                sessionClose(s, closed);
+                answPtr->AnswType = AnswOk;
+                answPtr->SeNo = s->nextExpected;
+            } else if (ackDefer(s)) {
+                /* ACK kommt gesammelt per ackFlush */
+                cur_session = NULL;
+                return NULL;
+            } else {
+                /* Erfolgreich geschrieben -> nächste Seq erwarten */
+                answPtr->AnswType = AnswOk;
+                answPtr->SeNo = s->nextExpected;  /* Kumulativ */
+            }
+        } else if (s->mode == ARQ_MODE_SR &&
+                   SEQ_DIFF(reqPtr->SeNr, s->nextExpected) > 0 &&
+                   SEQ_DIFF(reqPtr->SeNr, s->nextExpected) < s->window &&
+                   reqPtr->FlNr <= s->payload) {
+            /* SR: Out-of-order Paket im Reorder-Puffer ablegen */
+            unsigned long i = reqPtr->SeNr & s->sr_mask;
+            if (!s->sr_valid[i]) {
+                LOG_EV(LOG_DEBUG, EV_DATA_BUFFERED, reqPtr->SeNr, s->nextExpected, 0, 0);
+                memcpy(s->sr_data + i * s->sr_stride, payload, reqPtr->FlNr);
+                s->sr_len[i] = reqPtr->FlNr;
+                s->sr_flags[i] = reqPtr->Flags;
+                s->sr_valid[i] = 1;
+                s->sr_count++;
+                STAT_INC(ST_DATA_BUFFERED);
+            } else {
+                STAT_INC(ST_DATA_DISCARDED);
+            }
+            answPtr->AnswType = AnswOk;
+            answPtr->SeNo = s->nextExpected;  /* Kumulativ */
+            s->ackQuick = 1;  /* Lücke: das füllende Paket sofort bestätigen */
+        } else {
+            /* DROPPEN: Out-of-order Paket (GBN) bzw. außerhalb des Reorder-Puffers (SR) */
+            LOG_EV(LOG_DEBUG, EV_DATA_DROPPED, reqPtr->SeNr, s->nextExpected, 0, 0);
+            STAT_INC(ST_DATA_DISCARDED);
+            /* Aber trotzdem ACK mit aktuell erwarteter Sequenznummer senden */
+            answPtr->AnswType = AnswOk;
+            answPtr->SeNo = s->nextExpected;  /* Kumulativ */
+            if (SEQ_LT(s->nextExpected, reqPtr->SeNr)) {
+                answPtr->FlNr = 0;  /* nicht gepuffert -> nicht selektiv bestätigen */
+                s->ackQuick = 1;
+            }
+        }
+        if (s->sack && answPtr->AnswType == AnswOk) {
+            sackFill(s, answPtr, reqPtr->SeNr);
+        }
+        cur_session = NULL;
+        break;
+
+    case ReqClose:
+        LOG_EV(LOG_DEBUG, EV_CLOSE, 0, 0, 0, 0);
+
+        if (s && !s->active && s->started == 0 &&
+            SEQ_ADD(reqPtr->SeNr, 1) == s->nextExpected) {
+            /* wiederholtes CLOSE (Close-ACK verloren): erneut bestätigen */
+            answPtr->AnswType = AnswOk;
+            answPtr->SeNo = s->nextExpected;
+        } else if (!s || !s->active) {
+            LOG_EV(LOG_DEBUG, EV_CLOSE_NO_SESSION, 0, 0, 0, 0);
+            answPtr->AnswType = AnswErr;
+            answPtr->ErrNo = ERR_ILLEGAL_REQUEST;
+        } else if (reqPtr->SeNr != s->nextExpected) {
+            /* CLOSE überholt verlorene Daten -> wie Out-of-order behandeln */
+            LOG_EV(LOG_DEBUG, EV_CLOSE_DROPPED, reqPtr->SeNr, s->nextExpected, 0, 0);
+            answPtr->AnswType = AnswOk;
+            answPtr->SeNo = s->nextExpected;
+        } else if (wqFailed(s)) {
+            answPtr->AnswType = AnswErr;
+            answPtr->ErrNo = ERR_FILE_ERROR;
+        } else if (wqFull(s, 0)) {
+            /* kein Platz für appEnd: CLOSE wie ein Datenpaket zurückweisen */
+            LOG_EV(LOG_DEBUG, EV_DATA_BACKPRESSURE, reqPtr->SeNr, 0, 0, 0);
+            STAT_INC(ST_BACKPRESSURE);
+            answPtr->AnswType = AnswWarn;
+            answPtr->ErrNo = ERR_BACKPRESSURE;
+            answPtr->FlNr = s->nextExpected;
+        } else {
+            /* Anwendung beenden */
+            s->nextExpected = SEQ_ADD(s->nextExpected, 1);  /* CLOSE belegt selbst eine Sequenznummer */
+            sessionClose(s, closed);
+            answPtr->AnswType = AnswOk;
+            answPtr->SeNo = s->nextExpected;  /* Finale Seq (bestätigt auch das CLOSE) */
+        }
+        break;
+
+    case ReqProbe:
+        /* Pfad-MTU-Probe: nur Größe und Nummer zurückmelden, ACK-Zustand,
+         * verzögerte ACKs und Empfangsfenster bleiben unberührt */
+        if (!s || !s->active || reqPtr->FlNr > s->payload) {
+            STAT_INC(ST_DATA_DISCARDED);
+            return NULL;
+        }
+        STAT_INC(ST_PROBES_ANSWERED);
+        answPtr->AnswType = AnswProbe;
+        answPtr->SeNo = reqPtr->SeNr;
+        answPtr->FlNr = reqPtr->FlNr;
+        return answPtr;
+
+    default:
+        LOG_EV(LOG_DEBUG, EV_UNKNOWN_TYPE, reqPtr->ReqType, 0, 0, 0);
+        answPtr->AnswType = AnswErr;
+        answPtr->ErrNo = ERR_ILLEGAL_REQUEST;
+        break;
+    }
+
+    /* jede Antwort ist kumulativ und bestätigt zurückgehaltene Pakete mit */
+    if (s) {
+        if (s->rwnd && answPtr->AnswType != AnswErr) {
+            answPtr->RwndValid = 1;
+            answPtr->Rwnd = sessionRwnd(s);
+        }
+        if (s->ackPending > 0) {
+            STAT_HIST(SH_ACK_HOLD, nowUs() - s->ackSinceUs);
+        }
+        s->ackPending = 0;
+    }
+    return answPtr;
+}
+
+/* --------------------------------------------------------------- */
+/*  Session-API für die Anwendungscallbacks                        */
+/* --------------------------------------------------------------- */
+
+void arqSetSessionCtx(void *ctx)
+{
+    if (cur_session) {
+        cur_session->ctx = ctx;
+    }
+}
+
+void *arqGetSessionCtx(void)
+{
+    return cur_session ? cur_session->ctx : NULL;
+}
+
+unsigned int arqGetSessionId(void)
+{
+    return cur_session ? cur_session->id : 0;
+}
+
+unsigned long long arqGetSessionSize(void)
+{
+    return cur_session ? cur_session->size : 0;
+}
+
+/* --------------------------------------------------------------- */
+/*  ARQ-Server-Hauptschleife                                       */
+/* --------------------------------------------------------------- */
+
+void arqServerSetMaxWindow(int window)
+{
+    if (window < 1) window = 1;
+    if (window > ARQ_MAX_WINDOW) window = ARQ_MAX_WINDOW;
+    max_window = window;
+}
+
+void arqServerSetMaxPayload(unsigned long bytes)
+{
+    if (bytes < BufferSize) bytes = BufferSize;
+    if (bytes > ARQ_PAYLOAD_MAX) bytes = ARQ_PAYLOAD_MAX;
+    max_payload = bytes;
+}
+
+void arqServerSetBatchSize(int batch)
+{
+    if (batch < 1) batch = 1;
+    if (batch > ARQ_BATCH_MAX) batch = ARQ_BATCH_MAX;
+    batch_size = batch;
+}
+
+void arqServerSetMaxSessions(int count)
+{
+    max_sessions = (count < 1) ? 1 : count;
+}
+
+void arqServerSetIdleTimeout(long ms)
+{
+    idle_ms = (ms < SESSION_WHEEL_TICK_MS) ? SESSION_WHEEL_TICK_MS : ms;
+}
+
+void arqServerSetMaxTransfers(int count)
+{
+    max_transfers = (count < 0) ? 0 : count;
+}
+
+void arqServerSetDelayedAck(int every, long delayMs)
+{
+    ack_every = (every < 1) ? 1 : every;
+    if (delayMs < 0) delayMs = 0;
+    if (delayMs > ARQ_ACK_DELAY_MAX_MS) delayMs = ARQ_ACK_DELAY_MAX_MS;
+    ack_delay_ms = delayMs;
+}
+
+void arqServerSetChannel(const struct chan_cfg *req, const struct chan_cfg *ack)
+{
+    chan_req_cfg = req;
+    chan_ack_cfg = ack;
+}
+
+void arqServerSetControlSocket(const char *path)
+{
+    ctl_path = path;
+}
+
+void arqServerSetWriterQueue(int depth)
+{
+    int n = 64;
+
+    if (depth <= 0) {
+        writeq_depth = 0;
+        return;
+    }
+    while (n < depth && n < ARQ_WRITEQ_MAX) {
+        n <<= 1;
+    }
+    writeq_depth = n;
+}
+
+void arqServerSetWorkers(int count)
+{
+    if (count < 1) count = 1;
+    if (count > ARQ_MAX_WORKERS) count = ARQ_MAX_WORKERS;
+    worker_count = count;
+}
+
+void arqServerSetAffinity(int enable)
+{
+    worker_affinity = enable ? 1 : 0;
+}
+
+/* SIGINT/SIGTERM: Schleife beenden, offene Transfers sauber abschließen */
+static void onStopSignal(int sig)
+{
+    (void)sig;
+    stop_requested = 1;
+}
+
+/* k-te CPU aus der erlaubten CPU-Menge des Prozesses (zyklisch), -1 wenn unbekannt */
+static int workerCpu(int k)
+{
+    cpu_set_t set;
+    int cpu, n = 0, count;
+
+    if (sched_getaffinity(0, sizeof(set), &set) < 0 || (count = CPU_COUNT(&set)) == 0) {
+        return -1;
+    }
+    k %= count;
+    for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set) && n++ == k) {
+            return cpu;
+        }
+    }
+    return -1;
+}
+
+/*
+ * workerLoop: Empfangsschleife eines Workers (eigener Socket, eigene Sessions).
+ * Läuft bis max_transfers erreicht ist (alle Worker zusammen, endet der letzte
+ * per REQ_FLAG_EOS, noch ARQ_CLOSE_LINGER_MS für Wiederholungen) oder ein Stop-Signal kommt. Rückgabe: 0 bei Erfolg, <0 bei Fehler.
+ */
+static int workerLoop(struct worker *w)
+{
+    struct request *reqPtr;
+    struct answer answer;
+    struct timeval tick;
+    int n, k;
+    int closed;
+    unsigned long i;
+
+    /* Server initialisieren */
+    if (initServer(w->port) < 0) {
+        fprintf(stderr, "[Server] Failed to initialize server\n");
+        return -1;
+    }
+
+    if (sessionTableInit(&sessions, max_sessions) < 0) {
+        fprintf(stderr, "[Server] cannot allocate session table\n");
+        exitServer();
+        return -1;
+    }
+
+    /* Batch-Puffer für Datagramme bis zur größten gewährten Nutzdatengröße */
+    rx_stride = WIRE_REQ_HDR_LEN + max_payload;
+    rx_buf = malloc((size_t)batch_size * rx_stride);
+    if (!rx_buf) {
+        fprintf(stderr, "[Server] cannot allocate receive buffers\n");
+        free(sessions.slot);
+        sessions.slot = NULL;
+        exitServer();
+        return -1;
+    }
+
+    /* Schreib-Thread: appWrite/appEnd über die Queue */
+    if (writeq_depth > 0) {
+        if (writerStart(&w->wq, writeq_depth, max_payload) < 0) {
+            fprintf(stderr, "[Server] cannot start writer thread\n");
+            free(rx_buf);
+            rx_buf = NULL;
+            free(sessions.slot);
+            sessions.slot = NULL;
+            exitServer();
+            return -1;
+        }
+        writer = &w->wq;
+    }
+
+    /* Empfangspuffer für ein volles Fenster anfordern, mit größeren Paketen
+     * höchstens ARQ_WINDOW_BYTES_MAX Nutzdaten je Session dazu */
+    {
+        long want = (long)max_window * ARQ_SOCKBUF_PER_PKT;
+        if (max_payload > BufferSize) {
+            want += ARQ_WINDOW_BYTES_MAX;
+        }
+        int rcvbuf = (want < ARQ_SOCKBUF_MAX) ? (int)want : ARQ_SOCKBUF_MAX;
+        socklen_t optlen = sizeof(rcvbuf);
+        if (setsockopt(server_socket, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) < 0) {
+            perror("setsockopt(SO_RCVBUF)");
+        }
+        if (getsockopt(server_socket, SOL_SOCKET, SO_RCVBUF, &rcvbuf, &optlen) == 0) {
+            LOG_PRINTF(LOG_INFO, "[Server] Receive buffer %d bytes (max. window %d)\n", rcvbuf, max_window);
+        }
+    }
+
+    /* Empfang wacht spätestens nach einem Tick auf, damit das Timer-Rad weiterläuft
+     * und Stop-Anforderungen auch in Workern ohne Signal bemerkt werden */
+    tick.tv_sec = SESSION_WHEEL_TICK_MS / 1000;
+    tick.tv_usec = (SESSION_WHEEL_TICK_MS % 1000) * 1000;
+    if (setsockopt(server_socket, SOL_SOCKET, SO_RCVTIMEO, &tick, sizeof(tick)) < 0) {
+        perror("setsockopt(SO_RCVTIMEO)");
+    }
+
+    /* Hauptschleife: Pakete batchweise empfangen, verarbeiten, Antworten gesammelt senden */
+    while (!__atomic_load_n(&all_done, __ATOMIC_RELAXED) && !stop_requested) {
+        /* Pakete von den Clients empfangen (alle bereits anstehenden auf einmal) */
+        n = getRequests(ackTimeout(nowMs()));
+
+        for (k = 0; k < n && !__atomic_load_n(&all_done, __ATOMIC_RELAXED); k++) {
+            reqPtr = &rx_req[k];
+            if (!rx_ok[k]) {
+                continue;  /* ungültiges Datagramm, bereits gemeldet */
+            }
+
+            /* zuletzt verbundener Client (für sendAnswer()) */
+            memcpy(&client_addr, &rx_addr[k], sizeof(client_addr));
+            client_addr_len = rx_msg[k].msg_hdr.msg_namelen;
+
+            /* ARQ-Logik: Request der Session des Absenders zuordnen und verarbeiten */
+            memset(&answer, 0, sizeof(answer));
+            closed = 0;
+            if (processRequest(reqPtr, rx_payload[k], &rx_addr[k], client_addr_len,
+                               &answer, &w->chanReq, &closed) == NULL) {
+                /* Paket wegen simuliertem Verlust verworfen bzw. ACK verzögert */
+                continue;
+            }
+
+            /* ACK-Verlust simulieren */
+            if (chanDrop(&w->chanAck)) {
+                LOG_EV(LOG_DEBUG, EV_ACK_DROPPED, answer.SeNo, 0, 0, 0);
+                STAT_INC(ST_SIM_ACK_DROPPED);
+            } else {
+                /* ACK in den Sende-Batch */
+                queueAnswer(&answer, &rx_addr[k], client_addr_len);
+            }
+
+            /* Nach max_transfers abgeschlossenen Transfers (aller Worker) beenden (-n) */
+            if (closed) {
+                w->transfers++;
+                if (max_transfers > 0 &&
+                    __atomic_add_fetch(&transfers_done, 1, __ATOMIC_RELAXED) >= max_transfers) {
+                    LOG_PRINTF(LOG_INFO, "[Server] %d transfer(s) completed, exiting loop\n", max_transfers);
+                    if (closed == 2) {
+                        /* nach REQ_FLAG_EOS erst nach ARQ_CLOSE_LINGER_MS beenden: geht das
+                         * letzte ACK verloren, wird die Wiederholung noch bestätigt */
+                        __atomic_store_n(&linger_until, nowMs() + ARQ_CLOSE_LINGER_MS, __ATOMIC_RELAXED);
+                    } else {
+                        __atomic_store_n(&all_done, 1, __ATOMIC_RELAXED);
+                    }
+                }
+            }
+        }
+
+        /* fällige verzögerte ACKs dazu, dann ein sendmmsg für den ganzen Batch */
+        ackFlush(nowMs(), &w->chanAck, 0);
+        if (sendAnswers() < 0) {
+            fprintf(stderr, "[Server] Failed to send answers\n");
+            /* Schleife fortsetzen - bei ernstlichen Fehlern könnte man auch abbrechen */
+        }
+
+        /* Leerlauf-Ablauf der Sessions */
+        sessionExpire(&sessions, nowMs());
+
+        long long linger = __atomic_load_n(&linger_until, __ATOMIC_RELAXED);
+        if (linger && nowMs() >= linger) {
+            __atomic_store_n(&all_done, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    /* zurückgehaltene ACKs nicht verschlucken */
+    ackFlush(nowMs(), &w->chanAck, 1);
+    sendAnswers();
+
+    if (stop_requested && sessions.count > 0) {
+        LOG_PRINTF(LOG_INFO, "[Server] Stop requested, closing %d session(s)\n", sessions.count);
+    }
+
+    /* Verbleibende Sessions beenden (offene Dateien schließen) */
+    for (i = 0; i <= sessions.mask; i++) {
+        if (sessions.slot[i]) {
+            sessionEnd(sessions.slot[i]);
+            sessionFree(sessions.slot[i]);
+        }
+    }
+    free(sessions.slot);
+    sessions.slot = NULL;
+    sessions.count = 0;
+
+    /* eingereihte Daten und appEnd noch schreiben lassen */
+    if (writer) {
+        writerStop(writer);
+        writer = NULL;
+    }
+    free(rx_buf);
+    rx_buf = NULL;
+
+    /* Statistik für den Bericht in arqServerLoop übernehmen */
+    w->rxPackets = io_rx_packets;
+    w->rxCalls   = io_rx_calls;
+    w->txPackets = io_tx_packets;
+    w->txCalls   = io_tx_calls;
+    w->bytes     = io_app_bytes;
+    w->activeMs  = io_app_last - io_app_first;
+
+    /* Server cleanup */
+    exitServer();
+    return 0;
+}
+
+static void *workerThread(void *arg)
+{
+    struct worker *w = arg;
+
+    w->rc = workerLoop(w);
+    if (w->rc < 0) {
+        __atomic_store_n(&all_done, 1, __ATOMIC_RELAXED);  /* ohne eigenen Socket würden Flows dieses Workers ins Leere laufen */
+    }
+    return NULL;
+}
+
+int arqServerLoop(const char *port,
+                  double lossReq,
+                  double lossAck,
+                  appStartFn appStart,
+                  appWriteFn appWrite,
+                  appEndFn appEnd)
+{
+    struct worker workers[ARQ_MAX_WORKERS];
+    struct sigaction sa;
+    struct worker total;
+    struct chan_cfg reqCfg, ackCfg;
+    char desc[256];
+    int k, rc = 0;
+
+    /* Callbacks speichern */
+    g_appStart = appStart;
+    g_appWrite = appWrite;
+    g_appEnd = appEnd;
+
+    /* ohne SA_RESTART, damit recvmmsg bei SIGINT/SIGTERM zurückkehrt */
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onStopSignal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    /* Ereignis-Log: Ringe der Worker im Hintergrund leeren */
+    logStart();
+
+    /* Statistik: SIGUSR1 und Kontroll-Socket bedient ein eigener Thread */
+    statsInstallSignal("[Server]");
+    if (statsServe(ctl_path, "arq_server") < 0) {
+        /* -u angegeben, aber nicht nutzbar (z.B. keine Socket-Datei): nicht ohne Metriken laufen */
+        logStop();
+        return -1;
+    }
+    if (ctl_path) {
+        LOG_PRINTF(LOG_INFO, "[Server] Metrics on unix socket %s\n", ctl_path);
+    }
+
+    /* ohne Kanalmodell: unabhängiger Verlust aus lossReq/lossAck, fester Seed */
+    if (chan_req_cfg) {
+        reqCfg = *chan_req_cfg;
+    } else {
+        chanDefaults(&reqCfg);
+        reqCfg.loss = lossReq;
+    }
+    if (chan_ack_cfg) {
+        ackCfg = *chan_ack_cfg;
+    } else {
+        chanDefaults(&ackCfg);
+        ackCfg.loss = lossAck;
+    }
+    if (!chanLossOnly(&reqCfg) || !chanLossOnly(&ackCfg)) {
+        LOG_PRINTF(LOG_INFO, "[Server] delay/reorder/dup/rate are ignored in-process, use the proxy\n");
+    }
+
+    /* Schreib-Queue: Einträge fassen max_payload Bytes, zusammen höchstens
+     * ARQ_WRITEQ_BYTES_MAX (bei großen Paketen entsprechend weniger Einträge) */
+    while (writeq_depth > 64 &&
+           (long long)writeq_depth * (long long)max_payload > ARQ_WRITEQ_BYTES_MAX) {
+        writeq_depth >>= 1;
+    }
+
+    /* gepufferte SR-Pakete müssen samt Lückenfüller in die Schreib-Queue passen */
+    if (writeq_depth > 0 && max_window >= writeq_depth) {
+        max_window = writeq_depth - 1;
+    }
+
+    LOG_PRINTF(LOG_INFO, "[Server] Starting ARQ loop (max. %d sessions, idle %ld ms, %d worker(s), ACK every %d / %ld ms, payload <= %lu)\n",
+               max_sessions, idle_ms, worker_count, ack_every, ack_delay_ms, max_payload);
+    if (writeq_depth > 0) {
+        LOG_PRINTF(LOG_INFO, "[Server] Writer thread per worker, queue %d packets (max. window %d)\n",
+                   writeq_depth, max_window);
+    }
+    chanDescribe(&reqCfg, desc, sizeof(desc));
+    LOG_PRINTF(LOG_INFO, "[Server] Request channel: %s\n", desc);
+    chanDescribe(&ackCfg, desc, sizeof(desc));
+    LOG_PRINTF(LOG_INFO, "[Server] ACK channel: %s\n", desc);
+
+    memset(workers, 0, sizeof(workers));
+    reuse_port = (worker_count > 1);
+    for (k = 0; k < worker_count; k++) {
+        workers[k].id = k;
+        workers[k].cpu = worker_affinity ? workerCpu(k) : -1;
+        workers[k].port = port;
+        chanInit(&workers[k].chanReq, &reqCfg, 2 * k + CHAN_DIR_REQ);
+        chanInit(&workers[k].chanAck, &ackCfg, 2 * k + CHAN_DIR_ACK);
+    }
+
+    if (worker_count == 1) {
+        /* ein Worker: im aufrufenden Thread, wie bisher */
+        if (workers[0].cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(workers[0].cpu, &set);
+            sched_setaffinity(0, sizeof(set), &set);
+        }
+        workers[0].rc = workerLoop(&workers[0]);
+    } else {
+        for (k = 0; k < worker_count; k++) {
+            pthread_attr_t attr;
+            pthread_attr_init(&attr);
+            if (workers[k].cpu >= 0) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(workers[k].cpu, &set);
+                pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+            }
+            if (pthread_create(&workers[k].thread, &attr, workerThread, &workers[k]) != 0) {
+                fprintf(stderr, "[Server] cannot start worker %d\n", k);
+                workers[k].rc = -1;
+                __atomic_store_n(&all_done, 1, __ATOMIC_RELAXED);
+                pthread_attr_destroy(&attr);
+                break;
+            }
+            pthread_attr_destroy(&attr);
+        }
+        worker_count = k;
+        for (k = 0; k < worker_count; k++) {
+            pthread_join(workers[k].thread, NULL);
+        }
+    }
+
+    statsStop();
+    logStop();
+
+    /* Bericht je Worker und gesamt */
+    memset(&total, 0, sizeof(total));
+    for (k = 0; k < worker_count; k++) {
+        struct worker *w = &workers[k];
+        if (w->rc < 0) {
+            rc = -1;
+        }
+        LOG_PRINTF(LOG_INFO, "[Server] Worker %d (cpu %d): %d transfer(s), %llu bytes, %.2f MB/s\n",
+                   w->id, w->cpu, w->transfers, w->bytes,
+                   w->activeMs > 0 ? (double)w->bytes / (double)w->activeMs / 1000.0 : 0.0);
+        LOG_PRINTF(LOG_INFO, "[Server] I/O: rx %lu packets in %lu recvmmsg (%.1f/call), tx %lu answers in %lu sendmmsg (%.1f/call)\n",
+                   w->rxPackets, w->rxCalls, w->rxCalls ? (double)w->rxPackets / (double)w->rxCalls : 0.0,
+                   w->txPackets, w->txCalls, w->txCalls ? (double)w->txPackets / (double)w->txCalls : 0.0);
+        if (w->chanReq.dropped || w->chanAck.dropped) {
+            LOG_PRINTF(LOG_INFO, "[Server] Simulated loss: %lu of %lu requests, %lu of %lu ACKs\n",
+                       w->chanReq.dropped, w->chanReq.packets, w->chanAck.dropped, w->chanAck.packets);
+        }
+        total.transfers += w->transfers;
+        total.bytes += w->bytes;
+        total.rxPackets += w->rxPackets;
+        total.txPackets += w->txPackets;
+    }
+    if (worker_count > 1) {
+        LOG_PRINTF(LOG_INFO, "[Server] Total: %d transfer(s), %llu bytes, rx %lu packets, tx %lu answers\n",
+                   total.transfers, total.bytes, total.rxPackets, total.txPackets);
+    }
+
+    if (logLevel >= LOG_INFO) {
+        statsReport(stdout, "[Server]");
+    }
+
+    LOG_PRINTF(LOG_INFO, "[Server] arqServerLoop terminated\n");
+    return rc;
 }
@@ -2,6 +2,7 @@
 #define SERVERSY_H_INCLUDED
 
 #include "data.h"
+#include "chan.h"
 
 /*
  * Anwendungscallbacks:
@@ -34,13 +35,105 @@ struct request *getRequest(void);
 int sendAnswer(struct answer *answerPtr);
 int exitServer(void);
 
+/*
+ * Max. Datagramme pro recvmmsg/sendmmsg (1..ARQ_BATCH_MAX),
+ * vor arqServerLoop() aufrufen.
+ */
+void arqServerSetBatchSize(int batch);
+
+/*
+ * Größtes Fenster (Pakete), das einem Client im HELLO gewährt wird
+ * (1..ARQ_MAX_WINDOW), vor arqServerLoop() aufrufen.
+ */
+void arqServerSetMaxWindow(int window);
+
+/*
+ * Größte Nutzdaten je Paket (BufferSize..ARQ_PAYLOAD_MAX), die Clients mit
+ * HELLO_FLAG_PAYLOAD gewährt werden; bei großen Fenstern weniger, damit
+ * Fenster mal Nutzdaten unter ARQ_WINDOW_BYTES_MAX bleibt. Bestimmt auch
+ * die Batch-Puffer und die Einträge der Schreib-Queue. Vor arqServerLoop().
+ */
+void arqServerSetMaxPayload(unsigned long bytes);
+
+/*
+ * Sessions: der Server bedient gleichzeitig mehrere Clients (eine Session
+ * je Peer-Adresse). Vor arqServerLoop() aufrufen.
+ *   MaxSessions:  gleichzeitige Sessions, weitere HELLOs -> ERR_SERVER_BUSY
+ *   IdleTimeout:  Session ohne Pakete nach ms verwerfen (offener Transfer -> appEnd)
+ *   MaxTransfers: nach count abgeschlossenen Transfers beenden (0 = nie)
+ */
+void arqServerSetMaxSessions(int count);
+void arqServerSetIdleTimeout(long ms);
+void arqServerSetMaxTransfers(int count);
+
+/*
+ * Verzögerte ACKs: Pakete in Reihenfolge kumulativ erst nach every Paketen
+ * (höchstens halbes Fenster, Rest des Empfangs-Batches zusammengefasst) oder
+ * nach delayMs bestätigen. Lücken, Duplikate, HELLO und CLOSE immer sofort.
+ * every = 1: jedes Paket einzeln (bisheriges Verhalten). Vor arqServerLoop().
+ */
+void arqServerSetDelayedAck(int every, long delayMs);
+
+/*
+ * Simulierter Verlust über ein Kanalmodell (chan.h) statt der Raten aus
+ * arqServerLoop: Bernoulli, Gilbert-Elliott oder Verlustplan (replay),
+ * reproduzierbar über den Seed. Jeder Worker zieht einen eigenen Strom
+ * und beginnt einen Verlustplan von vorn. Delay/Reorder/Dup/Rate wirken
+ * nur im Proxy. NULL = lossReq/lossAck. Die cfg müssen bis zum Ende von
+ * arqServerLoop() gültig bleiben.
+ */
+void arqServerSetChannel(const struct chan_cfg *req, const struct chan_cfg *ack);
+
+/*
+ * Kontroll-Socket (Unix Domain) für Metriken im Prometheus-Textformat,
+ * z.B. "nc -U path" oder "curl --unix-socket path http://x/metrics".
+ * NULL = keiner (SIGUSR1 gibt den Zwischenstand trotzdem nach stderr aus).
+ * Vor arqServerLoop() aufrufen.
+ */
+void arqServerSetControlSocket(const char *path);
+
+/*
+ * Schreib-Thread je Worker: appWrite/appEnd laufen in einem eigenen Thread,
+ * gespeist über eine lock-freie SPSC-Queue mit depth Paketen (auf eine
+ * 2er-Potenz 64..ARQ_WRITEQ_MAX gerundet). Der Worker bestätigt, sobald ein
+ * Paket eingereiht ist; bei voller Queue antwortet er mit AnswWarn
+ * ERR_BACKPRESSURE und nimmt das Paket nicht an. Das gewährte Fenster bleibt
+ * unter depth. appStart läuft weiter im Worker; die Callbacks sehen dieselbe
+ * Session-API. 0 = ohne Thread (Default). Vor arqServerLoop() aufrufen.
+ */
+void arqServerSetWriterQueue(int depth);
+
+/*
+ * Worker-Threads (1..ARQ_MAX_WORKERS): jeder hat einen eigenen Socket auf
+ * demselben Port (SO_REUSEPORT), eigene Batch-Puffer und Session-Tabelle;
+ * der Kernel verteilt die Clients per Flow-Hash. Die Callbacks laufen dann
+ * parallel in mehreren Threads (Zustand über arqSetSessionCtx ablegen).
+ * Affinity: Worker k auf die k-te erlaubte CPU pinnen.
+ * Vor arqServerLoop() aufrufen.
+ */
+void arqServerSetWorkers(int count);
+void arqServerSetAffinity(int enable);
+
+/*
+ * Kontext der Session, für die gerade ein Callback läuft (z.B. FILE *),
+ * nur innerhalb von appStart/appWrite/appEnd gültig.
+ * arqGetSessionId: fortlaufende Transfer-Nummer (0, 1, 2, ...).
+ */
+void arqSetSessionCtx(void *ctx);
+void *arqGetSessionCtx(void);
+unsigned int arqGetSessionId(void);
+
+/* Im HELLO angekündigte Dateigröße in Bytes, 0 = unbekannt (alter Client, Pipe) */
+unsigned long long arqGetSessionSize(void);
+
 /*
  * ARQ-Server-Hauptschleife:
  *   - empfängt Requests über UDP
  *   - führt ARQ-Logik aus
  *   - ruft bei in-Order empfangenen Datenpaketen die Callbacks auf.
  *
- * lossReq / lossAck: Paket- und ACK-Verlustwahrscheinlichkeit (0.0–1.0)
+ * lossReq / lossAck: Paket- und ACK-Verlustwahrscheinlichkeit (0.0–1.0),
+ *   ohne arqServerSetChannel() mit festem Seed (reproduzierbar)
  * appStart/appWrite/appEnd: Anwendungscallbacks.
  * Die Signatur ist vorgegeben und soll beibehalten werden.
  */
@@ -0,0 +1,358 @@
+/* stats.c - Protokollzähler, Histogramme, Bericht und Kontroll-Socket (siehe stats.h) */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "stats.h"
+
+#define STATS_POLL_MS   200   /* Kontroll-Thread: SIGUSR1 spätestens nach so vielen ms */
+#define STATS_REQ_MS    50    /* auf eine Anfrage ("GET ...") höchstens so lange warten */
+
+__thread struct stats_block *statsSelf = NULL;
+
+static struct stats_block *blocks[STATS_MAX_BLOCKS];
+static int blockCount = 0;                      /* vergebene Blöcke (atomar) */
+static struct stats_block overflow;             /* für Threads ohne eigenen Block */
+
+static const char *const counterName[ST_COUNT] = {
+    [ST_DATA_SENT]         = "data_sent",
+    [ST_RETRANS]           = "retransmissions",
+    [ST_FAST_RETRANS]      = "fast_retransmits",
+    [ST_TIMEOUTS]          = "timeouts",
+    [ST_WINDOW_FULL]       = "window_full",
+    [ST_RWND_LIMITED]      = "rwnd_limited",
+    [ST_RING_FULL]         = "ring_full",
+    [ST_ACKS_RX]           = "acks_received",
+    [ST_DUP_ACKS]          = "dup_acks",
+    [ST_ACKS_STALE]        = "acks_stale",
+    [ST_BACKPRESSURE_RX]   = "backpressure_received",
+    [ST_READAHEAD_EMPTY]   = "readahead_empty",
+    [ST_PROBES_SENT]       = "probes_sent",
+    [ST_PROBES_LOST]       = "probes_lost",
+    [ST_REQ_RX]            = "requests_received",
+    [ST_DATA_IN_ORDER]     = "data_in_order",
+    [ST_DATA_BUFFERED]     = "data_buffered",
+    [ST_DATA_DISCARDED]    = "data_discarded",
+    [ST_ACKS_TX]           = "answers_sent",
+    [ST_ACKS_DELAYED]      = "acks_delayed",
+    [ST_BACKPRESSURE]      = "backpressure_sent",
+    [ST_SIM_REQ_DROPPED]   = "sim_requests_dropped",
+    [ST_SIM_ACK_DROPPED]   = "sim_acks_dropped",
+    [ST_SESSIONS_OPENED]   = "sessions_opened",
+    [ST_SESSIONS_EXPIRED]  = "sessions_expired",
+    [ST_SESSIONS_REJECTED] = "sessions_rejected",
+    [ST_BYTES_DELIVERED]   = "bytes_delivered",
+    [ST_PROBES_ANSWERED]   = "probes_answered",
+};
+
+static const char *const histName[SH_COUNT] = {
+    [SH_ACK_LATENCY] = "ack_latency",
+    [SH_ACK_HOLD]    = "ack_hold",
+    [SH_WRITE_LAG]   = "write_lag",
+};
+
+static volatile sig_atomic_t dumpRequested = 0;
+static const char *dumpWho = "";
+
+static pthread_t ctlThread;
+static volatile int ctlRunning = 0;
+static int ctlSock = -1;
+static char ctlPath[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static const char *ctlPrefix = "arq";
+
+/* Block für den aufrufenden Thread anlegen und registrieren */
+struct stats_block *statsAttach(void)
+{
+    struct stats_block *b;
+    int id = __atomic_fetch_add(&blockCount, 1, __ATOMIC_RELAXED);
+
+    if (id >= STATS_MAX_BLOCKS || (b = calloc(1, sizeof(*b))) == NULL) {
+        /* mehrere Schreiber möglich: Zählungen können verloren gehen, nie abstürzen */
+        statsSelf = &overflow;
+        return statsSelf;
+    }
+    __atomic_store_n(&blocks[id], b, __ATOMIC_RELEASE);
+    statsSelf = b;
+    return b;
+}
+
+static void addBlock(struct stats_block *out, const struct stats_block *b)
+{
+    int k, h;
+
+    for (k = 0; k < ST_COUNT; k++) {
+        out->c[k] += __atomic_load_n(&b->c[k], __ATOMIC_RELAXED);
+    }
+    for (h = 0; h < SH_COUNT; h++) {
+        uint64_t max = __atomic_load_n(&b->h[h].max, __ATOMIC_RELAXED);
+        for (k = 0; k < STATS_HIST_BUCKETS; k++) {
+            out->h[h].bucket[k] += __atomic_load_n(&b->h[h].bucket[k], __ATOMIC_RELAXED);
+        }
+        out->h[h].sum += __atomic_load_n(&b->h[h].sum, __ATOMIC_RELAXED);
+        if (max > out->h[h].max) {
+            out->h[h].max = max;
+        }
+    }
+}
+
+void statsSnapshot(struct stats_block *out)
+{
+    int n = __atomic_load_n(&blockCount, __ATOMIC_RELAXED);
+    int k;
+
+    memset(out, 0, sizeof(*out));
+    if (n > STATS_MAX_BLOCKS) {
+        n = STATS_MAX_BLOCKS;
+    }
+    for (k = 0; k < n; k++) {
+        struct stats_block *b = __atomic_load_n(&blocks[k], __ATOMIC_ACQUIRE);
+        if (b) {
+            addBlock(out, b);
+        }
+    }
+    addBlock(out, &overflow);
+}
+
+/* --------------------------------------------------------------- */
+/*  Ausgabe                                                        */
+/* --------------------------------------------------------------- */
+
+static uint64_t histCount(const struct stats_hist_data *d)
+{
+    uint64_t n = 0;
+    int k;
+
+    for (k = 0; k < STATS_HIST_BUCKETS; k++) {
+        n += d->bucket[k];
+    }
+    return n;
+}
+
+/* Obergrenze des Buckets, in dem das q-Quantil liegt (µs), höchstens max */
+static uint64_t histQuantile(const struct stats_hist_data *d, double q)
+{
+    uint64_t n = histCount(d), seen = 0;
+    uint64_t rank = (uint64_t)(q * (double)n);
+    int k;
+
+    for (k = 0; k < STATS_HIST_BUCKETS - 1; k++) {
+        seen += d->bucket[k];
+        if (seen > rank) {
+            uint64_t upper = (1ULL << k);
+            return upper < d->max ? upper : d->max;
+        }
+    }
+    return d->max;
+}
+
+void statsReport(FILE *out, const char *who)
+{
+    struct stats_block s;
+    int k;
+
+    statsSnapshot(&s);
+    fprintf(out, "%s statistics:\n", who);
+    for (k = 0; k < ST_COUNT; k++) {
+        if (s.c[k]) {
+            fprintf(out, "  %-22s %llu\n", counterName[k], (unsigned long long)s.c[k]);
+        }
+    }
+    for (k = 0; k < SH_COUNT; k++) {
+        const struct stats_hist_data *d = &s.h[k];
+        uint64_t n = histCount(d);
+        if (!n) {
+            continue;
+        }
+        fprintf(out, "  %-22s n=%llu mean=%llu us p50<=%llu us p90<=%llu us p99<=%llu us max=%llu us\n",
+                histName[k], (unsigned long long)n, (unsigned long long)(d->sum / n),
+                (unsigned long long)histQuantile(d, 0.50), (unsigned long long)histQuantile(d, 0.90),
+                (unsigned long long)histQuantile(d, 0.99), (unsigned long long)d->max);
+    }
+    fflush(out);
+}
+
+void statsPrometheus(FILE *out, const char *prefix)
+{
+    struct stats_block s;
+    int k, b;
+
+    statsSnapshot(&s);
+    for (k = 0; k < ST_COUNT; k++) {
+        fprintf(out, "# TYPE %s_%s_total counter\n%s_%s_total %llu\n",
+                prefix, counterName[k], prefix, counterName[k], (unsigned long long)s.c[k]);
+    }
+    for (k = 0; k < SH_COUNT; k++) {
+        const struct stats_hist_data *d = &s.h[k];
+        uint64_t cum = 0;
+
+        fprintf(out, "# TYPE %s_%s_seconds histogram\n", prefix, histName[k]);
+        for (b = 0; b < STATS_HIST_BUCKETS - 1; b++) {
+            cum += d->bucket[b];
+            fprintf(out, "%s_%s_seconds_bucket{le=\"%g\"} %llu\n",
+                    prefix, histName[k], (double)(1ULL << b) / 1e6, (unsigned long long)cum);
+        }
+        cum += d->bucket[STATS_HIST_BUCKETS - 1];
+        fprintf(out, "%s_%s_seconds_bucket{le=\"+Inf\"} %llu\n", prefix, histName[k], (unsigned long long)cum);
+        fprintf(out, "%s_%s_seconds_sum %.6f\n", prefix, histName[k], (double)d->sum / 1e6);
+        fprintf(out, "%s_%s_seconds_count %llu\n", prefix, histName[k], (unsigned long long)cum);
+    }
+}
+
+/* --------------------------------------------------------------- */
+/*  SIGUSR1                                                        */
+/* --------------------------------------------------------------- */
+
+static void onDumpSignal(int sig)
+{
+    (void)sig;
+    dumpRequested = 1;
+}
+
+void statsInstallSignal(const char *who)
+{
+    struct sigaction sa;
+
+    dumpWho = who;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onDumpSignal;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGUSR1, &sa, NULL);
+}
+
+void statsPoll(void)
+{
+    if (dumpRequested) {
+        dumpRequested = 0;
+        statsReport(stderr, dumpWho);
+    }
+}
+
+/* --------------------------------------------------------------- */
+/*  Kontroll-Socket                                                */
+/* --------------------------------------------------------------- */
+
+/* Eine Verbindung bedienen: Metriken schicken, bei "GET" als HTTP-Antwort */
+static void ctlServe(int fd)
+{
+    struct pollfd p = { fd, POLLIN, 0 };
+    char req[256];
+    char *text = NULL;
+    size_t len = 0;
+    ssize_t got = 0;
+    FILE *mem;
+
+    if (poll(&p, 1, STATS_REQ_MS) > 0) {
+        got = recv(fd, req, sizeof(req) - 1, MSG_DONTWAIT);
+    }
+    mem = open_memstream(&text, &len);
+    if (!mem) {
+        return;
+    }
+    statsPrometheus(mem, ctlPrefix);
+    fclose(mem);
+
+    if (got >= 4 && memcmp(req, "GET ", 4) == 0) {
+        char head[128];
+        int n = snprintf(head, sizeof(head),
+                         "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                         "Content-Length: %zu\r\n\r\n", len);
+        (void)send(fd, head, (size_t)n, MSG_NOSIGNAL);
+    }
+    (void)send(fd, text, len, MSG_NOSIGNAL);
+    free(text);
+}
+
+static void *ctlMain(void *arg)
+{
+    struct pollfd p;
+
+    (void)arg;
+    while (ctlRunning) {
+        p.fd = ctlSock;
+        p.events = POLLIN;
+        p.revents = 0;
+        if (poll(&p, ctlSock >= 0 ? 1 : 0, STATS_POLL_MS) > 0 && (p.revents & POLLIN)) {
+            int fd = accept(ctlSock, NULL, NULL);
+            if (fd >= 0) {
+                ctlServe(fd);
+                close(fd);
+            }
+        }
+        statsPoll();
+    }
+    return NULL;
+}
+
+int statsServe(const char *path, const char *prefix)
+{
+    struct sockaddr_un addr;
+    struct stat st;
+    sigset_t block, old;
+    int rc;
+
+    ctlPrefix = prefix;
+    if (path) {
+        if (strlen(path) >= sizeof(addr.sun_path)) {
+            fprintf(stderr, "[Stats] control socket path too long: %s\n", path);
+            return -1;
+        }
+        /* nur einen alten Socket ersetzen, nie eine Datei (Tippfehler bei -u) */
+        if (lstat(path, &st) == 0 && !S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "[Stats] %s exists and is not a socket\n", path);
+            return -1;
+        }
+        ctlSock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (ctlSock < 0) {
+            perror("socket(AF_UNIX)");
+            return -1;
+        }
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, path);
+        unlink(path);  /* Socket eines früheren Laufs (oben geprüft) */
+        if (bind(ctlSock, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(ctlSock, 8) < 0) {
+            perror(path);
+            close(ctlSock);
+            ctlSock = -1;
+            return -1;
+        }
+        strcpy(ctlPath, path);
+    }
+
+    /* Signale bleiben bei den Workern (recvmmsg soll bei SIGINT zurückkehren) */
+    sigfillset(&block);
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+    ctlRunning = 1;
+    rc = pthread_create(&ctlThread, NULL, ctlMain, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rc != 0) {
+        fprintf(stderr, "[Stats] cannot start control thread\n");
+        ctlRunning = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void statsStop(void)
+{
+    if (ctlRunning) {
+        ctlRunning = 0;
+        pthread_join(ctlThread, NULL);
+    }
+    if (ctlSock >= 0) {
+        close(ctlSock);
+        ctlSock = -1;
+        unlink(ctlPath);
+    }
+}
@@ -0,0 +1,132 @@
+/* stats.h - Protokollzähler und Latenz-Histogramme für Client und Server
+ *
+ * Jeder Thread zählt in einen eigenen Block (genau ein Schreiber), auf dem
+ * heißen Pfad ohne Lock und ohne atomare Read-Modify-Write-Operationen.
+ * Leser (Bericht, SIGUSR1, Kontroll-Socket) summieren die Blöcke aller
+ * Threads mit relaxed Loads, die Werte sind damit höchstens kurz veraltet.
+ *
+ * Histogramme haben logarithmische Buckets: Bucket b zählt Werte < 2^b µs,
+ * ausgegeben in Sekunden wie bei Prometheus (le-Grenzen kumulativ).
+ */
+
+#ifndef STATS_H_INCLUDED
+#define STATS_H_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define STATS_MAX_BLOCKS    72   /* Threads mit eigenem Block (wie LOG_MAX_RINGS) */
+#define STATS_HIST_BUCKETS  28   /* 1 µs .. 2^26 µs (~67 s), darüber +Inf         */
+
+/* Zähler; Reihenfolge = Index in statsCounterName (stats.c) */
+enum stats_counter {
+    /* Client */
+    ST_DATA_SENT = 0,       /* DATA/CLOSE erstmals gesendet                 */
+    ST_RETRANS,             /* wiederholte Pakete                           */
+    ST_FAST_RETRANS,        /* Fast Retransmits (doppelte ACKs)             */
+    ST_TIMEOUTS,            /* Retransmission-Timeouts                      */
+    ST_WINDOW_FULL,         /* Senden durch Fenster/cwnd blockiert          */
+    ST_RWND_LIMITED,        /* Senden durch Empfangsfenster blockiert       */
+    ST_RING_FULL,           /* Einreihen durch vollen Ringpuffer blockiert  */
+    ST_ACKS_RX,             /* empfangene ACKs                              */
+    ST_DUP_ACKS,            /* doppelte ACKs                                */
+    ST_ACKS_STALE,          /* ACKs außerhalb des Fensters                  */
+    ST_BACKPRESSURE_RX,     /* ERR_BACKPRESSURE-Warnungen empfangen         */
+    ST_READAHEAD_EMPTY,     /* Sender wartete auf den Lese-Thread (-r)      */
+    ST_PROBES_SENT,         /* Pfad-MTU-Proben gesendet                     */
+    ST_PROBES_LOST,         /* ... unbeantwortet bzw. EMSGSIZE              */
+    /* Server */
+    ST_REQ_RX,              /* empfangene Requests                          */
+    ST_DATA_IN_ORDER,       /* DATA in Reihenfolge angenommen               */
+    ST_DATA_BUFFERED,       /* SR: Out-of-order gepuffert                   */
+    ST_DATA_DISCARDED,      /* Duplikate / außerhalb des Fensters           */
+    ST_ACKS_TX,             /* gesendete Antworten                          */
+    ST_ACKS_DELAYED,        /* Pakete mit zurückgehaltenem ACK              */
+    ST_BACKPRESSURE,        /* Pakete wegen voller Schreib-Queue abgewiesen */
+    ST_SIM_REQ_DROPPED,     /* simulierter Request-Verlust                  */
+    ST_SIM_ACK_DROPPED,     /* simulierter ACK-Verlust                      */
+    ST_SESSIONS_OPENED,
+    ST_SESSIONS_EXPIRED,    /* per Leerlaufzeit verworfen                   */
+    ST_SESSIONS_REJECTED,   /* ERR_SERVER_BUSY                              */
+    ST_BYTES_DELIVERED,     /* an die Anwendung übergebene Nutzdaten        */
+    ST_PROBES_ANSWERED,     /* Pfad-MTU-Proben beantwortet                  */
+    ST_COUNT
+};
+
+/* Histogramme (Werte in µs) */
+enum stats_hist {
+    SH_ACK_LATENCY = 0,     /* Client: Senden -> kumulatives ACK (ohne Wiederholungen) */
+    SH_ACK_HOLD,            /* Server: erstes zurückgehaltene Paket -> ACK             */
+    SH_WRITE_LAG,           /* Server: Einreihen in die Schreib-Queue -> geschrieben   */
+    SH_COUNT
+};
+
+struct stats_hist_data {
+    uint64_t bucket[STATS_HIST_BUCKETS];
+    uint64_t sum;
+    uint64_t max;
+};
+
+struct stats_block {
+    uint64_t               c[ST_COUNT];
+    struct stats_hist_data h[SH_COUNT];
+};
+
+extern __thread struct stats_block *statsSelf;
+struct stats_block *statsAttach(void);
+
+/* Nur der eigene Thread schreibt: einfache Stores genügen, relaxed, damit
+ * Leser keine zerrissenen Werte sehen */
+static inline void statsAdd(int c, uint64_t n)
+{
+    struct stats_block *b = statsSelf ? statsSelf : statsAttach();
+    __atomic_store_n(&b->c[c], b->c[c] + n, __ATOMIC_RELAXED);
+}
+
+#define STAT_INC(c)     statsAdd((c), 1)
+#define STAT_ADD(c, n)  statsAdd((c), (uint64_t)(n))
+
+static inline void statsRecord(int h, long long us)
+{
+    struct stats_block *b = statsSelf ? statsSelf : statsAttach();
+    struct stats_hist_data *d = &b->h[h];
+    uint64_t v = (us > 0) ? (uint64_t)us : 0;
+    int k = v ? 64 - __builtin_clzll(v) : 0;
+
+    if (k >= STATS_HIST_BUCKETS) {
+        k = STATS_HIST_BUCKETS - 1;
+    }
+    __atomic_store_n(&d->bucket[k], d->bucket[k] + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&d->sum, d->sum + v, __ATOMIC_RELAXED);
+    if (v > d->max) {
+        __atomic_store_n(&d->max, v, __ATOMIC_RELAXED);
+    }
+}
+
+#define STAT_HIST(h, us) statsRecord((h), (us))
+
+/* Summe aller Threads */
+void statsSnapshot(struct stats_block *out);
+
+/* Bericht für Menschen: Zähler != 0, Histogramme mit Anzahl, Mittel, p50/p90/p99, Max */
+void statsReport(FILE *out, const char *who);
+
+/* Prometheus-Textformat, Metriken mit prefix (z.B. "arq_server") */
+void statsPrometheus(FILE *out, const char *prefix);
+
+/*
+ * SIGUSR1: Bericht nach stderr. Der Handler setzt nur ein Flag; ausgegeben
+ * wird in statsPoll() (Client-Schleife) bzw. im Kontroll-Thread (Server).
+ */
+void statsInstallSignal(const char *who);
+void statsPoll(void);
+
+/*
+ * Kontroll-Thread des Servers: bedient SIGUSR1 und, wenn path != NULL, einen
+ * Unix-Domain-Socket, der jeder Verbindung die Metriken im Prometheus-Format
+ * schickt (auf "GET ..." mit HTTP-Kopf, z.B. für curl --unix-socket).
+ */
+int statsServe(const char *path, const char *prefix);
+void statsStop(void);
+
+#endif /* STATS_H_INCLUDED */
@@ -0,0 +1,175 @@
+/* wire.c - Kodierung/Dekodierung des Leitungsformats (siehe wire.h) */
+
+#include <string.h>
+#include <stdint.h>
+#include <arpa/inet.h>
+
+#include "data.h"
+#include "wire.h"
+
+/* Hilfsfunktionen: Felder fester Breite in Network Byte Order lesen/schreiben */
+static void put16(unsigned char *p, uint16_t v)
+{
+    v = htons(v);
+    memcpy(p, &v, sizeof(v));
+}
+
+static void put32(unsigned char *p, uint32_t v)
+{
+    v = htonl(v);
+    memcpy(p, &v, sizeof(v));
+}
+
+static uint16_t get16(const unsigned char *p)
+{
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return ntohs(v);
+}
+
+static uint32_t get32(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return ntohl(v);
+}
+
+void wirePutU32(unsigned char *p, uint32_t v)
+{
+    put32(p, v);
+}
+
+uint32_t wireGetU32(const unsigned char *p)
+{
+    return get32(p);
+}
+
+size_t wireEncodeRequestHeader(unsigned char *buf, size_t cap, const struct request *req)
+{
+    size_t len = (size_t)req->FlNr;
+
+    if (len > ARQ_PAYLOAD_MAX || cap < WIRE_REQ_HDR_LEN) {
+        return 0;
+    }
+
+    buf[0] = WIRE_VERSION;
+    buf[1] = req->ReqType;
+    put16(buf + 2, req->Flags);
+    put32(buf + 4, (uint32_t)req->SeNr);
+    put16(buf + 8, (uint16_t)len);
+
+    return WIRE_REQ_HDR_LEN;
+}
+
+size_t wireEncodeRequest(unsigned char *buf, size_t cap, const struct request *req)
+{
+    size_t len = (size_t)req->FlNr;
+
+    if (len > sizeof(req->name) || cap < WIRE_REQ_HDR_LEN + len ||
+        wireEncodeRequestHeader(buf, cap, req) == 0) {
+        return 0;
+    }
+    memcpy(buf + WIRE_REQ_HDR_LEN, req->name, len);
+
+    return WIRE_REQ_HDR_LEN + len;
+}
+
+void wireOrRequestFlags(unsigned char *buf, unsigned short flags)
+{
+    put16(buf + 2, (uint16_t)(get16(buf + 2) | flags));
+}
+
+int wireDecodeRequest(const unsigned char *buf, size_t len, struct request *req,
+                      const char **payload)
+{
+    size_t flnr;
+
+    if (len < WIRE_REQ_HDR_LEN || buf[0] != WIRE_VERSION) {
+        return -1;
+    }
+
+    flnr = get16(buf + 8);
+    if (len != WIRE_REQ_HDR_LEN + flnr) {
+        return -1;  /* Payload-Länge passt nicht zum Datagramm */
+    }
+
+    req->ReqType = buf[1];
+    req->Flags   = get16(buf + 2);
+    req->SeNr    = get32(buf + 4);
+    req->FlNr    = flnr;
+
+    if (payload) {
+        *payload = (const char *)(buf + WIRE_REQ_HDR_LEN);
+    } else {
+        if (flnr > BufferSize) {
+            return -1;
+        }
+        memcpy(req->name, buf + WIRE_REQ_HDR_LEN, flnr);
+    }
+    return 0;
+}
+
+size_t wireEncodeAnswer(unsigned char *buf, size_t cap, const struct answer *answ)
+{
+    size_t n = (answ->SackCount < ARQ_SACK_BLOCKS) ? answ->SackCount : ARQ_SACK_BLOCKS;
+    size_t off = WIRE_ANSW_LEN + (answ->RwndValid ? WIRE_RWND_LEN : 0);
+    size_t len = off + n * WIRE_SACK_LEN;
+    size_t k;
+
+    if (cap < len) {
+        return 0;
+    }
+
+    buf[0] = WIRE_VERSION;
+    buf[1] = answ->AnswType;
+    put16(buf + 2, (n > 0 ? ANSW_FLAG_SACK : 0) | (answ->RwndValid ? ANSW_FLAG_RWND : 0));
+    put32(buf + 4, (uint32_t)answ->SeNo);
+    put32(buf + 8, (uint32_t)answ->FlNr);
+    if (answ->RwndValid) {
+        put32(buf + WIRE_ANSW_LEN, (uint32_t)answ->Rwnd);
+    }
+    for (k = 0; k < n; k++) {
+        put32(buf + off + k * WIRE_SACK_LEN, (uint32_t)answ->Sack[k][0]);
+        put32(buf + off + k * WIRE_SACK_LEN + 4, (uint32_t)answ->Sack[k][1]);
+    }
+
+    return len;
+}
+
+int wireDecodeAnswer(const unsigned char *buf, size_t len, struct answer *answ)
+{
+    size_t n = 0, k, off = WIRE_ANSW_LEN;
+    unsigned int flags;
+
+    if (len < WIRE_ANSW_LEN || buf[0] != WIRE_VERSION) {
+        return -1;
+    }
+    flags = get16(buf + 2);
+    if (flags & ANSW_FLAG_RWND) {
+        off += WIRE_RWND_LEN;
+        if (len < off) {
+            return -1;
+        }
+    }
+    if (flags & ANSW_FLAG_SACK) {
+        n = (len - off) / WIRE_SACK_LEN;
+        if (n == 0 || n > ARQ_SACK_BLOCKS) {
+            return -1;
+        }
+    }
+    if (len != off + n * WIRE_SACK_LEN) {
+        return -1;
+    }
+
+    answ->AnswType  = buf[1];
+    answ->SeNo      = get32(buf + 4);
+    answ->FlNr      = get32(buf + 8);
+    answ->RwndValid = (flags & ANSW_FLAG_RWND) ? 1 : 0;
+    answ->Rwnd      = answ->RwndValid ? get32(buf + WIRE_ANSW_LEN) : 0;
+    answ->SackCount = (unsigned char)n;
+    for (k = 0; k < n; k++) {
+        answ->Sack[k][0] = get32(buf + off + k * WIRE_SACK_LEN);
+        answ->Sack[k][1] = get32(buf + off + k * WIRE_SACK_LEN + 4);
+    }
+    return 0;
+}
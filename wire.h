@@ -0,0 +1,89 @@
+/* wire.h - kompaktes Leitungsformat für Requests und Antworten
+ *
+ * Die Strukturen aus data.h sind die Sicht der Programme; auf der
+ * Leitung wird ein gepackter, versionierter Header mit Feldern fester
+ * Breite in Network Byte Order (Big Endian) übertragen, gefolgt von
+ * genau FlNr Bytes Nutzdaten. Gemeinsam genutzt von clientSy.c und
+ * serverSy.c.
+ *
+ * Request (WIRE_REQ_HDR_LEN = 10 Bytes + Payload):
+ *   Offset 0  u8   Version (WIRE_VERSION)
+ *   Offset 1  u8   ReqType ('H', 'D', 'C', 'P')
+ *   Offset 2  u16  Flags (REQ_FLAG_*)
+ *   Offset 4  u32  SeNr
+ *   Offset 8  u16  FlNr (Länge der folgenden Payload)
+ *   Offset 10 ...  Payload (FlNr Bytes)
+ *
+ * Antwort (WIRE_ANSW_LEN = 12 Bytes, mit Rwnd + 4, mit SACK + 8 Bytes je Block):
+ *   Offset 0  u8   Version (WIRE_VERSION)
+ *   Offset 1  u8   AnswType ('H', 'O', 'W', 'P', 0xFF)
+ *   Offset 2  u16  Flags (ANSW_FLAG_SACK, ANSW_FLAG_RWND)
+ *   Offset 4  u32  SeNo (bzw. ErrNo)
+ *   Offset 8  u32  FlNr
+ *   Offset 12 u32  nur mit ANSW_FLAG_RWND: Rwnd
+ *   danach    ...  nur mit ANSW_FLAG_SACK: SackCount mal u32 Start, u32 Ende
+ */
+
+#ifndef WIRE_H_INCLUDED
+#define WIRE_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "data.h"
+
+#define WIRE_VERSION      1
+
+#define WIRE_REQ_HDR_LEN  10
+#define WIRE_REQ_MAX      (WIRE_REQ_HDR_LEN + ARQ_PAYLOAD_MAX) /* größtes Request-Datagramm */
+#define WIRE_ANSW_LEN     12
+#define WIRE_SACK_LEN     8                                /* ein SACK-Block            */
+#define WIRE_RWND_LEN     4
+#define WIRE_ANSW_MAX     (WIRE_ANSW_LEN + WIRE_RWND_LEN + ARQ_SACK_BLOCKS * WIRE_SACK_LEN) /* größtes Antwort-Datagramm */
+
+#define ANSW_FLAG_SACK    0x0001  /* SACK-Blöcke folgen dem Header */
+#define ANSW_FLAG_RWND    0x0002  /* Empfangsfenster folgt dem Header */
+
+/* Sequenznummern sind 32 Bit und laufen über: Vergleich als Seriennummern
+ * (RFC 1982) über die vorzeichenbehaftete Differenz, gültig solange die
+ * verglichenen Nummern weniger als 2^31 auseinander liegen.
+ */
+#define SEQ_DIFF(a, b)  ((int32_t)((uint32_t)(a) - (uint32_t)(b)))
+#define SEQ_LT(a, b)    (SEQ_DIFF(a, b) < 0)
+#define SEQ_LE(a, b)    (SEQ_DIFF(a, b) <= 0)
+#define SEQ_ADD(a, n)   ((uint32_t)((uint32_t)(a) + (uint32_t)(n)))
+
+/* u32 in Network Byte Order lesen/schreiben (z.B. HELLO-Optionen in der Payload) */
+void     wirePutU32(unsigned char *p, uint32_t v);
+uint32_t wireGetU32(const unsigned char *p);
+
+/* Request kodieren (Header + FlNr Bytes aus req->name, also höchstens BufferSize).
+ * Rückgabe: Länge des Datagramms, 0 wenn buf zu klein oder FlNr ungültig.
+ */
+size_t wireEncodeRequest(unsigned char *buf, size_t cap, const struct request *req);
+
+/* Nur den Header kodieren; die FlNr Bytes Nutzdaten (bis ARQ_PAYLOAD_MAX)
+ * liegen woanders, z.B. direkt dahinter oder in einem zweiten iovec.
+ * Rückgabe: WIRE_REQ_HDR_LEN, 0 wenn buf zu klein oder FlNr ungültig.
+ */
+size_t wireEncodeRequestHeader(unsigned char *buf, size_t cap, const struct request *req);
+
+/* Flags eines schon kodierten Requests ergänzen (z.B. REQ_FLAG_EOS für ein
+ * eingereihtes, noch nicht gesendetes Paket).
+ */
+void wireOrRequestFlags(unsigned char *buf, unsigned short flags);
+
+/* Request dekodieren. Ist payload != NULL, zeigt *payload danach auf die
+ * Nutzdaten in buf (keine Kopie), sonst werden sie nach req->name kopiert.
+ * Rückgabe: 0 bei Erfolg, <0 bei falscher Version/Länge.
+ */
+int wireDecodeRequest(const unsigned char *buf, size_t len, struct request *req,
+                      const char **payload);
+
+/* Antwort kodieren. Rückgabe: Länge, 0 wenn buf zu klein. */
+size_t wireEncodeAnswer(unsigned char *buf, size_t cap, const struct answer *answ);
+
+/* Antwort dekodieren. Rückgabe: 0 bei Erfolg, <0 bei falscher Version/Länge. */
+int wireDecodeAnswer(const unsigned char *buf, size_t len, struct answer *answ);
+
+#endif /* WIRE_H_INCLUDED */